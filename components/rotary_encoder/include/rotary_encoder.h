@@ -54,6 +54,11 @@ typedef struct {
  */
 typedef struct rotary_encoder_t rotary_encoder_t;
 
+/**
+ * @brief Called from the pcnt interrupt each time the count moves a watch step, see set_watch_step
+ */
+typedef void (*rotary_encoder_watch_cb_t)(void *arg);
+
 /**
  * @brief Rotary encoder interface
  *
@@ -107,8 +112,23 @@ struct rotary_encoder_t {
      * @return Current counter value (the sign indicates the direction of rotation)
      */
     int (*get_counter_value)(rotary_encoder_t *encoder);
-	
-	void (*set_counter_value)(rotary_encoder_t *encoder, int aValue);
+
+    /**
+     * @brief Interrupt each time the count moves step counts either way, instead of only on overflow
+     *
+     * The pcnt limits are set to +-step, so the unit clears itself at each one and the
+     * interrupt carries the step into the count, which get_counter_value still returns whole.
+     * Call it with the encoder stopped.
+     *
+     * @param encoder Rotary encoder handle
+     * @param step Counts between interrupts, such as the counts in a detent
+     * @param callback Called from the interrupt after each step, NULL for none
+     * @param arg Passed to callback
+     * @return
+     *      - ESP_OK: Set the watch step successfully
+     *      - ESP_ERR_INVALID_ARG: step is out of the counter's range
+     */
+    esp_err_t (*set_watch_step)(rotary_encoder_t *encoder, int16_t step, rotary_encoder_watch_cb_t callback, void *arg);
 };
 
 /**
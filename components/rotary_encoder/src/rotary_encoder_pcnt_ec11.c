@@ -15,6 +15,7 @@
 #include <string.h>
 #include <sys/cdefs.h>
 #include "esp_compiler.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "driver/pcnt.h"
 #include "sys/lock.h"
@@ -43,7 +44,10 @@ static _lock_t isr_service_install_lock;
 #define LOCK_RELEASE() _lock_release(&isr_service_install_lock)
 
 typedef struct {
-    int accumu_count;
+    volatile int accumu_count;
+    int16_t limit; // the unit clears itself at +-limit, the interrupt adds it to accumu_count
+    rotary_encoder_watch_cb_t watch_cb;
+    void *watch_arg;
     rotary_encoder_t parent;
     pcnt_unit_t pcnt_unit;
 } ec11_t;
@@ -85,39 +89,60 @@ static int ec11_get_counter_value(rotary_encoder_t *encoder)
 {
     ec11_t *ec11 = __containerof(encoder, ec11_t, parent);
     int16_t val = 0;
-    pcnt_get_counter_value(ec11->pcnt_unit, &val);
-    return val + ec11->accumu_count;
+    int accumu = 0;
+    // Again if the interrupt carried a step over between the two reads
+    do {
+        accumu = ec11->accumu_count;
+        pcnt_get_counter_value(ec11->pcnt_unit, &val);
+    } while (accumu != ec11->accumu_count);
+    return val + accumu;
 }
 
-static void ec11_set_counter_value(rotary_encoder_t *encoder, int aValue) 
+static esp_err_t ec11_del(rotary_encoder_t *encoder)
 {
-	ec11_t *ec11 = __containerof(encoder, ec11_t, parent);
-
-    LOCK_ACQUIRE();
-	ec11->accumu_count = aValue;
-    LOCK_RELEASE();
+    ec11_t *ec11 = __containerof(encoder, ec11_t, parent);
+    free(ec11);
+    return ESP_OK;
 }
 
-static esp_err_t ec11_del(rotary_encoder_t *encoder)
+static esp_err_t ec11_set_watch_step(rotary_encoder_t *encoder, int16_t step, rotary_encoder_watch_cb_t callback, void *arg)
 {
+    esp_err_t ret_code = ESP_OK;
     ec11_t *ec11 = __containerof(encoder, ec11_t, parent);
-    free(ec11);
+    ROTARY_CHECK(step > 0 && step <= EC11_PCNT_DEFAULT_HIGH_LIMIT, "watch step out of range", err, ESP_ERR_INVALID_ARG);
+
+    // What the unit has counted so far goes into accumu_count, it starts over from 0 at the new limits
+    int16_t val = 0;
+    pcnt_get_counter_value(ec11->pcnt_unit, &val);
+    ec11->accumu_count += val;
+    ec11->watch_cb = callback;
+    ec11->watch_arg = arg;
+    ec11->limit = step;
+    pcnt_set_event_value(ec11->pcnt_unit, PCNT_EVT_H_LIM, step);
+    pcnt_set_event_value(ec11->pcnt_unit, PCNT_EVT_L_LIM, -step);
+    pcnt_counter_clear(ec11->pcnt_unit);
     return ESP_OK;
+err:
+    return ret_code;
 }
 
-static void ec11_pcnt_overflow_handler(void *arg)
+static void IRAM_ATTR ec11_pcnt_overflow_handler(void *arg)
 {
     ec11_t *ec11 = (ec11_t *)arg;
     uint32_t status = 0;
     pcnt_get_event_status(ec11->pcnt_unit, &status);
 
+    // The unit has already cleared itself, clearing it again here would lose any count
+    // that came in since, which a watch step a few counts long makes likely
     if (status & PCNT_EVT_H_LIM) {
-        ec11->accumu_count += EC11_PCNT_DEFAULT_HIGH_LIMIT;
+        ec11->accumu_count += ec11->limit;
     } else if (status & PCNT_EVT_L_LIM) {
-        ec11->accumu_count += EC11_PCNT_DEFAULT_LOW_LIMIT;
+        ec11->accumu_count -= ec11->limit;
+    }
+
+    if (ec11->watch_cb && (status & (PCNT_EVT_H_LIM | PCNT_EVT_L_LIM))) {
+        ec11->watch_cb(ec11->watch_arg);
     }
-	
-	pcnt_counter_clear(ec11->pcnt_unit);
 }
 
 esp_err_t rotary_encoder_new_ec11(const rotary_encoder_config_t *config, rotary_encoder_t **ret_encoder, bool installISRService)
@@ -132,6 +157,7 @@ esp_err_t rotary_encoder_new_ec11(const rotary_encoder_config_t *config, rotary_
     ROTARY_CHECK(ec11, "allocate context memory failed", err, ESP_ERR_NO_MEM);
 
     ec11->pcnt_unit = (pcnt_unit_t)(config->dev);
+    ec11->limit = EC11_PCNT_DEFAULT_HIGH_LIMIT;
 
     // Configure channel 0
     pcnt_config_t dev_config = {
@@ -184,6 +210,7 @@ esp_err_t rotary_encoder_new_ec11(const rotary_encoder_config_t *config, rotary_
     ec11->parent.stop = ec11_stop;
     ec11->parent.set_glitch_filter = ec11_set_glitch_filter;
     ec11->parent.get_counter_value = ec11_get_counter_value;
+    ec11->parent.set_watch_step = ec11_set_watch_step;
 
     *ret_encoder = &(ec11->parent);
     return ESP_OK;
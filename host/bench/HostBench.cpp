@@ -0,0 +1,1822 @@
+// Benchmarks of the motion control path, built from the firmware sources in main/ and
+// run on the HostSim virtual clock. Every run produces the same numbers, so they can be
+// compared before and after a change to see its effect on latency and ramps.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Encoder.h"
+#include "EncoderCurve.h"
+#include "Event.h"
+#include "EventBus.h"
+#include "EventRecorder.h"
+#include "EventTrace.h"
+#include "EventTypes.h"
+#include "FastAccelStepper.h"
+#include "HostGpio.h"
+#include "HostPcnt.h"
+#include "HostSim.h"
+#include "FastAccelStepperBackend.h"
+#include "MovementSwitches.h"
+#include "Position.h"
+#include "RecordingStepGenerator.h"
+#include "SCurveRamp.h"
+#include "TableRamp.h"
+#include "Settings.h"
+#include "StateMachine.h"
+#include "config.h"
+#include "stepper.h"
+
+ESP_EVENT_DEFINE_BASE(BENCH_EVENT);
+// Low priority traffic for the flood scenario, handled at the cost of a screen update
+ESP_EVENT_DEFINE_BASE(FLOOD_EVENT);
+// Events for a handler stuck on a slow I2C transfer, for the overflow scenario
+ESP_EVENT_DEFINE_BASE(STALL_EVENT);
+// Events whose handler takes a known time, to check the trace's latencies against
+ESP_EVENT_DEFINE_BASE(TRACE_EVENT);
+
+// Every operator new in the process, so the event benchmark can show what a command costs the heap
+static std::atomic<uint64_t> gAllocations{0};
+
+void *operator new(size_t aSize)
+{
+	gAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *memory = malloc(aSize ? aSize : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *aMemory) noexcept
+{
+	free(aMemory);
+}
+
+void operator delete(void *aMemory, size_t) noexcept
+{
+	free(aMemory);
+}
+
+namespace
+{
+	constexpr int32_t BENCH_NORMAL_SPEED = 2000;
+	constexpr int32_t BENCH_RAPID_SPEED = 20000;
+	// Pins for the extra steppers the backend comparison creates, clear of the real ones
+	constexpr uint8_t BENCH_DIR_PIN = 40;
+	constexpr uint8_t BENCH_ENABLE_PIN = 41;
+	constexpr uint8_t BENCH_STEP_PIN = 42;
+
+	std::shared_ptr<Settings> mySettings;
+	std::shared_ptr<Stepper> myStepper;
+	std::shared_ptr<StateMachine> myState;
+	std::shared_ptr<RotaryEncoder> myEncoder;
+	std::shared_ptr<Switch> leftSwitch;
+	std::shared_ptr<Switch> rightSwitch;
+	std::shared_ptr<Switch> rapidSwitch;
+
+	struct Samples
+	{
+		std::vector<double> myValues;
+
+		void Add(double aValue) { myValues.push_back(aValue); }
+
+		double Percentile(double aFraction) const
+		{
+			if (myValues.empty())
+			{
+				return 0;
+			}
+			std::vector<double> sorted = myValues;
+			std::sort(sorted.begin(), sorted.end());
+			const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(aFraction * sorted.size()));
+			return sorted[index];
+		}
+
+		double Mean() const
+		{
+			double sum = 0;
+			for (double value : myValues)
+			{
+				sum += value;
+			}
+			return myValues.empty() ? 0 : sum / myValues.size();
+		}
+
+		void Print(const char *aName, const char *aUnit) const
+		{
+			printf("  %-34s n=%-4zu min=%9.2f mean=%9.2f p50=%9.2f p99=%9.2f max=%9.2f %s\n", aName, myValues.size(),
+				   Percentile(0), Mean(), Percentile(0.5), Percentile(0.99), Percentile(1), aUnit);
+		}
+	};
+
+	void SetPin(gpio_num_t aPin, int aLevel)
+	{
+		HostSim::CpuLock cpu;
+		HostGpio::SetLevel(aPin, aLevel);
+	}
+
+	void PostSpeedDelta(int32_t aDelta)
+	{
+		HostSim::CpuLock cpu;
+		ESP_ERROR_CHECK(EventPublisher::PublishEvent<Event::UpdateSpeed>(COMMAND_EVENT, aDelta));
+	}
+
+	template <typename T>
+	T Read(const std::function<T()> &aRead)
+	{
+		HostSim::CpuLock cpu;
+		return aRead();
+	}
+
+	int32_t GetPosition()
+	{
+		return Read<int32_t>([] { return HostFastAccelStepper::Get(stepPinStepper)->getCurrentPosition(); });
+	}
+
+	// Mirrors setup() in main.cpp without the display, LED and button task.
+	void Setup()
+	{
+		{
+			HostSim::CpuLock cpu;
+			mySettings = std::make_shared<Settings>();
+			std::shared_ptr<SettingsData> savedSettings = mySettings->Get();
+
+			myStepper = std::make_shared<Stepper>();
+			myStepper->Init(dirPinStepper, enablePinStepper, stepPinStepper, savedSettings->myRapidSpeed,
+							savedSettings->myNormalSpeed);
+			myStepper->SetBacklash(savedSettings->myBacklashSteps);
+			myState = std::make_shared<StateMachine>(myStepper);
+			myEncoder = std::make_shared<RotaryEncoder>(ENCODER_A_PIN, ENCODER_B_PIN, ENCODER_BUTTON_PIN,
+													   maxStepsPerSecond, 100);
+			myEncoder->SetSpeedUnit(savedSettings->mySpeedUnits);
+
+			MovementSwitches::Create();
+			leftSwitch = std::make_shared<Switch>(LEFTPIN, 50, Event::MoveLeft, Event::StopMoveLeft);
+			rightSwitch = std::make_shared<Switch>(RIGHTPIN, 50, Event::MoveRight, Event::StopMoveRight);
+			rapidSwitch = std::make_shared<Switch>(RAPIDPIN, 50, Event::RapidSpeed, Event::NormalSpeed);
+			MovementSwitches::AddSwitch(SwitchName::LEFT, leftSwitch);
+			MovementSwitches::AddSwitch(SwitchName::RIGHT, rightSwitch);
+			MovementSwitches::AddSwitch(SwitchName::RAPID, rapidSwitch);
+
+			myState->Start();
+			MovementSwitches::Start(myState->GetSwitchCommands());
+			myEncoder->begin(myState->GetEncoderCommands());
+		}
+		HostSim::Advance(100000);
+
+		// Dial in known speeds the way the operator would: rapid first, since normal is capped by it.
+		const int32_t savedRapid = mySettings->Get()->myRapidSpeed;
+		const int32_t savedNormal = mySettings->Get()->myNormalSpeed;
+		SetPin(RAPIDPIN, 1);
+		HostSim::Advance(200000);
+		PostSpeedDelta(BENCH_RAPID_SPEED - savedRapid);
+		HostSim::Advance(10000);
+		SetPin(RAPIDPIN, 0);
+		HostSim::Advance(200000);
+		PostSpeedDelta(BENCH_NORMAL_SPEED - std::min(savedNormal, savedRapid));
+		HostSim::Advance(10000);
+	}
+
+	// Conditions for HostSim::AdvanceUntil, which already holds the CPU while evaluating them.
+	bool IsMoving()
+	{
+		return !myStepper->IsStopped();
+	}
+
+	void WaitForStopped()
+	{
+		HostSim::AdvanceUntil([] { return myState->GetState() == State::Stopped; }, 5000000);
+	}
+
+	// A switch closing or opening with some contact bounce, timed from the first edge
+	void BounceTo(gpio_num_t aPin, int aLevel, uint64_t aBackUs = 700)
+	{
+		SetPin(aPin, aLevel);
+		HostSim::Advance(300);
+		SetPin(aPin, !aLevel);
+		HostSim::Advance(aBackUs);
+		SetPin(aPin, aLevel);
+	}
+
+	void BenchSwitchLatency(SwitchMode aMode, const char *aName)
+	{
+		printf("Switch to motion latency, %s (left switch, %d bouncing presses at varying sample phase)\n", aName, 50);
+		{
+			HostSim::CpuLock cpu;
+			MovementSwitches::SetMode(aMode);
+		}
+		Samples pressToMotion;
+		Samples releaseToStopCommand;
+		Samples releaseToStoppedState;
+
+		for (int i = 0; i < 50; i++)
+		{
+			// Step the press across the sample clock so every phase is seen, and the bounce
+			// across it too. A bounce of exactly a sample period would always land on the
+			// sample an edge-started timer takes.
+			HostSim::Advance(250000 + (i * 1370) % 20000);
+			const uint64_t bounceUs = 200 + (i * 290) % 1300;
+
+			const uint64_t pressed = HostSim::NowUs();
+			BounceTo(LEFTPIN, 1, bounceUs);
+			HostSim::AdvanceUntil(IsMoving, 1000000, 100);
+			pressToMotion.Add((HostSim::NowUs() - pressed) / 1000.0);
+
+			HostSim::Advance(300000);
+
+			const uint64_t released = HostSim::NowUs();
+			BounceTo(LEFTPIN, 0, bounceUs);
+			HostSim::AdvanceUntil([] { return myState->GetState() != State::MovingLeft; }, 1000000, 100);
+			releaseToStopCommand.Add((HostSim::NowUs() - released) / 1000.0);
+			WaitForStopped();
+			releaseToStoppedState.Add((HostSim::NowUs() - released) / 1000.0);
+		}
+
+		pressToMotion.Print("press -> stepper running", "ms");
+		releaseToStopCommand.Print("release -> Stop() issued", "ms");
+		releaseToStoppedState.Print("release -> State::Stopped", "ms");
+	}
+
+	// Level and how long it holds, in us, the last one held until the next case
+	struct Contact
+	{
+		int myLevel;
+		uint64_t myHoldUs;
+	};
+
+	void Chatter(gpio_num_t aPin, const std::vector<Contact> &aContacts)
+	{
+		for (const Contact &contact : aContacts)
+		{
+			SetPin(aPin, contact.myLevel);
+			HostSim::Advance(contact.myHoldUs);
+		}
+	}
+
+	BounceStats GetLeftBounceStats()
+	{
+		HostSim::CpuLock cpu;
+		BounceStats stats;
+		MovementSwitches::GetBounceStats(SwitchName::LEFT, stats);
+		return stats;
+	}
+
+	// What the integrator makes of contacts worse than BounceTo's, per the left switch's stats.
+	// Every case has to make the changes it should, and a clean press has to confirm in the
+	// switch's confirm time rather than its delay. False if not.
+	bool BenchSwitchBounce()
+	{
+		printf("Switch bounce, left switch, integrator over %u ms, quiet after %u ms\n",
+			   leftSwitch->myThreshold * MovementSwitches::SAMPLE_PERIOD_MS, leftSwitch->myDelay);
+		{
+			HostSim::CpuLock cpu;
+			MovementSwitches::ResetBounceStats();
+		}
+
+		struct Case
+		{
+			const char *myName;
+			std::vector<Contact> myPress;
+			std::vector<Contact> myRelease;
+			uint32_t myChanges;
+		};
+		const std::vector<Case> cases = {
+			{"clean", {{1, 0}}, {{0, 0}}, 2},
+			{"8 ms of chatter", {{1, 400}, {0, 900}, {1, 300}, {0, 1500}, {1, 700}, {0, 600}, {1, 1200}, {0, 400}, {1, 2000}, {0, 300}, {1, 0}},
+			 {{0, 600}, {1, 300}, {0, 1100}, {1, 800}, {0, 500}, {1, 1500}, {0, 900}, {1, 400}, {0, 0}}, 2},
+			// Long enough the other way to confirm, but still bouncing, so it mustn't count
+			{"release bouncing back 8 ms", {{1, 0}}, {{0, 7000}, {1, 8000}, {0, 0}}, 2},
+			{"2 ms glitch, rejected", {{1, 2000}, {0, 0}}, {}, 0},
+			{"3 ms tap with bounce, rejected", {{1, 300}, {0, 200}, {1, 2600}, {0, 0}}, {}, 0},
+		};
+
+		bool changesMet = true;
+		int64_t cleanConfirmUs = 0;
+
+		for (const Case &bounceCase : cases)
+		{
+			HostSim::Advance(250000);
+			const BounceStats start = GetLeftBounceStats();
+
+			const uint64_t pressed = HostSim::NowUs();
+			Chatter(LEFTPIN, bounceCase.myPress);
+			const bool moved = HostSim::AdvanceUntil(IsMoving, 100000, 100);
+			const double pressMs = (HostSim::NowUs() - pressed) / 1000.0;
+
+			double releaseMs = 0;
+			if (moved && !bounceCase.myRelease.empty())
+			{
+				HostSim::Advance(200000);
+				const uint64_t released = HostSim::NowUs();
+				Chatter(LEFTPIN, bounceCase.myRelease);
+				HostSim::AdvanceUntil([] { return myState->GetState() != State::MovingLeft; }, 1000000, 100);
+				releaseMs = (HostSim::NowUs() - released) / 1000.0;
+				WaitForStopped();
+			}
+			HostSim::Advance(50000);
+
+			const BounceStats stats = GetLeftBounceStats();
+			printf("  %-31s %s", bounceCase.myName, moved ? "" : "no motion");
+			if (moved)
+			{
+				printf("press -> running %5.2f ms", pressMs);
+			}
+			if (releaseMs > 0)
+			{
+				printf("  release -> Stop() %5.2f ms", releaseMs);
+			}
+			printf("  (%u changes, %u rejected, %u bounces)\n", stats.myChanges - start.myChanges,
+				   stats.myRejected - start.myRejected, stats.myBounces - start.myBounces);
+			changesMet = changesMet && stats.myChanges - start.myChanges == bounceCase.myChanges;
+			if (&bounceCase == &cases.front())
+			{
+				cleanConfirmUs = stats.myMaxConfirmUs;
+			}
+		}
+
+		// The first edge is sample 0, so the confirm time's last sample lands a period early
+		const int64_t confirmBoundUs = leftSwitch->myThreshold * MovementSwitches::SAMPLE_US;
+		const bool confirmMet = cleanConfirmUs <= confirmBoundUs;
+		printf("  %-34s %s\n", "changes as the contacts meant", changesMet ? "met" : "NOT MET");
+		printf("  %-34s %s (%.2f ms, bound %.2f ms, delay %u ms)\n", "clean press confirmed",
+			   confirmMet ? "met" : "NOT MET", cleanConfirmUs / 1000.0, confirmBoundUs / 1000.0, leftSwitch->myDelay);
+
+		HostSim::CpuLock cpu;
+		MovementSwitches::PrintStats();
+		return changesMet && confirmMet;
+	}
+
+	// Speed changes the stepper sent to the UI, summed
+	int32_t gUiSpeedDeltas = 0;
+
+	// The knob spun hard past each end of both speeds. Each has to stop at its bound, and the
+	// UI has to be told only what was applied. Put back as it was after. False if not.
+	bool CheckSpeedBounds()
+	{
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventBus::Register(
+				UI_EVENT, static_cast<int32_t>(Event::UpdateSpeed),
+				[](void *, esp_event_base_t, int32_t, void *aData) {
+					gUiSpeedDeltas += GetPayload<Event::UpdateSpeed>(static_cast<const EventData *>(aData))->myValue;
+				},
+				nullptr));
+		}
+		auto spin = [](int aDetents) {
+			for (int detent = 0; detent < std::abs(aDetents); detent++)
+			{
+				{
+					HostSim::CpuLock cpu;
+					HostPcnt::AddCounts(PCNT_UNIT_2, aDetents > 0 ? ENCODER_COUNTS_PER_DETENT : -ENCODER_COUNTS_PER_DETENT);
+				}
+				HostSim::Advance(1000000 / 80);
+			}
+			HostSim::Advance(500000);
+		};
+		bool met = true;
+		auto check = [&](const char *aName, int aDetents, bool aRapid, int32_t anEnd) {
+			const std::function<int32_t()> speed = [aRapid] {
+				return aRapid ? mySettings->Get()->myRapidSpeed : mySettings->Get()->myNormalSpeed;
+			};
+			const int32_t before = Read<int32_t>(speed);
+			const int32_t told = Read<int32_t>([] { return gUiSpeedDeltas; });
+			spin(aDetents);
+			const int32_t after = Read<int32_t>(speed);
+			const int32_t applied = Read<int32_t>([] { return gUiSpeedDeltas; }) - told;
+			const bool bounded = after == anEnd && applied == after - before;
+			printf("  %-34s %s (%d -> %d, UI told %+d)\n", aName, bounded ? "met" : "NOT MET", before, after, applied);
+			met = met && bounded;
+		};
+
+		const int32_t rapid = Read<int32_t>([] { return mySettings->Get()->myRapidSpeed; });
+		const int32_t normal = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+		check("normal spun past 0", -100, false, 0);
+		check("normal spun past the rapid speed", 100, false, rapid);
+		SetPin(RAPIDPIN, 1);
+		HostSim::Advance(200000);
+		check("rapid spun past maxStepsPerSecond", 100, true, static_cast<int32_t>(maxStepsPerSecond));
+		check("rapid spun past 0", -100, true, 0);
+		PostSpeedDelta(rapid);
+		HostSim::Advance(10000);
+		SetPin(RAPIDPIN, 0);
+		HostSim::Advance(200000);
+		PostSpeedDelta(normal - Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; }));
+		HostSim::RunUntilIdle();
+		return met;
+	}
+
+	// The speed knob's curve on its own, then turned through the PCNT stand-in and the
+	// encoder task, in both units. False if the curve isn't fine when slow and coarse when fast.
+	bool BenchEncoderCurve()
+	{
+		printf("Encoder speed curve (speed change per detent by how fast the knob turns)\n");
+		bool met = true;
+		for (const SpeedUnit unit : {SpeedUnit::MMPM, SpeedUnit::IPM})
+		{
+			const EncoderCurve &curve = GetEncoderCurve(unit);
+			const char *unitName = unit == SpeedUnit::MMPM ? "mm/min" : "IPM";
+
+			printf("  %-34s", unitName);
+			float previous = 0;
+			bool rising = true;
+			for (const float rate : {1.0f, 5.0f, 10.0f, 20.0f, 30.0f, 40.0f, 80.0f})
+			{
+				const float step = curve.GetStep(rate);
+				rising = rising && step >= previous;
+				previous = step;
+				printf(" %2.0f/s %6.2f", rate, step);
+			}
+			printf("\n");
+
+			const bool slowIsFine = curve.GetStep(0) == curve.myFineStep && curve.GetStep(curve.mySlowRate) == curve.myFineStep;
+			const bool fastIsCoarse = curve.GetStep(curve.myFastRate) == curve.myCoarseStep;
+			const bool symmetric = curve.GetSpeedDelta(-3, 0.1f) == -curve.GetSpeedDelta(3, 0.1f);
+			const bool curveMet = rising && slowIsFine && fastIsCoarse && symmetric;
+			printf("  %-34s %s\n", "fine when slow, coarse when fast", curveMet ? "met" : "NOT MET");
+			met = met && curveMet;
+		}
+
+		// End to end, the speed setting moved by 20 detents at each rate, and put back after
+		const int32_t normalBefore = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+		for (const SpeedUnit unit : {SpeedUnit::MMPM, SpeedUnit::IPM})
+		{
+			{
+				HostSim::CpuLock cpu;
+				ESP_ERROR_CHECK(EventPublisher::PublishEvent<Event::SetSpeedUnit>(SETTINGS_EVENT, unit));
+			}
+			// Long enough for the last turn to count as a pause, so each run starts slow
+			HostSim::Advance(2000000);
+
+			const float unitsPerStep = 60 / stepsPerMm / (unit == SpeedUnit::MMPM ? 1 : 25.4f);
+			for (const int rate : {2, 10, 40})
+			{
+				constexpr int DETENTS = 20;
+				const int32_t before = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+				for (int detent = 0; detent < DETENTS; detent++)
+				{
+					{
+						HostSim::CpuLock cpu;
+						HostPcnt::AddCounts(PCNT_UNIT_2, ENCODER_COUNTS_PER_DETENT);
+					}
+					HostSim::Advance(1000000 / rate);
+				}
+				HostSim::Advance(2000000);
+				const int32_t after = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+
+				char name[64];
+				snprintf(name, sizeof(name), "%d detents at %d/s, %s", DETENTS, rate, unit == SpeedUnit::MMPM ? "mm/min" : "IPM");
+				printf("  %-34s %+8.2f, %6.3f a detent\n", name, (after - before) * unitsPerStep,
+					   (after - before) * unitsPerStep / DETENTS);
+			}
+		}
+
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventPublisher::PublishEvent<Event::SetSpeedUnit>(SETTINGS_EVENT, SpeedUnit::MMPM));
+		}
+		HostSim::Advance(2000000);
+		const int32_t normalAfter = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+		PostSpeedDelta(normalBefore - normalAfter);
+		HostSim::RunUntilIdle();
+
+		// Turns of a 20 detent knob from a 20 mm/min finishing feed to 500 mm/min roughing
+		const EncoderCurve &mm = MMPM_ENCODER_CURVE;
+		const float oldStep = 2 * ENCODER_COUNTS_PER_DETENT * 60 / stepsPerMm;
+		printf("  %-34s %6.1f turns before, %.1f slowly, %.1f spun\n", "20 -> 500 mm/min", 480 / oldStep / 20,
+			   480 / mm.myFineStep / 20, 480 / mm.myCoarseStep / 20);
+		return CheckSpeedBounds() && met;
+	}
+
+	// One detent at a time at varying phase, then 10 s with the knob still. The virtual clock
+	// stands still while the interrupt, the encoder task and the motion task run, so a latency
+	// would always read 0 here. Checked instead: each detent wakes the encoder task exactly
+	// once, its speed change is at the motion task before the clock moves on, so nothing
+	// polled it there, and nothing wakes the task while the knob is still. Returns false if
+	// any of that didn't hold.
+	bool BenchEncoderWakeups()
+	{
+		constexpr int DETENTS = 50;
+		printf("Encoder detent wakeups (%d single detents at varying phase, then 10 s idle)\n", DETENTS);
+		const int32_t normalBefore = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+		int wokenOnce = 0;
+		int beforeTheClock = 0;
+		for (int i = 0; i < DETENTS; i++)
+		{
+			HostSim::Advance(300000 + (i * 1370) % 20000);
+			const uint32_t received = Read<uint32_t>([] { return myState->GetSpeedUpdateStats().myReceived; });
+			const uint32_t wakeups = Read<uint32_t>([] { return myEncoder->GetWakeups(); });
+			{
+				HostSim::CpuLock cpu;
+				HostPcnt::AddCounts(PCNT_UNIT_2, i % 2 ? -ENCODER_COUNTS_PER_DETENT : ENCODER_COUNTS_PER_DETENT);
+			}
+			HostSim::RunUntilIdle();
+			if (Read<uint32_t>([] { return myState->GetSpeedUpdateStats().myReceived; }) == received + 1)
+			{
+				beforeTheClock++;
+			}
+			if (Read<uint32_t>([] { return myEncoder->GetWakeups(); }) == wakeups + 1)
+			{
+				wokenOnce++;
+			}
+		}
+		printf("  %-34s %5d of %d\n", "woken once per detent", wokenOnce, DETENTS);
+		printf("  %-34s %5d of %d\n", "at the motion task, clock unmoved", beforeTheClock, DETENTS);
+
+		const uint32_t wakeups = Read<uint32_t>([] { return myEncoder->GetWakeups(); });
+		HostSim::Advance(10000000);
+		const uint32_t idleWakeups = Read<uint32_t>([] { return myEncoder->GetWakeups(); }) - wakeups;
+		printf("  %-34s %5u\n", "idle wakeups in 10 s", idleWakeups);
+
+		const bool met = wokenOnce == DETENTS && beforeTheClock == DETENTS && idleWakeups == 0;
+		printf("  %-34s %s\n", "a wakeup per detent, none idle", met ? "met" : "NOT MET");
+
+		// Back and forth comes out even apart from rounding, put that back too
+		const int32_t normalAfter = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+		PostSpeedDelta(normalBefore - normalAfter);
+		HostSim::RunUntilIdle();
+		return met;
+	}
+
+	uint32_t GetGestureCount(EncoderButton::Gesture aGesture)
+	{
+		HostSim::CpuLock cpu;
+		return myEncoder->GetButton().GetCount(aGesture);
+	}
+
+	// Each gesture on the encoder button, pressing low with BounceTo's contact bounce, timed
+	// from the edge that decides it to it being sent
+	void BenchButtonGestures()
+	{
+		using Gesture = EncoderButton::Gesture;
+		printf("Encoder button gestures (debounce %u ms, long %u ms, double within %u ms)\n", EncoderButton::DEBOUNCE_MS,
+			   EncoderButton::LONG_PRESS_MS, EncoderButton::DOUBLE_PRESS_MS);
+		const int32_t normalBefore = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+
+		struct Case
+		{
+			const char *myName;
+			Gesture myExpected;
+			std::function<void()> myPerform; // ends on the edge the gesture is timed from
+		};
+		const std::vector<Case> cases = {
+			{"short press", Gesture::Short,
+			 [] {
+				 BounceTo(ENCODER_BUTTON_PIN, 0);
+				 HostSim::Advance(150000);
+				 BounceTo(ENCODER_BUTTON_PIN, 1);
+			 }},
+			{"double press", Gesture::Double,
+			 [] {
+				 BounceTo(ENCODER_BUTTON_PIN, 0);
+				 HostSim::Advance(120000);
+				 BounceTo(ENCODER_BUTTON_PIN, 1);
+				 HostSim::Advance(150000);
+				 BounceTo(ENCODER_BUTTON_PIN, 0);
+				 HostSim::Advance(120000);
+				 BounceTo(ENCODER_BUTTON_PIN, 1);
+			 }},
+			{"long press, timed from the press", Gesture::Long, [] { BounceTo(ENCODER_BUTTON_PIN, 0); }},
+			{"press and turn 3 detents", Gesture::PressTurn,
+			 [] {
+				 BounceTo(ENCODER_BUTTON_PIN, 0);
+				 for (int detent = 0; detent < 3; detent++)
+				 {
+					 HostSim::Advance(200000);
+					 HostSim::CpuLock cpu;
+					 HostPcnt::AddCounts(PCNT_UNIT_2, ENCODER_COUNTS_PER_DETENT);
+				 }
+				 HostSim::Advance(200000);
+				 BounceTo(ENCODER_BUTTON_PIN, 1);
+			 }},
+		};
+
+		for (const Case &gestureCase : cases)
+		{
+			HostSim::Advance(1000000);
+			uint32_t before[static_cast<int>(Gesture::Count)];
+			for (int gesture = 0; gesture < static_cast<int>(Gesture::Count); gesture++)
+			{
+				before[gesture] = GetGestureCount(static_cast<Gesture>(gesture));
+			}
+			const int32_t speedBefore = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+
+			gestureCase.myPerform();
+			const uint64_t decided = HostSim::NowUs();
+			const Gesture expected = gestureCase.myExpected;
+			const uint32_t expectedBefore = before[static_cast<int>(expected)];
+			HostSim::AdvanceUntil([expected, expectedBefore] { return myEncoder->GetButton().GetCount(expected) != expectedBefore; },
+								  3000000, 100);
+			const double sentMs = (HostSim::NowUs() - decided) / 1000.0;
+			if (expected == Gesture::Long)
+			{
+				HostSim::Advance(500000);
+				BounceTo(ENCODER_BUTTON_PIN, 1);
+			}
+			HostSim::Advance(1000000);
+
+			// Everything the button sent for it, which should be the one gesture
+			std::string sent;
+			for (int gesture = 0; gesture < static_cast<int>(Gesture::Count); gesture++)
+			{
+				const uint32_t count = GetGestureCount(static_cast<Gesture>(gesture)) - before[gesture];
+				if (count)
+				{
+					sent += (sent.empty() ? "" : ", ") + std::to_string(count) + " " +
+							EncoderButton::GetGestureName(static_cast<Gesture>(gesture));
+				}
+			}
+			const int32_t speedAfter = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+			printf("  %-34s %7.2f ms  sent %s", gestureCase.myName, sentMs, sent.empty() ? "nothing" : sent.c_str());
+			if (speedAfter != speedBefore)
+			{
+				printf(", speed %+.1f mm/min", (speedAfter - speedBefore) * 60 / stepsPerMm);
+			}
+			printf("\n");
+		}
+
+		PostSpeedDelta(normalBefore - Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; }));
+		HostSim::RunUntilIdle();
+	}
+
+	void BenchRamp(bool aRapid, Stepper::RampProfile aProfile)
+	{
+		const int32_t target = aRapid ? BENCH_RAPID_SPEED : BENCH_NORMAL_SPEED;
+		const char *profile = aProfile == Stepper::RampProfile::SCurve		  ? "S-curve"
+							  : aProfile == Stepper::RampProfile::LinearTable ? "table driven linear"
+																			  : "linear";
+		printf("%s ramp at %s speed (%d steps/s)\n", profile, aRapid ? "rapid" : "normal", target);
+		{
+			HostSim::CpuLock cpu;
+			myStepper->SetRampProfile(aProfile);
+		}
+
+		if (aRapid)
+		{
+			SetPin(RAPIDPIN, 1);
+			HostSim::Advance(200000);
+		}
+
+		SetPin(RIGHTPIN, 1);
+		const uint64_t pressed = HostSim::NowUs();
+		HostSim::AdvanceUntil(IsMoving, 1000000, 100);
+		const uint64_t started = HostSim::NowUs();
+		// Stepper::GetCurrentSpeed is unsigned and running right is negative, so read the backend directly.
+		HostSim::AdvanceUntil(
+			[target] {
+				const int32_t speed = HostFastAccelStepper::Get(stepPinStepper)->getCurrentSpeedInMilliHz() / 1000;
+				return std::abs(std::abs(speed) - target) <= 1;
+			},
+			10000000, 100);
+		const uint64_t atSpeed = HostSim::NowUs();
+		HostSim::Advance(500000);
+
+		SetPin(RIGHTPIN, 0);
+		const uint64_t released = HostSim::NowUs();
+		HostSim::AdvanceUntil([] { return myState->GetState() != State::MovingRight; }, 1000000, 100);
+		const int32_t positionAtStop = GetPosition();
+		const uint64_t stopIssued = HostSim::NowUs();
+		HostSim::AdvanceUntil([] { return myStepper->IsStopped(); }, 10000000, 100);
+		const uint64_t motionEnded = HostSim::NowUs();
+		const int32_t positionAtRest = GetPosition();
+		WaitForStopped();
+		const uint64_t stoppedState = HostSim::NowUs();
+
+		printf("  %-34s %9.2f ms\n", "press -> running", (started - pressed) / 1000.0);
+		printf("  %-34s %9.2f ms\n", "running -> at target speed", (atSpeed - started) / 1000.0);
+		printf("  %-34s %9.2f ms\n", "Stop() -> motion ended", (motionEnded - stopIssued) / 1000.0);
+		printf("  %-34s %9d steps (%.3f mm)\n", "stopping distance", std::abs(positionAtRest - positionAtStop),
+			   std::abs(positionAtRest - positionAtStop) / stepsPerMm);
+		printf("  %-34s %9.2f ms\n", "motion ended -> State::Stopped", (stoppedState - motionEnded) / 1000.0);
+		printf("  %-34s %9.2f ms\n", "release -> State::Stopped", (stoppedState - released) / 1000.0);
+
+		if (aRapid)
+		{
+			SetPin(RAPIDPIN, 0);
+			HostSim::Advance(200000);
+		}
+	}
+
+	// Cost of generating ramp steps on the host CPU, against the time between steps at the
+	// driver's top step rate. The target (no FPU on the S2) will be slower, this is for comparing changes.
+	template <typename Ramp>
+	void BenchRampCompute(const char *aName, Ramp &aRamp, uint32_t aTopSpeed)
+	{
+		const double budgetNs = 1e9 / MAX_DRIVER_STEPS_PER_SECOND;
+		printf("%s step generation (0 -> %u -> 0 steps/s, host CPU)\n", aName, aTopSpeed);
+
+		uint64_t steps = 0;
+		uint64_t upTicks = 0;
+		uint64_t downTicks = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int run = 0; run < 10; run++)
+		{
+			aRamp.SetTargetSpeed(aTopSpeed);
+			upTicks = 0;
+			while (!aRamp.IsAtTarget())
+			{
+				upTicks += aRamp.NextInterval();
+				steps++;
+			}
+			aRamp.SetTargetSpeed(0);
+			downTicks = 0;
+			while (aRamp.IsActive())
+			{
+				downTicks += aRamp.NextInterval();
+				steps++;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Time each call on its own for the worst case, clock reads included. The ramp is the same
+		// every run, so keeping the fastest of several runs per step filters out host preemption.
+		std::vector<double> fastest;
+		for (int run = 0; run < 5; run++)
+		{
+			size_t step = 0;
+			aRamp.SetTargetSpeed(aTopSpeed);
+			while (aRamp.IsActive())
+			{
+				if (aRamp.IsAtTarget())
+				{
+					aRamp.SetTargetSpeed(0);
+				}
+				const auto before = std::chrono::steady_clock::now();
+				aRamp.NextInterval();
+				const double ns =
+					std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - before).count();
+				if (step == fastest.size())
+				{
+					fastest.push_back(ns);
+				}
+				fastest[step] = std::min(fastest[step], ns);
+				step++;
+			}
+		}
+		Samples perStep;
+		for (double ns : fastest)
+		{
+			perStep.Add(ns);
+		}
+
+		printf("  %-34s %9.0f intervals/s (%.1f ns each)\n", "throughput", steps / seconds, seconds * 1e9 / steps);
+		printf("  %-34s %9.2f ms up, %.2f ms down\n", "ramp time", upTicks * 1000.0 / TICKS_PER_S,
+			   downTicks * 1000.0 / TICKS_PER_S);
+		perStep.Print("NextInterval()", "ns");
+		printf("  %-34s %9.0f ns per step at %.0f steps/s: %s\n", "budget", budgetNs, MAX_DRIVER_STEPS_PER_SECOND,
+			   perStep.Percentile(1) <= budgetNs ? "worst case within budget" : "WORST CASE OVER BUDGET");
+	}
+
+	void BenchRampCompute()
+	{
+		SCurveRamp sCurve(acceleration, deceleration, jerk, TICKS_PER_S);
+		BenchRampCompute("S-curve", sCurve, MAX_DRIVER_STEPS_PER_SECOND);
+
+		// The tables only go up to the fastest the feed is ever asked for.
+		TableRamp<acceleration, deceleration, static_cast<uint32_t>(maxStepsPerSecond), TICKS_PER_S> table;
+		BenchRampCompute("Table driven linear", table, maxStepsPerSecond);
+	}
+
+	// Every backend the host can run, driven through the same Stepper calls with each ramp profile.
+	// Pulse jitter is how far each step interval is from the mean of its neighbours above 1000
+	// steps/s, which is where batching steps into queue commands shows up. Only the recording
+	// backend logs pulses. CPU cost is host time per step and includes the simulator itself.
+	void BenchBackend(const char *aName, std::unique_ptr<StepGenerator> aBackend, Stepper::RampProfile aProfile)
+	{
+		static std::vector<std::shared_ptr<Stepper>> steppers; // their ramp tasks run forever
+		StepGenerator *backend = aBackend.get();
+		RecordingStepGenerator *recorder = dynamic_cast<RecordingStepGenerator *>(backend);
+		std::shared_ptr<Stepper> stepper;
+		{
+			HostSim::CpuLock cpu;
+			stepper = std::make_shared<Stepper>(std::move(aBackend));
+			stepper->Init(BENCH_DIR_PIN, BENCH_ENABLE_PIN, BENCH_STEP_PIN, BENCH_RAPID_SPEED, BENCH_NORMAL_SPEED);
+			stepper->SetRampProfile(aProfile);
+			stepper->SetRapidSpeed();
+		}
+		steppers.push_back(stepper);
+		if (stepper->GetRampProfile() != aProfile)
+		{
+			printf("  %-38s needs a step queue\n", aName);
+			return;
+		}
+
+		auto steps = [&] {
+			return recorder ? static_cast<int64_t>(recorder->GetPulses().size())
+							: static_cast<int64_t>(HostFastAccelStepper::Get(BENCH_STEP_PIN)->getCurrentPosition());
+		};
+		int32_t maxSpeed = 0;
+		auto sample = [&] {
+			maxSpeed = std::max(maxSpeed, std::abs(backend->GetCurrentSpeed()));
+			return false;
+		};
+
+		const int64_t startSteps = Read<int64_t>(steps);
+		const auto start = std::chrono::steady_clock::now();
+		{
+			HostSim::CpuLock cpu;
+			stepper->MoveLeft();
+		}
+		HostSim::AdvanceUntil(
+			[&] {
+				sample();
+				return std::abs(backend->GetCurrentSpeed()) >= BENCH_RAPID_SPEED - 1;
+			},
+			5000000);
+		HostSim::AdvanceUntil(sample, 200000);
+		{
+			HostSim::CpuLock cpu;
+			stepper->Stop();
+		}
+		HostSim::AdvanceUntil(
+			[&] {
+				sample();
+				return stepper->IsStopped();
+			},
+			5000000);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const int64_t stepCount = std::abs(Read<int64_t>(steps) - startSteps);
+
+		char jitter[64] = "no pulse log";
+		if (recorder)
+		{
+			Samples deviation;
+			HostSim::CpuLock cpu;
+			const std::vector<RecordingStepGenerator::Pulse> &pulses = recorder->GetPulses();
+			for (size_t i = 3; i < pulses.size(); i++)
+			{
+				const double before = static_cast<double>(pulses[i - 2].myTick - pulses[i - 3].myTick);
+				const double interval = static_cast<double>(pulses[i - 1].myTick - pulses[i - 2].myTick);
+				const double after = static_cast<double>(pulses[i].myTick - pulses[i - 1].myTick);
+				if (interval < StepGenerator::TICKS_PER_SECOND / 1000)
+				{
+					deviation.Add(std::fabs(interval - (before + after) / 2) * 1e9 / StepGenerator::TICKS_PER_SECOND);
+				}
+			}
+			snprintf(jitter, sizeof(jitter), "jitter p99 %6.0f max %6.0f ns", deviation.Percentile(0.99),
+					 deviation.Percentile(1));
+			recorder->Clear();
+		}
+		printf("  %-38s max %6d steps/s, %-30s %6.0f ns/step host CPU\n", aName, maxSpeed, jitter,
+			   seconds * 1e9 / std::max<int64_t>(stepCount, 1));
+	}
+
+	void BenchBackends()
+	{
+		printf("Step generator backends (0 -> %d -> 0 steps/s)\n", BENCH_RAPID_SPEED);
+		const std::pair<Stepper::RampProfile, const char *> profiles[] = {
+			{Stepper::RampProfile::Linear, "linear"},
+			{Stepper::RampProfile::SCurve, "S-curve"},
+			{Stepper::RampProfile::LinearTable, "table driven linear"}};
+		for (const auto &profile : profiles)
+		{
+			BenchBackend((std::string("FastAccelStepper, ") + profile.second).c_str(),
+						 std::unique_ptr<StepGenerator>(new FastAccelStepperBackend()), profile.first);
+			BenchBackend((std::string("recording, ") + profile.second).c_str(),
+						 std::unique_ptr<StepGenerator>(new RecordingStepGenerator(acceleration)), profile.first);
+		}
+	}
+
+	void BenchPosition()
+	{
+		printf("Position readout (left jog at normal speed, read every ms)\n");
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventPublisher::PublishEvent(COMMAND_EVENT, Event::ZeroPosition));
+		}
+		HostSim::Advance(50000);
+		const int32_t zero = GetPosition();
+		Position &position = myStepper->GetPosition();
+
+		Samples lag;
+		Samples readCost;
+		SetPin(LEFTPIN, 1);
+		for (int i = 0; i < 500; i++)
+		{
+			HostSim::Advance(1000);
+			// Straight off the atomic, without the CPU, the way the UI task reads it
+			const auto start = std::chrono::steady_clock::now();
+			const int32_t steps = position.GetSteps();
+			readCost.Add(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+			lag.Add(std::abs(GetPosition() - zero - steps));
+		}
+		SetPin(LEFTPIN, 0);
+		WaitForStopped();
+		HostSim::Advance(50000);
+
+		const int32_t moved = GetPosition() - zero;
+		const int32_t shown = position.GetSteps();
+		lag.Print("readout behind the motor", "steps");
+		readCost.Print("GetSteps()", "ns host");
+		printf("  %-34s %d steps moved, %d shown (%.3f mm)\n", "after stopping", moved, shown, position.GetMm());
+	}
+
+	// Runs up to aSpeed and into a soft limit far enough away to reach it, on a fresh Stepper
+	// each time. The error is where the motor came to rest against the limit.
+	void BenchSoftLimit(std::unique_ptr<StepGenerator> aBackend, Stepper::RampProfile aProfile, int32_t aSpeed,
+						Samples &anError, Samples &aLastSpeed)
+	{
+		static std::vector<std::shared_ptr<Stepper>> steppers; // their ramp tasks run forever
+		StepGenerator *backend = aBackend.get();
+		std::shared_ptr<Stepper> stepper;
+		int32_t limit;
+		{
+			HostSim::CpuLock cpu;
+			stepper = std::make_shared<Stepper>(std::move(aBackend));
+			stepper->Init(BENCH_DIR_PIN, BENCH_ENABLE_PIN, BENCH_STEP_PIN, aSpeed, aSpeed);
+			stepper->SetRampProfile(aProfile);
+			stepper->SetRapidSpeed();
+			limit = backend->GetPosition() + 2000 + static_cast<int32_t>(static_cast<int64_t>(aSpeed) * aSpeed / acceleration);
+			stepper->SetLeftLimit(limit);
+			stepper->MoveLeft();
+		}
+		steppers.push_back(stepper);
+
+		HostSim::AdvanceUntil([&] { return stepper->IsStopped(); }, 20000000, 100);
+		anError.Add(Read<int32_t>([&] { return backend->GetPosition(); }) - limit);
+		if (RecordingStepGenerator *recorder = dynamic_cast<RecordingStepGenerator *>(backend))
+		{
+			// A late brake shows up as a last step at speed, cut short by the limit
+			HostSim::CpuLock cpu;
+			const std::vector<RecordingStepGenerator::Pulse> &pulses = recorder->GetPulses();
+			aLastSpeed.Add(static_cast<double>(StepGenerator::TICKS_PER_SECOND) /
+						   (pulses[pulses.size() - 1].myTick - pulses[pulses.size() - 2].myTick));
+		}
+		{
+			HostSim::CpuLock cpu;
+			stepper->Stop();
+		}
+	}
+
+	void BenchSoftLimits()
+	{
+		printf("Soft limit stopping error (left limit, speeds 500 to %d steps/s, + is past the limit)\n",
+			   BENCH_RAPID_SPEED);
+		const std::pair<Stepper::RampProfile, const char *> profiles[] = {
+			{Stepper::RampProfile::Linear, "linear"},
+			{Stepper::RampProfile::SCurve, "S-curve"},
+			{Stepper::RampProfile::LinearTable, "table driven linear"}};
+		for (const auto &profile : profiles)
+		{
+			for (int recording = 0; recording < 2; recording++)
+			{
+				Samples error;
+				Samples lastSpeed;
+				for (int32_t speed = 500; speed <= BENCH_RAPID_SPEED; speed += 500)
+				{
+					std::unique_ptr<StepGenerator> backend(recording ? static_cast<StepGenerator *>(new RecordingStepGenerator(acceleration))
+																	 : new FastAccelStepperBackend());
+					BenchSoftLimit(std::move(backend), profile.first, speed, error, lastSpeed);
+				}
+				const std::string name = std::string(recording ? "recording, " : "FastAccelStepper, ") + profile.second;
+				error.Print(name.c_str(), "steps");
+				if (recording)
+				{
+					lastSpeed.Print("  speed of the last step", "steps/s");
+				}
+			}
+		}
+	}
+
+	// Reciprocates over CYCLE_STEPS at normal speed through the state machine. Pass time is what
+	// StateMachine measures between reversals, dwell is how long the table sits still at each end.
+	void BenchCycle(Stepper::RampProfile aProfile, const char *aName)
+	{
+		constexpr int32_t CYCLE_STEPS = 2000;
+		constexpr uint32_t PASSES = 6;
+		{
+			HostSim::CpuLock cpu;
+			myStepper->SetRampProfile(aProfile);
+		}
+		const int32_t start = GetPosition();
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventPublisher::PublishEvent<Event::SetCycleLeft>(COMMAND_EVENT, start + CYCLE_STEPS));
+			ESP_ERROR_CHECK(EventPublisher::PublishEvent<Event::SetCycleRight>(COMMAND_EVENT, start));
+			ESP_ERROR_CHECK(EventPublisher::PublishEvent(COMMAND_EVENT, Event::StartCycle));
+		}
+
+		Samples dwell;
+		int32_t last = start;
+		int direction = 0;
+		uint64_t lastChange = HostSim::NowUs();
+		HostSim::AdvanceUntil(
+			[&] {
+				const int32_t position = HostFastAccelStepper::Get(stepPinStepper)->getCurrentPosition();
+				if (position != last)
+				{
+					const int newDirection = position > last ? 1 : -1;
+					if (direction && newDirection != direction)
+					{
+						dwell.Add((HostSim::NowUs() - lastChange) / 1000.0);
+					}
+					direction = newDirection;
+					lastChange = HostSim::NowUs();
+					last = position;
+				}
+				return myState->GetCycleStats().myPasses >= PASSES;
+			},
+			60000000, 50);
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventPublisher::PublishEvent(COMMAND_EVENT, Event::StopCycle));
+		}
+		WaitForStopped();
+
+		const StateMachine::CycleStats stats = Read<StateMachine::CycleStats>([] { return myState->GetCycleStats(); });
+		printf("  %-34s %u passes, min %8.2f mean %8.2f max %8.2f ms\n", aName, stats.myPasses,
+			   stats.myMinPassUs / 1000.0, stats.myTotalPassUs / 1000.0 / std::max<uint32_t>(stats.myPasses, 1),
+			   stats.myMaxPassUs / 1000.0);
+		dwell.Print("  dwell at the ends", "ms");
+	}
+
+	void BenchCycles()
+	{
+		printf("Reciprocating cycle (2000 steps at %d steps/s, time per pass)\n", BENCH_NORMAL_SPEED);
+		BenchCycle(Stepper::RampProfile::Linear, "linear");
+		BenchCycle(Stepper::RampProfile::SCurve, "S-curve");
+		BenchCycle(Stepper::RampProfile::LinearTable, "table driven linear");
+		HostSim::CpuLock cpu;
+		myStepper->SetRampProfile(Stepper::DEFAULT_RAMP_PROFILE);
+	}
+
+	// Left jog at normal speed, then the switch goes over to the right 20 ms after letting go
+	// of the left one. Timed from the left release to full speed the other way, against
+	// waiting for State::Stopped before pressing right, which was the only way before.
+	void BenchReversal(Stepper::RampProfile aProfile, const char *aName)
+	{
+		{
+			HostSim::CpuLock cpu;
+			myStepper->SetRampProfile(aProfile);
+		}
+		auto atSpeed = [](int32_t aSpeed) {
+			return [aSpeed] { return myStepper->GetBackend().GetCurrentSpeed() * aSpeed >= aSpeed * aSpeed - std::abs(aSpeed); };
+		};
+
+		SetPin(LEFTPIN, 1);
+		HostSim::AdvanceUntil(atSpeed(BENCH_NORMAL_SPEED), 2000000, 100);
+		HostSim::Advance(50000);
+		SetPin(LEFTPIN, 0);
+		uint64_t released = HostSim::NowUs();
+		HostSim::Advance(20000);
+		SetPin(RIGHTPIN, 1);
+		int32_t last = GetPosition();
+		uint64_t lastChange = HostSim::NowUs();
+		uint64_t longestGap = 0;
+		HostSim::AdvanceUntil(
+			[&] {
+				const int32_t position = HostFastAccelStepper::Get(stepPinStepper)->getCurrentPosition();
+				if (position != last)
+				{
+					longestGap = std::max(longestGap, HostSim::NowUs() - lastChange);
+					lastChange = HostSim::NowUs();
+					last = position;
+				}
+				return atSpeed(-BENCH_NORMAL_SPEED)();
+			},
+			2000000, 50);
+		const double reversed = (HostSim::NowUs() - released) / 1000.0;
+		SetPin(RIGHTPIN, 0);
+		WaitForStopped();
+
+		SetPin(LEFTPIN, 1);
+		HostSim::AdvanceUntil(atSpeed(BENCH_NORMAL_SPEED), 2000000, 100);
+		HostSim::Advance(50000);
+		SetPin(LEFTPIN, 0);
+		released = HostSim::NowUs();
+		WaitForStopped();
+		SetPin(RIGHTPIN, 1);
+		HostSim::AdvanceUntil(atSpeed(-BENCH_NORMAL_SPEED), 2000000, 100);
+		const double sequential = (HostSim::NowUs() - released) / 1000.0;
+		SetPin(RIGHTPIN, 0);
+		WaitForStopped();
+
+		printf("  %-34s %8.2f ms (longest step gap %5.2f ms), waiting for Stopped %8.2f ms\n", aName, reversed,
+			   longestGap / 1000.0, sequential);
+	}
+
+	void BenchReversals()
+	{
+		printf("Direction reversal (left release -> full speed right, %d steps/s)\n", BENCH_NORMAL_SPEED);
+		BenchReversal(Stepper::RampProfile::Linear, "linear");
+		BenchReversal(Stepper::RampProfile::SCurve, "S-curve");
+		BenchReversal(Stepper::RampProfile::LinearTable, "table driven linear");
+		HostSim::CpuLock cpu;
+		myStepper->SetRampProfile(Stepper::DEFAULT_RAMP_PROFILE);
+	}
+
+	// Drives a simulated table through BACKLASH steps of lost motion from the recording
+	// backend's pulses: the table sits between motor - BACKLASH and motor and only moves when
+	// pushed. Each run goes out and back twice, starting from the same side Position assumes.
+	void BenchBacklash(Stepper::RampProfile aProfile, const char *aName, int32_t aCompensation)
+	{
+		constexpr int32_t BACKLASH = 120;
+		constexpr int32_t TRAVEL = 1500;
+		static std::vector<std::shared_ptr<Stepper>> steppers; // their ramp tasks run forever
+		auto *recorder = new RecordingStepGenerator(acceleration);
+		std::shared_ptr<Stepper> stepper;
+		{
+			HostSim::CpuLock cpu;
+			stepper = std::make_shared<Stepper>(std::unique_ptr<StepGenerator>(recorder));
+			stepper->Init(BENCH_DIR_PIN, BENCH_ENABLE_PIN, BENCH_STEP_PIN, BENCH_RAPID_SPEED, BENCH_NORMAL_SPEED);
+			stepper->SetRampProfile(aProfile);
+			stepper->SetBacklash(aCompensation);
+			stepper->GetPosition().Zero();
+		}
+		steppers.push_back(stepper);
+		HostSim::Advance(50000);
+
+		for (const int32_t target : {TRAVEL, 0, TRAVEL})
+		{
+			{
+				HostSim::CpuLock cpu;
+				stepper->MoveTo(target);
+			}
+			HostSim::Advance(1000);
+			HostSim::AdvanceUntil([&] { return stepper->IsStopped(); }, 5000000, 100);
+		}
+		HostSim::Advance(50000);
+
+		Samples lostMotion;
+		int32_t motor = 0;
+		int32_t table = 0;
+		uint64_t reversalTick = 0;
+		bool waiting = false;
+		bool forward = false;
+		{
+			HostSim::CpuLock cpu;
+			for (const RecordingStepGenerator::Pulse &pulse : recorder->GetPulses())
+			{
+				if (pulse.myForward != forward || reversalTick == 0)
+				{
+					forward = pulse.myForward;
+					reversalTick = pulse.myTick;
+					waiting = true;
+				}
+				motor += pulse.myForward ? 1 : -1;
+				const int32_t before = table;
+				table = std::min(std::max(table, motor - BACKLASH), motor);
+				if (waiting && table != before)
+				{
+					lostMotion.Add(static_cast<double>(pulse.myTick - reversalTick) * 1000 / StepGenerator::TICKS_PER_SECOND);
+					waiting = false;
+				}
+			}
+		}
+		const int32_t shown = Read<int32_t>([&] { return stepper->GetPosition().GetSteps(); });
+		char name[64];
+		snprintf(name, sizeof(name), "%s, %s", aName, aCompensation ? "compensated" : "uncompensated");
+		lostMotion.Print(name, "ms lost");
+		printf("  %-34s table %d, motor %d, position shows %d steps\n", "", table, motor, shown);
+	}
+
+	void BenchBacklashes()
+	{
+		printf("Backlash take-up (120 steps of lost motion, %d step moves out and back at %d steps/s)\n", 1500,
+			   BENCH_NORMAL_SPEED);
+		BenchBacklash(Stepper::RampProfile::SCurve, "S-curve", 0);
+		BenchBacklash(Stepper::RampProfile::SCurve, "S-curve", 120);
+		BenchBacklash(Stepper::RampProfile::LinearTable, "table driven linear", 0);
+		BenchBacklash(Stepper::RampProfile::LinearTable, "table driven linear", 120);
+		BenchBacklash(Stepper::RampProfile::Linear, "linear", 120);
+	}
+
+	// Heap allocations made while posting and dispatching N payloads through the event bus
+	// alone, to a handler that does nothing, so nothing but the bus can allocate.
+	double EventBusAllocationsPerPost(int aPosts)
+	{
+		static uint32_t received = 0;
+		static bool registered = false;
+		if (!registered)
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventBus::Register(BENCH_EVENT, ESP_EVENT_ANY_ID,
+											   [](void *, esp_event_base_t, int32_t, void *) { received++; }, nullptr));
+			registered = true;
+		}
+
+		const uint64_t before = gAllocations.load();
+		for (int i = 0; i < aPosts; i++)
+		{
+			{
+				HostSim::CpuLock cpu;
+				ESP_ERROR_CHECK(EventPublisher::PublishEvent<Event::UpdateSpeed>(BENCH_EVENT, 1));
+			}
+			HostSim::RunUntilIdle();
+		}
+		return static_cast<double>(gAllocations.load() - before) / aPosts;
+	}
+
+	// Heap allocations made while posting and dispatching N payloads through the stand-in for
+	// the default esp_event loop, which copies each payload into a fresh block like the real one.
+	double EspEventAllocationsPerPost(int aPosts)
+	{
+		static bool created = false;
+		if (!created)
+		{
+			HostSim::CpuLock cpu;
+			esp_event_loop_create_default();
+			created = true;
+		}
+
+		const uint64_t before = gAllocations.load();
+		for (int i = 0; i < aPosts; i++)
+		{
+			{
+				HostSim::CpuLock cpu;
+				const SingleValueEventData<int32_t> eventData(1);
+				ESP_ERROR_CHECK(esp_event_post(COMMAND_EVENT, static_cast<int32_t>(Event::UpdateSpeed), &eventData,
+											   sizeof(eventData), portMAX_DELAY));
+			}
+			HostSim::RunUntilIdle();
+		}
+		return static_cast<double>(gAllocations.load() - before) / aPosts;
+	}
+
+	// Host CPU from posting a command to the state machine having handled it, through a
+	// producer's ring straight into the motion task, or through the event bus, which hands it
+	// on from its dispatch task. ClearLimits has no side effects, so only the transport counts.
+	// The bench posts with the simulated CPU held, so it never runs alongside the real producer.
+	void BenchCommandPaths()
+	{
+		constexpr int COMMANDS = 5000;
+		printf("Command delivery to the state machine (%d commands, post until handled, host CPU)\n", COMMANDS);
+
+		const auto measure = [](const std::function<void()> &aPost) {
+			Samples samples;
+			for (int i = 0; i < COMMANDS; i++)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				{
+					HostSim::CpuLock cpu;
+					aPost();
+				}
+				HostSim::RunUntilIdle();
+				samples.Add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+			}
+			return samples;
+		};
+
+		const Samples ring = measure([] { myState->GetSwitchCommands().Post(Event::ClearLimits); });
+		const Samples bus = measure([] { ESP_ERROR_CHECK(EventPublisher::PublishEvent(COMMAND_EVENT, Event::ClearLimits)); });
+		ring.Print("command ring", "us");
+		bus.Print("event bus", "us");
+	}
+
+	// The report the console's trace command prints, over switch presses and speed changes.
+	// Latency is on the virtual clock, handler time is host CPU.
+	// The histogram against 1000 samples of 100 ns to 100 us, with each percentile worked out
+	// here from the sorted samples and the bucket bounds PercentileNs documents
+	bool CheckHistogram()
+	{
+		constexpr uint32_t SAMPLES = 1000;
+		EventTrace::Histogram histogram = {};
+		std::vector<uint32_t> values;
+		uint64_t total = 0;
+		for (uint32_t i = 1; i <= SAMPLES; i++)
+		{
+			values.push_back(i * 100);
+			histogram.Add(values.back());
+			total += values.back();
+		}
+
+		bool met = histogram.myCount == SAMPLES && histogram.myMaxNs == values.back() && histogram.myTotalNs == total;
+		for (const float fraction : {0.0f, 0.1f, 0.5f, 0.9f, 0.99f})
+		{
+			const uint32_t value = values[std::min<size_t>(static_cast<size_t>(fraction * SAMPLES), SAMPLES - 1)];
+			uint32_t bound = EventTrace::FIRST_BUCKET_NS;
+			while (value >= bound)
+			{
+				bound <<= 1;
+			}
+			met = met && histogram.PercentileNs(fraction) == std::min(bound, values.back());
+		}
+		printf("  %-34s %s\n", "histogram, 1000 known samples", met ? "met" : "NOT MET");
+		return met;
+	}
+
+	// Events published together to a handler that is Busy for a known time, so each waits for
+	// the handlers of those ahead of it. The bus latencies come out at whole multiples of it.
+	bool CheckTracedLatency()
+	{
+		constexpr int EVENTS = 10;
+		constexpr uint64_t HANDLER_US = 200;
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventBus::Register(TRACE_EVENT, ESP_EVENT_ANY_ID,
+											   [](void *, esp_event_base_t, int32_t, void *) { HostSim::Busy(HANDLER_US); },
+											   nullptr));
+			EventTrace::Reset();
+			for (int i = 0; i < EVENTS; i++)
+			{
+				EventPublisher::PublishEvent(TRACE_EVENT, Event::ToggleView);
+			}
+		}
+		HostSim::Advance(EVENTS * HANDLER_US + 10000);
+
+		HostSim::CpuLock cpu;
+		const EventTrace::Histogram &latency = EventTrace::GetLatency(EventTrace::Path::Bus, Event::ToggleView);
+		const bool met = latency.myCount == EVENTS && latency.myMaxNs == (EVENTS - 1) * HANDLER_US * 1000 &&
+						 latency.myTotalNs == EVENTS * (EVENTS - 1) / 2 * HANDLER_US * 1000 &&
+						 EventTrace::GetHandlerTime(EventTrace::Path::Bus, Event::ToggleView).myCount == EVENTS;
+		printf("  %-34s %s (max %.1f us, mean %.1f us)\n", "bus latency, 200 us handlers", met ? "met" : "NOT MET",
+			   latency.myMaxNs / 1000.0, latency.myTotalNs / 1000.0 / std::max<uint32_t>(latency.myCount, 1));
+		return met;
+	}
+
+	// The histograms checked against known inputs, then the trace of ordinary traffic. Nothing
+	// takes time on the virtual clock unless it is Busy, so the latencies in that trace are 0
+	// and handler times are the host's CPU time; they show the trace is recorded, not what
+	// the S2 would take. Returns false if a check failed.
+	bool BenchEventTrace()
+	{
+		printf("Event trace (checks, then 20 left switch presses and 20 speed changes)\n");
+		const bool histogramMet = CheckHistogram();
+		const bool latencyMet = CheckTracedLatency();
+
+		{
+			HostSim::CpuLock cpu;
+			EventTrace::Reset();
+		}
+		for (int i = 0; i < 20; i++)
+		{
+			SetPin(LEFTPIN, 1);
+			HostSim::Advance(300000);
+			SetPin(LEFTPIN, 0);
+			WaitForStopped();
+			PostSpeedDelta((i & 1) ? -10 : 10);
+			HostSim::Advance(10000);
+		}
+
+		HostSim::CpuLock cpu;
+		printf("  latencies below are 0 on the virtual clock, handler times are host CPU time\n");
+		EventTrace::Print();
+		return histogramMet && latencyMet;
+	}
+
+	// Stops while the event bus is kept busy with low priority events, each costing its
+	// handler FLOOD_HANDLER_US, against the same stops with the bus quiet. Half come from
+	// the left switch, half are published on the bus partway through a flood, like a stop
+	// from the UI. Either should wait for at most the one handler already running, however
+	// many are queued. Returns false if one didn't.
+	bool BenchStopUnderFlood()
+	{
+		constexpr int STOPS = 10;
+		constexpr int FLOOD_EVENTS = 24;
+		constexpr uint64_t FLOOD_HANDLER_US = 500;
+		constexpr uint64_t FLOOD_PERIOD_US = 20000;
+		printf("Stop latency under a flood (%d events of %llu us every %llu ms on the event bus, %d stops)\n",
+			   FLOOD_EVENTS, static_cast<unsigned long long>(FLOOD_HANDLER_US),
+			   static_cast<unsigned long long>(FLOOD_PERIOD_US / 1000), STOPS);
+
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventBus::Register(FLOOD_EVENT, ESP_EVENT_ANY_ID,
+											   [](void *, esp_event_base_t, int32_t, void *) { HostSim::Busy(FLOOD_HANDLER_US); },
+											   nullptr));
+		}
+
+		// Called with the CPU held, so nothing runs until the whole flood and the stop are in
+		const auto flood = [] {
+			for (int i = 0; i < FLOOD_EVENTS; i++)
+			{
+				EventPublisher::PublishEvent(FLOOD_EVENT, Event::ToggleView);
+			}
+		};
+
+		// Timer callbacks keep running through a busy handler, so one polling the state
+		// times the stop to the poll period, where the bench's own polling would wait out the flood
+		uint64_t stoppedAt = 0;
+		std::function<void()> watch = [&] {
+			if (myState->GetState() != State::MovingLeft)
+			{
+				stoppedAt = HostSim::NowUs();
+				return;
+			}
+			HostSim::ScheduleCallback(HostSim::NowUs() + 50, watch);
+		};
+
+		Samples switchStop[2];
+		Samples busStop[2];
+		StateMachine::ResponseStats response[2];
+		for (const bool flooded : {false, true})
+		{
+			{
+				HostSim::CpuLock cpu;
+				EventTrace::Reset();
+				myState->ResetResponseStats();
+			}
+			for (int i = 0; i < STOPS; i++)
+			{
+				SetPin(LEFTPIN, 1);
+				HostSim::AdvanceUntil(IsMoving, 1000000, 100);
+				HostSim::Advance(100000);
+
+				const bool fromSwitch = (i & 1) == 0;
+				uint64_t stopAt;
+				{
+					HostSim::CpuLock cpu;
+					// Part way through the flood's handlers, at a different point in one each time
+					stopAt = HostSim::NowUs() + (fromSwitch ? 0 : 3000 + (i * 173) % FLOOD_HANDLER_US);
+					stoppedAt = 0;
+					if (flooded)
+					{
+						flood();
+					}
+					if (fromSwitch)
+					{
+						HostGpio::SetLevel(LEFTPIN, 0);
+					}
+					else
+					{
+						HostSim::ScheduleCallback(stopAt, [] {
+							ESP_ERROR_CHECK(EventPublisher::PublishEvent(COMMAND_EVENT, Event::StopMoveLeft));
+						});
+					}
+					HostSim::ScheduleCallback(stopAt, watch);
+				}
+
+				// Keep the flood going through the stop, until the motion has ended and SetStopped is in
+				for (int period = 0; period < 100 && Read<bool>([] { return myState->GetState() != State::Stopped; }); period++)
+				{
+					HostSim::Advance(FLOOD_PERIOD_US);
+					if (flooded)
+					{
+						HostSim::CpuLock cpu;
+						flood();
+					}
+				}
+				(fromSwitch ? switchStop : busStop)[flooded].Add((stoppedAt - stopAt) / 1000.0);
+				SetPin(LEFTPIN, 0);
+				WaitForStopped();
+				HostSim::Advance(100000);
+			}
+			response[flooded] = Read<StateMachine::ResponseStats>([] { return myState->GetResponseStats(); });
+		}
+
+		switchStop[0].Print("switch release -> Stop(), quiet", "ms");
+		switchStop[1].Print("switch release -> Stop(), flooded", "ms");
+		busStop[0].Print("published stop -> Stop(), quiet", "ms");
+		busStop[1].Print("published stop -> Stop(), flooded", "ms");
+		for (const bool flooded : {false, true})
+		{
+			const StateMachine::ResponseStats &stats = response[flooded];
+			printf("  %-34s n=%-4u worst=%7.2f ms (%s), stops worst=%7.2f ms\n",
+				   flooded ? "motion task response, flooded" : "motion task response, quiet", stats.myCommands,
+				   stats.myWorstUs / 1000.0, EventTrace::GetName(static_cast<int32_t>(stats.myWorstEvent)),
+				   stats.myWorstStopUs / 1000.0);
+		}
+
+		HostSim::CpuLock cpu;
+		const EventTrace::Histogram &stopped = EventTrace::GetLatency(EventTrace::Path::Motion, Event::SetStopped);
+		const EventTrace::Histogram &flooding = EventTrace::GetLatency(EventTrace::Path::Bus, Event::ToggleView);
+		printf("  %-34s n=%-4u max=%9.2f ms\n", "SetStopped -> state machine", stopped.myCount, stopped.myMaxNs / 1e6);
+		printf("  %-34s n=%-4u max=%9.2f ms\n", "flood event -> its handler", flooding.myCount, flooding.myMaxNs / 1e6);
+
+		// The watch polls every 50 us, so allow for that on top of the handler
+		const double boundMs = (FLOOD_HANDLER_US + 50) / 1000.0;
+		const bool met = switchStop[1].Percentile(1) <= switchStop[0].Percentile(1) + boundMs &&
+						 busStop[1].Percentile(1) <= busStop[0].Percentile(1) + boundMs &&
+						 stopped.myMaxNs <= FLOOD_HANDLER_US * 1000;
+		printf("  %-34s %s (quiet + one handler, %.2f ms)\n", "stop latency bound", met ? "met" : "EXCEEDED", boundMs);
+		return met;
+	}
+
+	constexpr int STALL_POSTS = 60;
+	constexpr TickType_t STALL_TICKS = 50;
+	// Cycled through, so coalescing has something to merge. None of them is urgent.
+	constexpr Event STALL_IDS[] = {Event::ToggleView, Event::ToggleUnits, Event::ZeroPosition, Event::ClearLimits};
+	TaskHandle_t gStallProducer = nullptr;
+	bool gStallNext = false;
+	bool gStallPosted = false;
+	uint32_t gStallDelivered = 0;
+
+	// Posts at the motion task's priority, which on the machine publishes state changes,
+	// speeds and settings while the display may be stuck
+	void StallProducerTask(void *)
+	{
+		while (true)
+		{
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			for (int i = 0; i < STALL_POSTS; i++)
+			{
+				EventPublisher::PublishEvent(STALL_EVENT, STALL_IDS[i % 4]);
+				vTaskDelay(1);
+			}
+			gStallPosted = true;
+		}
+	}
+
+	// The display's handler waiting on a slow I2C transfer, which holds up the dispatch task
+	// and everything queued behind it for STALL_TICKS
+	void StallHandler(void *, esp_event_base_t, int32_t, void *)
+	{
+		gStallDelivered++;
+		if (gStallNext)
+		{
+			gStallNext = false;
+			vTaskDelay(STALL_TICKS);
+		}
+	}
+
+	// A handler stalls while events keep coming, once for each overflow policy. Block holds
+	// the producer up, the others keep it going and lose events instead, the oldest or
+	// superseded ones for DropOldest and Coalesce. None of them aborts.
+	void BenchBusOverflow()
+	{
+		printf("Event bus overflow (a handler blocked %u ms, %d events posted 1 ms apart meanwhile, %zu queue slots)\n",
+			   STALL_TICKS, STALL_POSTS, EventBus::QUEUE_LENGTH);
+		{
+			HostSim::CpuLock cpu;
+			ESP_ERROR_CHECK(EventBus::Register(STALL_EVENT, ESP_EVENT_ANY_ID, StallHandler, nullptr));
+			xTaskCreatePinnedToCore(StallProducerTask, "StallProducer", 4096, nullptr, configMAX_PRIORITIES - 4,
+									&gStallProducer, 0);
+		}
+		printf("  %-12s %7s %7s %7s %9s %9s %5s %11s\n", "policy", "posted", "refused", "dropped", "coalesced",
+			   "delivered", "high", "max blocked");
+
+		for (const EventBus::OverflowPolicy policy :
+			 {EventBus::OverflowPolicy::Block, EventBus::OverflowPolicy::Reject, EventBus::OverflowPolicy::DropOldest,
+			  EventBus::OverflowPolicy::Coalesce})
+		{
+			{
+				HostSim::CpuLock cpu;
+				EventBus::SetOverflowPolicy(STALL_EVENT, policy);
+				EventBus::ResetStats();
+				gStallNext = true;
+				gStallPosted = false;
+				gStallDelivered = 0;
+				EventPublisher::PublishEvent(STALL_EVENT, Event::ToggleView);
+				xTaskNotifyGive(gStallProducer);
+			}
+			HostSim::AdvanceUntil([] { return gStallPosted; }, 2000000, 1000);
+			HostSim::Advance(100000);
+
+			HostSim::CpuLock cpu;
+			EventBus::BaseStats stats;
+			for (size_t slot = 0; EventBus::GetBaseStats(slot, stats) && stats.myBase != STALL_EVENT; slot++)
+			{
+			}
+			// Less the one that started the stall
+			printf("  %-12s %7u %7u %7u %9u %9u %5zu %8.2f ms\n", EventBus::GetPolicyName(policy), stats.myPosted - 1,
+				   stats.myRefused, stats.myDropped, stats.myCoalesced, gStallDelivered - 1, stats.myHighWater,
+				   stats.myMaxBlockedUs / 1000.0);
+		}
+
+		HostSim::CpuLock cpu;
+		EventBus::SetOverflowPolicy(STALL_EVENT, EventBus::OverflowPolicy::Block);
+		EventBus::PrintStats();
+	}
+
+	// An encoder spun fast while the motion task is busy: deltas pile up in its ring, and
+	// the motion task merges whatever is queued into one speed change. The bench stands in
+	// for the encoder task as the ring's producer, the dial isn't turning meanwhile.
+	void BenchSpeedCoalescing()
+	{
+		constexpr int DELTAS = 64;
+		constexpr int32_t DELTA = 5;
+		printf("Speed update coalescing (%d encoder deltas of %d steps/s, queued in bursts)\n", DELTAS, DELTA);
+
+		for (const int burst : {1, 4, 16})
+		{
+			const StateMachine::SpeedUpdateStats before = Read<StateMachine::SpeedUpdateStats>([] { return myState->GetSpeedUpdateStats(); });
+			const int32_t speedBefore = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+			EventBus::ResetStats();
+			for (int i = 0; i < DELTAS; i += burst)
+			{
+				{
+					HostSim::CpuLock cpu;
+					for (int j = 0; j < burst; j++)
+					{
+						myState->GetEncoderCommands().Post<Event::UpdateSpeed>(DELTA);
+					}
+				}
+				HostSim::RunUntilIdle();
+			}
+			const StateMachine::SpeedUpdateStats after = Read<StateMachine::SpeedUpdateStats>([] { return myState->GetSpeedUpdateStats(); });
+			const int32_t speedAfter = Read<int32_t>([] { return mySettings->Get()->myNormalSpeed; });
+			const EventBus::Stats bus = EventBus::GetStats();
+
+			char name[64];
+			snprintf(name, sizeof(name), "bursts of %d", burst);
+			printf("  %-34s %3u received, %3u applied, %3u merged, largest batch %u\n", name,
+				   after.myReceived - before.myReceived, after.myApplied - before.myApplied,
+				   after.myMerged - before.myMerged, after.myLargestBatch);
+			printf("  %-34s %3u save and screen events, speed %d -> %d\n", "", bus.myDispatched, speedBefore, speedAfter);
+
+			// Put the speed back for whatever runs next
+			PostSpeedDelta(speedBefore - speedAfter);
+			HostSim::RunUntilIdle();
+		}
+	}
+
+	void BenchEventThroughput()
+	{
+		constexpr int EVENTS = 20000;
+		constexpr int BATCH = EventBus::QUEUE_LENGTH / 2;
+		printf("Speed update throughput (%d UpdateSpeed commands through the event bus)\n", EVENTS);
+
+		// Let the first pass grow whatever the simulator keeps, then count from a steady state
+		PostSpeedDelta(1);
+		PostSpeedDelta(-1);
+		HostSim::RunUntilIdle();
+
+		EventBus::ResetStats();
+		const uint64_t allocationsBefore = gAllocations.load();
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < EVENTS; i += BATCH)
+		{
+			for (int j = 0; j < BATCH; j++)
+			{
+				PostSpeedDelta((j & 1) ? -1 : 1);
+			}
+			HostSim::RunUntilIdle();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		const uint64_t allocations = gAllocations.load() - allocationsBefore;
+		const double seconds = std::chrono::duration<double>(elapsed).count();
+		const EventBus::Stats stats = EventBus::GetStats();
+
+		printf("  %-34s %9u (%.2f per command)\n", "events dispatched", stats.myDispatched,
+			   static_cast<double>(stats.myDispatched) / EVENTS);
+		// Settings restarts its save timer on every speed change, and the host esp_timer keeps
+		// its callbacks in a std::multimap, so that costs one allocation per command here.
+		printf("  %-34s %9.2f per command (host esp_timer list)\n", "heap allocations",
+			   static_cast<double>(allocations) / EVENTS);
+		printf("  %-34s %9.2f per event\n", "allocations, event bus alone", EventBusAllocationsPerPost(1000));
+		printf("  %-34s %9.2f per event\n", "allocations, esp_event stand-in", EspEventAllocationsPerPost(1000));
+		printf("  %-34s %9.0f commands/s (%.0f ns each, host CPU)\n", "throughput", EVENTS / seconds,
+			   seconds * 1e9 / EVENTS);
+		printf("  %-34s %9zu of %zu\n", "queue high water", stats.myHighWater, EventBus::QUEUE_LENGTH);
+	}
+
+	// A short operator session through the pins, the encoder's ring and the command bus,
+	// recorded the way the machine records one. With a file name, the recording is written
+	// there for host_replay, which should play it back to the same outputs given the speeds
+	// the bench runs at (--normal 2000 --rapid 20000).
+	void BenchSessionCapture(const char *aFile)
+	{
+		printf("Session capture (jog left, rapid right, speed changes, reversal)\n");
+		{
+			HostSim::CpuLock cpu;
+			// As a freshly booted machine would be, apart from where the carriage is
+			myStepper->SetRampProfile(Stepper::DEFAULT_RAMP_PROFILE);
+			myStepper->ClearLimits();
+			EventRecorder::Clear();
+		}
+
+		SetPin(LEFTPIN, 1);
+		HostSim::Advance(400000);
+		SetPin(LEFTPIN, 0);
+		WaitForStopped();
+		HostSim::Advance(200000);
+
+		SetPin(RAPIDPIN, 1);
+		HostSim::Advance(100000);
+		SetPin(RIGHTPIN, 1);
+		HostSim::Advance(600000);
+		SetPin(RIGHTPIN, 0);
+		WaitForStopped();
+		SetPin(RAPIDPIN, 0);
+		HostSim::Advance(200000);
+
+		PostSpeedDelta(200);
+		HostSim::Advance(50000);
+		SetPin(LEFTPIN, 1);
+		HostSim::Advance(200000);
+		for (int i = 0; i < 3; i++)
+		{
+			{
+				HostSim::CpuLock cpu;
+				myState->GetEncoderCommands().Post<Event::UpdateSpeed>(-50);
+			}
+			HostSim::Advance(200000);
+		}
+		PostSpeedDelta(-50);
+		HostSim::Advance(100000);
+		SetPin(LEFTPIN, 0);
+		HostSim::Advance(60000);
+		SetPin(RIGHTPIN, 1);
+		HostSim::Advance(500000);
+		SetPin(RIGHTPIN, 0);
+		WaitForStopped();
+		HostSim::Advance(1000000);
+
+		HostSim::CpuLock cpu;
+		printf("  %-34s %9zu (%u overwritten)\n", "records", EventRecorder::GetCount(), EventRecorder::GetOverwritten());
+		if (aFile)
+		{
+			FILE *file = fopen(aFile, "w");
+			if (file)
+			{
+				EventRecorder::Dump(file);
+				fclose(file);
+				printf("  %-34s %s\n", "written to", aFile);
+			}
+			else
+			{
+				printf("  couldn't write %s\n", aFile);
+			}
+		}
+	}
+
+	// Which cells of the state machine's transition table everything above went through.
+	// A cell that is never taken is either missing from the benches or can't happen.
+	void BenchTransitionCoverage()
+	{
+		printf("State machine transition coverage, over every bench above\n");
+		HostSim::CpuLock cpu;
+		size_t cells = 0;
+		size_t taken = 0;
+		for (size_t state = 0; state < StateMachine::STATE_COUNT; state++)
+		{
+			const State current = static_cast<State>(state);
+			std::string missed;
+			size_t stateCells = 0;
+			size_t stateTaken = 0;
+			for (size_t id = 0; id < EVENT_COUNT; id++)
+			{
+				const Event event = static_cast<Event>(id);
+				if (!StateMachine::GetTransition(current, event).myAction)
+				{
+					continue;
+				}
+				stateCells++;
+				if (myState->GetTransitionCount(current, event))
+				{
+					stateTaken++;
+				}
+				else
+				{
+					missed += std::string(" ") + EventTrace::GetName(static_cast<int32_t>(id));
+				}
+			}
+			printf("  %-34s %4zu of %-3zu taken%s%s\n", StateMachine::GetStateName(current), stateTaken, stateCells,
+				   missed.empty() ? "" : ", not:", missed.c_str());
+			cells += stateCells;
+			taken += stateTaken;
+		}
+		printf("  %-34s %4zu of %-3zu (%.0f%%)\n", "all states", taken, cells, cells ? 100.0 * taken / cells : 0.0);
+	}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	bool verbose = false;
+	const char *captureFile = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-v") == 0)
+		{
+			verbose = true;
+		}
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+		{
+			captureFile = argv[++i];
+		}
+	}
+	esp_log_level_set("*", verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+	Setup();
+
+	BenchSwitchLatency(SwitchMode::Polling, "polling");
+	// What the firmware runs, and what the rest of the benches see
+	BenchSwitchLatency(SwitchMode::Interrupt, "edge interrupt");
+	const bool switchBounceMet = BenchSwitchBounce();
+	const bool encoderCurveMet = BenchEncoderCurve();
+	const bool encoderWakeupsMet = BenchEncoderWakeups();
+	BenchRamp(false, Stepper::RampProfile::Linear);
+	BenchRamp(true, Stepper::RampProfile::Linear);
+	BenchRamp(false, Stepper::RampProfile::SCurve);
+	BenchRamp(true, Stepper::RampProfile::SCurve);
+	BenchRamp(false, Stepper::RampProfile::LinearTable);
+	BenchRamp(true, Stepper::RampProfile::LinearTable);
+	BenchRampCompute();
+	BenchBackends();
+	BenchPosition();
+	BenchSoftLimits();
+	BenchCycles();
+	BenchReversals();
+	BenchBacklashes();
+	BenchCommandPaths();
+	const bool eventTraceMet = BenchEventTrace();
+	BenchSpeedCoalescing();
+	const bool stopBoundMet = BenchStopUnderFlood();
+	BenchBusOverflow();
+	BenchEventThroughput();
+	BenchSessionCapture(captureFile);
+	// After the capture, the double press zeroes the position
+	BenchButtonGestures();
+	BenchTransitionCoverage();
+
+	HostSim::Exit(switchBounceMet && stopBoundMet && encoderCurveMet && encoderWakeupsMet && eventTraceMet ? 0 : 1);
+}
@@ -0,0 +1,282 @@
+#include "RecordingStepGenerator.h"
+#include "HostSim.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	uint64_t NowTicks()
+	{
+		return HostSim::NowUs() * (StepGenerator::TICKS_PER_SECOND / 1000000);
+	}
+} // namespace
+
+void RecordingStepGenerator::Init(uint8_t, uint8_t, uint8_t)
+{
+}
+
+void RecordingStepGenerator::SetSpeed(uint32_t aStepsPerSecond)
+{
+	Update();
+	mySpeed = aStepsPerSecond;
+}
+
+void RecordingStepGenerator::Run(bool aForward)
+{
+	Update();
+	if (myMode == Mode::Queue || mySpeed == 0)
+	{
+		return;
+	}
+	if (myMode == Mode::Idle)
+	{
+		myForward = aForward;
+		myNextPulseTick = NowTicks();
+	}
+	myReversing = aForward != myForward;
+	myHasTarget = false;
+	myMode = Mode::Running;
+}
+
+void RecordingStepGenerator::RunTo(int32_t aPosition)
+{
+	Update();
+	if (aPosition == myPosition)
+	{
+		return;
+	}
+	Run(aPosition > myPosition);
+	myHasTarget = myMode == Mode::Running;
+	myTargetPosition = aPosition;
+}
+
+void RecordingStepGenerator::Stop()
+{
+	Update();
+	if (myMode == Mode::Running)
+	{
+		myReversing = false;
+		myMode = Mode::Stopping;
+	}
+}
+
+bool RecordingStepGenerator::IsStopped()
+{
+	Update();
+	return myMode == Mode::Idle;
+}
+
+int32_t RecordingStepGenerator::GetCurrentSpeed()
+{
+	Update();
+	double speed = myVelocity;
+	if (myMode == Mode::Queue)
+	{
+		const Command &command = myQueue.front();
+		speed = command.mySteps ? static_cast<double>(TICKS_PER_SECOND) / command.myTicks : 0;
+	}
+	return static_cast<int32_t>(myForward ? speed : -speed);
+}
+
+std::string RecordingStepGenerator::GetState()
+{
+	Update();
+	switch (myMode)
+	{
+	case Mode::Idle:
+		return "STOPPED";
+	case Mode::Stopping:
+		return "STOPPING";
+	default:
+		return "RUNNING";
+	}
+}
+
+int32_t RecordingStepGenerator::GetPosition()
+{
+	Update();
+	return myPosition;
+}
+
+StepGenerator::QueueResult RecordingStepGenerator::AddToQueue(const Command &aCommand)
+{
+	Update();
+	if (myQueue.size() == QUEUE_LENGTH)
+	{
+		return QueueResult::Full;
+	}
+	if (QueuedTicks(aCommand) < MIN_COMMAND_TICKS || (myMode != Mode::Idle && myMode != Mode::Queue))
+	{
+		return QueueResult::Rejected;
+	}
+	if (myQueue.empty())
+	{
+		myMode = Mode::Queue;
+		myCommandStartTick = NowTicks();
+		myCommandStepsDone = 0;
+	}
+	myQueue.push_back(aCommand);
+	return QueueResult::Ok;
+}
+
+bool RecordingStepGenerator::IsQueueFull()
+{
+	Update();
+	return myQueue.size() == QUEUE_LENGTH;
+}
+
+bool RecordingStepGenerator::IsQueueEmpty()
+{
+	Update();
+	return myQueue.empty();
+}
+
+uint8_t RecordingStepGenerator::GetQueueEntries()
+{
+	Update();
+	return static_cast<uint8_t>(myQueue.size());
+}
+
+bool RecordingStepGenerator::HasTicksInQueue(uint32_t aTicks)
+{
+	Update();
+	uint64_t ticks = 0;
+	for (const Command &command : myQueue)
+	{
+		ticks += QueuedTicks(command);
+	}
+	const uint64_t elapsed = myQueue.empty() ? 0 : NowTicks() - myCommandStartTick;
+	return ticks > elapsed && ticks - elapsed >= aTicks;
+}
+
+const std::vector<RecordingStepGenerator::Pulse> &RecordingStepGenerator::GetPulses()
+{
+	Update();
+	return myPulses;
+}
+
+const std::vector<uint64_t> &RecordingStepGenerator::GetDirectionChanges()
+{
+	Update();
+	return myDirectionChanges;
+}
+
+void RecordingStepGenerator::Clear()
+{
+	Update();
+	myPulses.clear();
+	myDirectionChanges.clear();
+}
+
+uint64_t RecordingStepGenerator::QueuedTicks(const Command &aCommand) const
+{
+	return static_cast<uint64_t>(aCommand.myTicks) * std::max<uint32_t>(aCommand.mySteps, 1);
+}
+
+void RecordingStepGenerator::AddPulse(uint64_t aTick, bool aForward)
+{
+	if (!myPulses.empty() && myPulses.back().myForward != aForward)
+	{
+		myDirectionChanges.push_back(aTick);
+	}
+	myPulses.push_back({aTick, aForward});
+	myPosition += aForward ? 1 : -1;
+}
+
+void RecordingStepGenerator::Update()
+{
+	const uint64_t now = NowTicks();
+	if (myMode == Mode::Queue)
+	{
+		UpdateQueue(now);
+	}
+	else if (myMode != Mode::Idle)
+	{
+		UpdateRamp(now);
+	}
+}
+
+void RecordingStepGenerator::UpdateRamp(uint64_t aNow)
+{
+	while (myMode != Mode::Idle && myNextPulseTick <= aNow)
+	{
+		AddPulse(myNextPulseTick, myForward);
+
+		// v^2 moves by 2a per step towards the target, or towards zero when stopping
+		const double target = myMode == Mode::Stopping || myReversing ? 0 : mySpeed;
+		const double squared = myVelocity * myVelocity;
+		if (myVelocity < target)
+		{
+			myVelocity = std::min(target, std::sqrt(squared + 2.0 * myAcceleration));
+		}
+		else if (myVelocity > target)
+		{
+			myVelocity = std::max(target, std::sqrt(std::max(0.0, squared - 2.0 * myAcceleration)));
+		}
+
+		if (myHasTarget && !myReversing)
+		{
+			// Never faster than stops with the last pulse on the target
+			const uint32_t remaining = std::abs(myTargetPosition - myPosition);
+			if (remaining == 0)
+			{
+				myVelocity = 0;
+				myHasTarget = false;
+			}
+			else if (myMode == Mode::Running)
+			{
+				myVelocity = std::max(std::min(myVelocity, std::sqrt(2.0 * myAcceleration * remaining)),
+									  std::sqrt(2.0 * myAcceleration));
+			}
+			else
+			{
+				myVelocity = std::min(myVelocity, std::sqrt(2.0 * myAcceleration * remaining));
+			}
+		}
+
+		if (myVelocity <= 0 && myReversing)
+		{
+			// Turned around, the first step the other way comes as it would from standstill
+			myReversing = false;
+			myForward = !myForward;
+			myVelocity = 0;
+			myNextPulseTick += static_cast<uint64_t>(TICKS_PER_SECOND / std::sqrt(2.0 * myAcceleration));
+			continue;
+		}
+		if (myVelocity <= 0)
+		{
+			myVelocity = 0;
+			myMode = Mode::Idle;
+			break;
+		}
+		myNextPulseTick += static_cast<uint64_t>(TICKS_PER_SECOND / myVelocity);
+	}
+}
+
+void RecordingStepGenerator::UpdateQueue(uint64_t aNow)
+{
+	while (!myQueue.empty())
+	{
+		const Command &command = myQueue.front();
+		myForward = command.myForward;
+
+		// A pulse goes out at the start of every ticks long period of the command.
+		while (myCommandStepsDone < command.mySteps &&
+			   myCommandStartTick + static_cast<uint64_t>(myCommandStepsDone) * command.myTicks <= aNow)
+		{
+			AddPulse(myCommandStartTick + static_cast<uint64_t>(myCommandStepsDone) * command.myTicks, myForward);
+			myCommandStepsDone++;
+		}
+
+		const uint64_t end = myCommandStartTick + QueuedTicks(command);
+		if (end > aNow)
+		{
+			return;
+		}
+		myCommandStartTick = end;
+		myCommandStepsDone = 0;
+		myQueue.erase(myQueue.begin());
+	}
+	myMode = Mode::Idle;
+}
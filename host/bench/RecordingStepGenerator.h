@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "StepGenerator.h"
+
+/**
+ * @brief Host backend that puts out its pulses on the HostSim virtual clock and keeps
+ * a log of every one of them, so the pulse train itself can be measured.
+ *
+ * Its own ramp accelerates at a fixed rate per step (v^2 changes by 2a every step) and
+ * runs through zero into a reversal, and
+ * the step queue behaves like FastAccelStepper's: 32 commands, none shorter than 200 us.
+ */
+class RecordingStepGenerator : public StepGenerator
+{
+  public:
+	struct Pulse
+	{
+		uint64_t myTick;
+		bool myForward;
+	};
+
+	explicit RecordingStepGenerator(uint32_t anAcceleration) : myAcceleration(anAcceleration) {}
+
+	void Init(uint8_t aDirPin, uint8_t anEnablePin, uint8_t aStepPin) override;
+	const char *GetName() override { return "Recording"; }
+
+	void SetSpeed(uint32_t aStepsPerSecond) override;
+	uint32_t GetTargetSpeed() override { return mySpeed; }
+	void Run(bool aForward) override;
+	void RunTo(int32_t aPosition) override;
+	void Stop() override;
+	bool IsStopped() override;
+	int32_t GetCurrentSpeed() override;
+	std::string GetState() override;
+	int32_t GetPosition() override;
+
+	bool HasQueue() override { return true; }
+	uint32_t GetMinCommandTicks() override { return MIN_COMMAND_TICKS; }
+	QueueResult AddToQueue(const Command &aCommand) override;
+	bool IsQueueFull() override;
+	bool IsQueueEmpty() override;
+	uint8_t GetQueueEntries() override;
+	bool HasTicksInQueue(uint32_t aTicks) override;
+
+	const std::vector<Pulse> &GetPulses();
+	/**
+	 **@brief Ticks of the first pulse after each change of direction
+	 **/
+	const std::vector<uint64_t> &GetDirectionChanges();
+	void Clear();
+
+  private:
+	static constexpr size_t QUEUE_LENGTH = 32;
+	static constexpr uint32_t MIN_COMMAND_TICKS = TICKS_PER_SECOND / 5000;
+
+	enum class Mode
+	{
+		Idle,
+		Running,
+		Stopping,
+		Queue
+	};
+
+	/**
+	 **@brief Put out every pulse due up to now
+	 **/
+	void Update();
+	void UpdateRamp(uint64_t aNow);
+	void UpdateQueue(uint64_t aNow);
+	void AddPulse(uint64_t aTick, bool aForward);
+	uint64_t QueuedTicks(const Command &aCommand) const;
+
+	uint32_t myAcceleration;
+	uint32_t mySpeed = 0;
+	Mode myMode = Mode::Idle;
+	bool myForward = true;
+	// Set by RunTo, the ramp brakes to put its last pulse on myTargetPosition
+	bool myHasTarget = false;
+	int32_t myTargetPosition = 0;
+	// Run the other way while moving, the ramp goes down to zero and turns around
+	bool myReversing = false;
+	double myVelocity = 0;
+	uint64_t myNextPulseTick = 0;
+
+	std::vector<Command> myQueue;
+	uint64_t myCommandStartTick = 0;
+	uint32_t myCommandStepsDone = 0;
+
+	int32_t myPosition = 0;
+	std::vector<Pulse> myPulses;
+	std::vector<uint64_t> myDirectionChanges;
+};
@@ -0,0 +1,139 @@
+// Host stand-in for the parts of FastAccelStepper the firmware uses. Motion follows
+// either the library's linear ramp (one acceleration for speeding up and slowing down)
+// or raw commands added with addQueueEntry, and is integrated lazily against the
+// HostSim virtual clock whenever it is queried.
+#pragma once
+
+#include <stdint.h>
+// The ESP32 port of the library pulls in the GPIO driver, the firmware relies on that.
+#include "driver/gpio.h"
+
+#define MOVE_OK 0
+#define MOVE_ERR_NO_DIRECTION_PIN -1
+#define MOVE_ERR_SPEED_IS_UNDEFINED -2
+#define MOVE_ERR_ACCELERATION_IS_UNDEFINED -3
+
+#define PIN_UNDEFINED 0xff
+
+// ESP32 values
+#define TICKS_PER_S 16000000L
+#define QUEUE_LEN 32
+#define MIN_CMD_TICKS (TICKS_PER_S / 5000)
+#define MIN_DELTA_TICKS (TICKS_PER_S / 200000)
+
+#define AQE_OK 0
+#define AQE_QUEUE_FULL 1
+#define AQE_DIR_PIN_IS_BUSY 2
+#define AQE_ERROR_TICKS_TOO_LOW -1
+#define AQE_ERROR_EMPTY_QUEUE_TO_START -2
+#define AQE_ERROR_NO_DIR_PIN_TO_TOGGLE -3
+
+struct stepper_command_s
+{
+	uint16_t ticks;
+	uint8_t steps;
+	bool count_up;
+};
+
+class FastAccelStepper
+{
+  public:
+	explicit FastAccelStepper(uint8_t aStepPin) : myStepPin(aStepPin) {}
+
+	uint8_t getStepPin() { return myStepPin; }
+	void setDirectionPin(uint8_t dirPin, bool dirHighCountsUp = true, uint16_t dir_change_delay_us = 0);
+	void setEnablePin(uint8_t enablePin, bool low_active_enables_stepper = true);
+	void setAutoEnable(bool auto_enable);
+	int8_t setDelayToEnable(uint32_t delay_us);
+	void setDelayToDisable(uint16_t delay_ms);
+	void enableOutputs() {}
+	void disableOutputs() {}
+
+	int8_t setSpeedInHz(uint32_t speed_hz);
+	int8_t setSpeedInUs(uint32_t min_step_us);
+	uint32_t getSpeedInMilliHz();
+	int8_t setAcceleration(int32_t step_s_s);
+	int32_t getAcceleration();
+	void applySpeedAcceleration();
+
+	int8_t runForward();
+	int8_t runBackward();
+	/**
+	 * @brief Ramp to position and stop exactly on it, braking at the acceleration
+	 */
+	int8_t moveTo(int32_t position, bool blocking = false);
+	void stopMove();
+	void forceStop();
+	bool isRunning();
+	bool isStopping();
+
+	/**
+	 * @brief Signed current speed, negative while running backward
+	 */
+	int32_t getCurrentSpeedInMilliHz();
+	int32_t getCurrentPosition();
+	void setCurrentPosition(int32_t new_pos);
+
+	/**
+	 * @brief Raw step commands, each is steps pulses ticks apart (or a pause when steps is 0)
+	 */
+	int8_t addQueueEntry(const struct stepper_command_s *cmd, bool start = true);
+	bool isQueueEmpty();
+	bool isQueueFull();
+	/**
+	 * @brief Commands not finished yet, the one going out included
+	 */
+	uint8_t queueEntries();
+	bool hasTicksInQueue(uint32_t min_ticks);
+
+  private:
+	enum class Mode
+	{
+		Idle,
+		Running,
+		Stopping
+	};
+
+	void Integrate();
+	void IntegrateQueue(uint64_t aNowUs);
+	void IntegrateToTarget(double aSeconds);
+	int8_t Run(int8_t aDirection);
+	const stepper_command_s *CurrentCommand();
+
+	uint8_t myStepPin;
+	uint8_t myDirPin = PIN_UNDEFINED;
+	uint32_t mySpeedInHz = 0;
+	int32_t myAcceleration = 0;
+	Mode myMode = Mode::Idle;
+	int8_t myDirection = 1;
+	double myVelocity = 0;
+	double myTargetVelocity = 0;
+	double myPosition = 0;
+	// Set by moveTo, the motion brakes to land on myTargetPosition
+	bool myHasTarget = false;
+	int32_t myTargetPosition = 0;
+	uint64_t myLastUpdateUs = 0;
+
+	stepper_command_s myQueue[QUEUE_LEN];
+	uint8_t myQueueHead = 0;
+	uint8_t myQueueCount = 0;
+	// Start of the command at the head of the queue, in ticks of virtual time
+	uint64_t myCommandStartTicks = 0;
+	// Pulses of the head command that have already been emitted
+	uint8_t myCommandStepsDone = 0;
+};
+
+class FastAccelStepperEngine
+{
+  public:
+	void init(uint8_t cpu_core = 255);
+	FastAccelStepper *stepperConnectToPin(uint8_t step_pin);
+};
+
+/**
+ * @brief Bench access to the steppers created by the firmware
+ */
+namespace HostFastAccelStepper
+{
+	FastAccelStepper *Get(uint8_t aStepPin);
+}
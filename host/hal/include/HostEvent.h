@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bench side of the default event loop stand-in
+ */
+namespace HostEvent
+{
+	// Matches CONFIG_ESP_SYSTEM_EVENT_QUEUE_SIZE in sdkconfig
+	constexpr size_t QUEUE_SIZE = 32;
+
+	struct Stats
+	{
+		uint32_t myPosted = 0;
+		uint32_t myDispatched = 0;
+		uint32_t myTimeouts = 0;
+		size_t myHighWater = 0;
+		uint64_t myPayloadBytes = 0;
+	};
+
+	Stats GetStats();
+	void ResetStats();
+} // namespace HostEvent
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "driver/gpio.h"
+
+/**
+ * @brief Bench side of the GPIO stand-in
+ */
+namespace HostGpio
+{
+	/**
+	 * @brief Drive an input pin, running its ISR handler if the edge matches the
+	 ** configured interrupt type. Call while holding HostSim::CpuLock.
+	 */
+	void SetLevel(gpio_num_t aPin, int aLevel);
+
+	/**
+	 * @brief Last level written by the firmware with gpio_set_level
+	 */
+	int GetOutputLevel(gpio_num_t aPin);
+} // namespace HostGpio
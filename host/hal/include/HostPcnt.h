@@ -0,0 +1,15 @@
+#pragma once
+
+#include "driver/pcnt.h"
+
+/**
+ * @brief Bench side of the pulse counter stand-in
+ */
+namespace HostPcnt
+{
+	/**
+	 * @brief Count aDelta edges on aUnit one at a time, raising limit, threshold and
+	 ** zero events as the hardware would. Call while holding HostSim::CpuLock.
+	 */
+	void AddCounts(pcnt_unit_t aUnit, int aDelta);
+} // namespace HostPcnt
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct HostTask;
+
+/**
+ * @brief Virtual clock and scheduler behind the host HAL.
+ *
+ * Tasks are real threads, but only one of them holds the simulated CPU at a time
+ * (highest priority first, preempted only when it wakes a higher priority task) and time
+ * only moves when the bench calls Advance or a task is Busy. At each instant every ready
+ * task runs until it blocks, then due esp_timers fire and the default event loop is
+ * drained, like a single core S2 with an infinitely fast CPU. Runs are repeatable to the
+ * microsecond, so the latencies measured here are
+ * those of the control path's polling and ramps, not of the host machine.
+ */
+namespace HostSim
+{
+	uint64_t NowUs();
+
+	/**
+	 * @brief Move the virtual clock forward, waking tasks and firing timers in order
+	 */
+	void Advance(uint64_t aDeltaUs);
+	void AdvanceTo(uint64_t aTimeUs);
+
+	/**
+	 * @brief Advance in small steps until aCondition is true or aTimeoutUs elapses
+	 * @return true if the condition was met
+	 */
+	bool AdvanceUntil(const std::function<bool()> &aCondition, uint64_t aTimeoutUs, uint64_t aStepUs = 100);
+
+	/**
+	 * @brief Let every runnable task block and drain all deferred work at the current time
+	 */
+	void RunUntilIdle();
+
+	/**
+	 * @brief Work that runs on the simulator thread while all tasks are blocked,
+	 ** such as the esp_event dispatcher. Returns true if it did anything.
+	 */
+	using Pump = std::function<bool()>;
+	void AddPump(Pump aPump);
+
+	/**
+	 * @brief A one shot callback on the virtual clock, returns an id for CancelCallback
+	 */
+	uint32_t ScheduleCallback(uint64_t aWhenUs, std::function<void()> aCallback);
+	void CancelCallback(uint32_t anId);
+
+	/**
+	 * @brief Holds the simulated CPU, use it around anything the bench does that
+	 ** touches firmware state (pin changes, encoder counts, direct calls).
+	 */
+	class CpuLock
+	{
+	  public:
+		CpuLock();
+		~CpuLock();
+		CpuLock(const CpuLock &) = delete;
+		CpuLock &operator=(const CpuLock &) = delete;
+	};
+
+	/**
+	 * @brief Tasks blocked on a queue, notification or similar
+	 */
+	class WaitList
+	{
+	  public:
+		void WakeAll();
+		void WakeOne();
+		bool Empty() const { return myWaiters.empty(); }
+
+	  private:
+		friend bool Block(WaitList *, uint64_t);
+		std::vector<HostTask *> myWaiters;
+	};
+
+	/**
+	 * @brief Block the calling task until woken through aWaitList or until aWakeUs
+	 ** (UINT64_MAX waits forever). Must only be called from a task.
+	 * @return false on timeout
+	 */
+	bool Block(WaitList *aWaitList, uint64_t aWakeUs);
+
+	/**
+	 * @brief Hand the CPU to a higher priority task that is ready, as the real scheduler
+	 ** would the moment it was woken. Does nothing outside a task.
+	 */
+	void Preempt();
+
+	/**
+	 * @brief Work that takes aUs of CPU, such as redrawing the screen. The calling task keeps
+	 ** the CPU while the clock moves on. Timer callbacks fire as they fall due, like interrupts,
+	 ** and a higher priority task that woke meanwhile takes over at the end, like at a tick.
+	 */
+	void Busy(uint64_t aUs);
+
+	/**
+	 * @brief Current task, or nullptr on the simulator (ISR/event loop) thread
+	 */
+	HostTask *CurrentTask();
+
+	uint64_t TicksToUs(uint32_t aTicks);
+
+	/**
+	 * @brief Leave without unwinding, the task threads are parked forever
+	 */
+	[[noreturn]] void Exit(int aCode);
+} // namespace HostSim
@@ -0,0 +1,19 @@
+// Host stand-in for driver/adc.h, only the channel names are referenced.
+#pragma once
+
+#include <stdint.h>
+
+typedef enum
+{
+	ADC1_CHANNEL_0 = 0,
+	ADC1_CHANNEL_1 = 1,
+	ADC1_CHANNEL_2 = 2,
+	ADC1_CHANNEL_3 = 3,
+	ADC1_CHANNEL_4 = 4,
+	ADC1_CHANNEL_5 = 5,
+	ADC1_CHANNEL_6 = 6,
+	ADC1_CHANNEL_7 = 7,
+	ADC1_CHANNEL_8 = 8,
+	ADC1_CHANNEL_9 = 9,
+	ADC1_CHANNEL_MAX,
+} adc1_channel_t;
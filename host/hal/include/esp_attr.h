@@ -0,0 +1,7 @@
+// Host stand-in for esp_attr.h, the placement attributes have no meaning off-target.
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
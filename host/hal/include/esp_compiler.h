@@ -0,0 +1,17 @@
+// Host stand-in for esp_compiler.h
+#pragma once
+
+#include <stddef.h>
+
+#ifndef likely
+#define likely(x) __builtin_expect(!!(x), 1)
+#endif
+
+#ifndef unlikely
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+// newlib provides this in sys/cdefs.h on the target, glibc does not.
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
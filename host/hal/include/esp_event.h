@@ -0,0 +1,31 @@
+// Host stand-in for the default esp_event loop. Posted events are copied into a
+// bounded queue and dispatched by HostSim once every task has blocked.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event_base.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_loop_delete_default(void);
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size,
+						 TickType_t ticks_to_wait);
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler,
+									 void *event_handler_arg);
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+											  esp_event_handler_t event_handler, void *event_handler_arg,
+											  esp_event_handler_instance_t *instance);
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base, int32_t event_id,
+												esp_event_handler_instance_t instance);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+// Host stand-in for esp_rom_sys.h
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void);
+
+#ifdef __cplusplus
+}
+#endif
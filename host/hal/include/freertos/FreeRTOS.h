@@ -0,0 +1,22 @@
+// Host stand-in for FreeRTOS.h
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_attr.h"
+#include "freertos/portmacro.h"
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdTICKS_TO_MS(xTicks) ((TickType_t)(((TickType_t)(xTicks) * (TickType_t)1000U) / (TickType_t)configTICK_RATE_HZ))
+
+#define tskNO_AFFINITY 0x7FFFFFFF
@@ -0,0 +1,29 @@
+// Host stand-in for the FreeRTOS port layer, one tick per millisecond like CONFIG_FREERTOS_HZ=1000.
+#pragma once
+
+#include <stdint.h>
+// The IDF 4.x port layer includes esp_timer.h for its run time counter, firmware headers rely on that.
+#include "esp_timer.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define portMAX_DELAY (TickType_t)0xffffffffUL
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define portYIELD_FROM_ISR(x) (void)(x)
+#define portNUM_PROCESSORS 1
+
+// Only one thread holds the simulated CPU at a time and nothing in a critical section gives
+// it up, so critical sections need no lock of their own here
+typedef struct
+{
+	int myOwner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
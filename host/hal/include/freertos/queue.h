@@ -0,0 +1,34 @@
+// Host stand-in for FreeRTOS queues, blocking waits run on the HostSim virtual clock.
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct HostQueue *QueueHandle_t;
+
+// Room for the HostQueue itself, which xQueueCreateStatic builds in place
+typedef struct
+{
+	void *pvDummy[16];
+} StaticQueue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t *pucQueueStorageBuffer,
+								 StaticQueue_t *pxStaticQueue);
+void vQueueDelete(QueueHandle_t xQueue);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue);
+
+#define xQueueSendToBack(xQueue, pvItemToQueue, xTicksToWait) xQueueSend((xQueue), (pvItemToQueue), (xTicksToWait))
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,6 @@
+// Host stand-in for freertos/ringbuf.h, the firmware only includes it.
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *RingbufHandle_t;
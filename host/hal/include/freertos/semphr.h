@@ -0,0 +1,23 @@
+// Host stand-in for freertos/semphr.h. A counting semaphore is a queue of empty items, as
+// it is in FreeRTOS itself, so takes and gives block and wake on the HostSim virtual clock.
+#pragma once
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount,
+															   StaticSemaphore_t *pxSemaphoreBuffer)
+{
+	SemaphoreHandle_t semaphore = xQueueCreateStatic(uxMaxCount, 0, NULL, pxSemaphoreBuffer);
+	for (UBaseType_t i = 0; i < uxInitialCount; i++)
+	{
+		xQueueSend(semaphore, NULL, 0);
+	}
+	return semaphore;
+}
+
+#define xSemaphoreTake(xSemaphore, xBlockTime) xQueueReceive((xSemaphore), NULL, (xBlockTime))
+#define xSemaphoreGive(xSemaphore) xQueueSend((xSemaphore), NULL, 0)
+#define uxSemaphoreGetCount(xSemaphore) uxQueueMessagesWaiting((xSemaphore))
@@ -0,0 +1,15 @@
+// Host stand-in for hal/cpu_hal.h. The cycle counter runs on the host's clock at the
+// rate esp_rom_get_cpu_ticks_per_us gives, so handler times are host CPU time.
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t cpu_hal_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
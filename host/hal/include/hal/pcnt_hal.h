@@ -0,0 +1,2 @@
+// Host stand-in for hal/pcnt_hal.h, the driver in driver/pcnt.h covers everything used.
+#pragma once
@@ -0,0 +1,14 @@
+// Host stand-in for rom/gpio.h
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gpio_pad_select_gpio(uint32_t gpio_num);
+
+#ifdef __cplusplus
+}
+#endif
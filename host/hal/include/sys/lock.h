@@ -0,0 +1,15 @@
+// Host stand-in for newlib's sys/lock.h
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int _lock_t;
+
+void _lock_acquire(_lock_t *plock);
+void _lock_release(_lock_t *plock);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,167 @@
+#include "esp_event.h"
+#include "HostEvent.h"
+#include "HostSim.h"
+
+#include <deque>
+#include <vector>
+
+namespace
+{
+	struct Handler
+	{
+		esp_event_base_t myBase;
+		int32_t myId;
+		esp_event_handler_t myCallback;
+		void *myArg;
+		bool myRemoved = false;
+	};
+
+	struct PostedEvent
+	{
+		esp_event_base_t myBase;
+		int32_t myId;
+		std::vector<uint8_t> myData;
+	};
+
+	bool gCreated = false;
+	std::deque<PostedEvent> gQueue;
+	std::vector<Handler *> gHandlers;
+	HostSim::WaitList gSpaceWaiters;
+	HostEvent::Stats gStats;
+
+	bool Matches(const Handler &aHandler, const PostedEvent &anEvent)
+	{
+		const bool baseMatches = aHandler.myBase == ESP_EVENT_ANY_BASE || aHandler.myBase == anEvent.myBase;
+		const bool idMatches = aHandler.myId == ESP_EVENT_ANY_ID || aHandler.myId == anEvent.myId;
+		return baseMatches && idMatches;
+	}
+
+	bool DispatchPending()
+	{
+		bool dispatched = false;
+		while (!gQueue.empty())
+		{
+			PostedEvent event = std::move(gQueue.front());
+			gQueue.pop_front();
+			gSpaceWaiters.WakeOne();
+
+			void *data = event.myData.empty() ? nullptr : event.myData.data();
+			const std::vector<Handler *> handlers = gHandlers;
+			for (Handler *handler : handlers)
+			{
+				if (!handler->myRemoved && Matches(*handler, event))
+				{
+					handler->myCallback(handler->myArg, event.myBase, event.myId, data);
+				}
+			}
+			gStats.myDispatched++;
+			dispatched = true;
+		}
+		return dispatched;
+	}
+} // namespace
+
+namespace HostEvent
+{
+	Stats GetStats()
+	{
+		return gStats;
+	}
+
+	void ResetStats()
+	{
+		gStats = Stats();
+	}
+} // namespace HostEvent
+
+extern "C"
+{
+	esp_err_t esp_event_loop_create_default(void)
+	{
+		if (gCreated)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		gCreated = true;
+		HostSim::AddPump(DispatchPending);
+		return ESP_OK;
+	}
+
+	esp_err_t esp_event_loop_delete_default(void)
+	{
+		gQueue.clear();
+		return ESP_OK;
+	}
+
+	esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data,
+							 size_t event_data_size, TickType_t ticks_to_wait)
+	{
+		if (!gCreated)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+
+		const uint64_t deadline = ticks_to_wait == portMAX_DELAY
+									  ? UINT64_MAX
+									  : HostSim::NowUs() + HostSim::TicksToUs(ticks_to_wait);
+		while (gQueue.size() >= HostEvent::QUEUE_SIZE)
+		{
+			if (ticks_to_wait == 0 || HostSim::CurrentTask() == nullptr || HostSim::NowUs() >= deadline)
+			{
+				gStats.myTimeouts++;
+				return ESP_ERR_TIMEOUT;
+			}
+			HostSim::Block(&gSpaceWaiters, deadline);
+		}
+
+		PostedEvent event{event_base, event_id, {}};
+		if (event_data && event_data_size)
+		{
+			const uint8_t *bytes = static_cast<const uint8_t *>(event_data);
+			event.myData.assign(bytes, bytes + event_data_size);
+		}
+		gQueue.push_back(std::move(event));
+
+		gStats.myPosted++;
+		gStats.myPayloadBytes += event_data_size;
+		if (gQueue.size() > gStats.myHighWater)
+		{
+			gStats.myHighWater = gQueue.size();
+		}
+		return ESP_OK;
+	}
+
+	esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+												  esp_event_handler_t event_handler, void *event_handler_arg,
+												  esp_event_handler_instance_t *instance)
+	{
+		if (!event_handler)
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		Handler *handler = new Handler{event_base, event_id, event_handler, event_handler_arg};
+		gHandlers.push_back(handler);
+		if (instance)
+		{
+			*instance = handler;
+		}
+		return ESP_OK;
+	}
+
+	esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+										 esp_event_handler_t event_handler, void *event_handler_arg)
+	{
+		return esp_event_handler_instance_register(event_base, event_id, event_handler, event_handler_arg, nullptr);
+	}
+
+	esp_err_t esp_event_handler_instance_unregister(esp_event_base_t, int32_t, esp_event_handler_instance_t instance)
+	{
+		Handler *handler = static_cast<Handler *>(instance);
+		if (!handler)
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		handler->myRemoved = true;
+		return ESP_OK;
+	}
+}
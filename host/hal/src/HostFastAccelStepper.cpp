@@ -0,0 +1,434 @@
+#include "FastAccelStepper.h"
+#include "HostSim.h"
+#include "driver/pcnt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace
+{
+	std::map<uint8_t, FastAccelStepper *> gSteppers;
+}
+
+void FastAccelStepper::setDirectionPin(uint8_t dirPin, bool, uint16_t)
+{
+	myDirPin = dirPin;
+}
+
+void FastAccelStepper::setEnablePin(uint8_t, bool)
+{
+}
+
+void FastAccelStepper::setAutoEnable(bool)
+{
+}
+
+int8_t FastAccelStepper::setDelayToEnable(uint32_t)
+{
+	return 0;
+}
+
+void FastAccelStepper::setDelayToDisable(uint16_t)
+{
+}
+
+int8_t FastAccelStepper::setSpeedInHz(uint32_t speed_hz)
+{
+	if (speed_hz == 0)
+	{
+		return -1;
+	}
+	mySpeedInHz = speed_hz;
+	return 0;
+}
+
+int8_t FastAccelStepper::setSpeedInUs(uint32_t min_step_us)
+{
+	if (min_step_us == 0)
+	{
+		return -1;
+	}
+	return setSpeedInHz(1000000 / min_step_us);
+}
+
+uint32_t FastAccelStepper::getSpeedInMilliHz()
+{
+	return mySpeedInHz * 1000;
+}
+
+int8_t FastAccelStepper::setAcceleration(int32_t step_s_s)
+{
+	if (step_s_s <= 0)
+	{
+		return -1;
+	}
+	myAcceleration = step_s_s;
+	return 0;
+}
+
+int32_t FastAccelStepper::getAcceleration()
+{
+	return myAcceleration;
+}
+
+void FastAccelStepper::applySpeedAcceleration()
+{
+	Integrate();
+	if (myMode == Mode::Running)
+	{
+		myTargetVelocity = static_cast<double>(myDirection) * mySpeedInHz;
+	}
+}
+
+int8_t FastAccelStepper::Run(int8_t aDirection)
+{
+	if (myDirPin == PIN_UNDEFINED)
+	{
+		return MOVE_ERR_NO_DIRECTION_PIN;
+	}
+	if (mySpeedInHz == 0)
+	{
+		return MOVE_ERR_SPEED_IS_UNDEFINED;
+	}
+	if (myAcceleration == 0)
+	{
+		return MOVE_ERR_ACCELERATION_IS_UNDEFINED;
+	}
+
+	Integrate();
+	myHasTarget = false;
+	myDirection = aDirection;
+	myMode = Mode::Running;
+	myTargetVelocity = static_cast<double>(aDirection) * mySpeedInHz;
+	return MOVE_OK;
+}
+
+int8_t FastAccelStepper::runForward()
+{
+	return Run(1);
+}
+
+int8_t FastAccelStepper::runBackward()
+{
+	return Run(-1);
+}
+
+int8_t FastAccelStepper::moveTo(int32_t position, bool)
+{
+	Integrate();
+	if (position == getCurrentPosition() && myMode == Mode::Idle)
+	{
+		return MOVE_OK;
+	}
+	const int8_t result = Run(position > myPosition ? 1 : -1);
+	if (result == MOVE_OK)
+	{
+		myHasTarget = true;
+		myTargetPosition = position;
+	}
+	return result;
+}
+
+void FastAccelStepper::stopMove()
+{
+	Integrate();
+	if (myMode == Mode::Idle)
+	{
+		return;
+	}
+	myMode = Mode::Stopping;
+	myTargetVelocity = 0;
+}
+
+void FastAccelStepper::forceStop()
+{
+	Integrate();
+	myMode = Mode::Idle;
+	myHasTarget = false;
+	myVelocity = 0;
+	myTargetVelocity = 0;
+}
+
+bool FastAccelStepper::isRunning()
+{
+	Integrate();
+	return myMode != Mode::Idle || myQueueCount > 0;
+}
+
+bool FastAccelStepper::isStopping()
+{
+	Integrate();
+	return myMode == Mode::Stopping;
+}
+
+int32_t FastAccelStepper::getCurrentSpeedInMilliHz()
+{
+	Integrate();
+	if (const stepper_command_s *command = CurrentCommand())
+	{
+		if (command->steps == 0)
+		{
+			return 0;
+		}
+		const int32_t speed = static_cast<int32_t>(1000LL * TICKS_PER_S / command->ticks);
+		return command->count_up ? speed : -speed;
+	}
+	return static_cast<int32_t>(std::lround(myVelocity * 1000));
+}
+
+int32_t FastAccelStepper::getCurrentPosition()
+{
+	Integrate();
+	return static_cast<int32_t>(std::floor(myPosition + 1e-6));
+}
+
+void FastAccelStepper::setCurrentPosition(int32_t new_pos)
+{
+	Integrate();
+	myPosition = new_pos;
+}
+
+const stepper_command_s *FastAccelStepper::CurrentCommand()
+{
+	return myQueueCount ? &myQueue[myQueueHead] : nullptr;
+}
+
+int8_t FastAccelStepper::addQueueEntry(const struct stepper_command_s *cmd, bool start)
+{
+	Integrate();
+	if (myQueueCount == QUEUE_LEN)
+	{
+		return AQE_QUEUE_FULL;
+	}
+	if (cmd->steps > 0 && cmd->ticks < MIN_DELTA_TICKS)
+	{
+		return AQE_ERROR_TICKS_TOO_LOW;
+	}
+	if (static_cast<uint32_t>(cmd->ticks) * (cmd->steps ? cmd->steps : 1) < MIN_CMD_TICKS)
+	{
+		return AQE_ERROR_TICKS_TOO_LOW;
+	}
+	if (myDirPin == PIN_UNDEFINED && cmd->count_up != (myDirection > 0))
+	{
+		return AQE_ERROR_NO_DIR_PIN_TO_TOGGLE;
+	}
+	if (!start && myQueueCount == 0)
+	{
+		return AQE_ERROR_EMPTY_QUEUE_TO_START;
+	}
+
+	if (myQueueCount == 0)
+	{
+		myCommandStartTicks = HostSim::NowUs() * (TICKS_PER_S / 1000000);
+		myCommandStepsDone = 0;
+	}
+	myQueue[(myQueueHead + myQueueCount) % QUEUE_LEN] = *cmd;
+	myQueueCount++;
+	myDirection = cmd->count_up ? 1 : -1;
+	return AQE_OK;
+}
+
+bool FastAccelStepper::isQueueEmpty()
+{
+	Integrate();
+	return myQueueCount == 0;
+}
+
+bool FastAccelStepper::isQueueFull()
+{
+	Integrate();
+	return myQueueCount == QUEUE_LEN;
+}
+
+uint8_t FastAccelStepper::queueEntries()
+{
+	Integrate();
+	return myQueueCount;
+}
+
+bool FastAccelStepper::hasTicksInQueue(uint32_t min_ticks)
+{
+	Integrate();
+	uint64_t ticks = 0;
+	for (uint8_t i = 0; i < myQueueCount; i++)
+	{
+		const stepper_command_s &command = myQueue[(myQueueHead + i) % QUEUE_LEN];
+		ticks += static_cast<uint64_t>(command.ticks) * (command.steps ? command.steps : 1);
+	}
+	if (myQueueCount)
+	{
+		// The head command has been running since myCommandStartTicks.
+		const uint64_t now = HostSim::NowUs() * (TICKS_PER_S / 1000000);
+		const uint64_t elapsed = now - myCommandStartTicks;
+		ticks = ticks > elapsed ? ticks - elapsed : 0;
+	}
+	return ticks >= min_ticks;
+}
+
+void FastAccelStepper::IntegrateQueue(uint64_t aNowUs)
+{
+	const uint64_t now = aNowUs * (TICKS_PER_S / 1000000);
+	while (myQueueCount)
+	{
+		const stepper_command_s &command = myQueue[myQueueHead];
+		const int8_t direction = command.count_up ? 1 : -1;
+
+		// A pulse goes out at the start of every ticks long period of the command.
+		const uint64_t elapsed = now - myCommandStartTicks;
+		const uint64_t periodsStarted = elapsed / command.ticks + 1;
+		const uint8_t pulses = static_cast<uint8_t>(std::min<uint64_t>(periodsStarted, command.steps));
+		myPosition += direction * (pulses - myCommandStepsDone);
+		myCommandStepsDone = pulses;
+
+		const uint64_t duration = static_cast<uint64_t>(command.ticks) * (command.steps ? command.steps : 1);
+		if (elapsed < duration)
+		{
+			break;
+		}
+		myCommandStartTicks += duration;
+		myCommandStepsDone = 0;
+		myQueueHead = (myQueueHead + 1) % QUEUE_LEN;
+		myQueueCount--;
+	}
+}
+
+void FastAccelStepper::Integrate()
+{
+	const uint64_t now = HostSim::NowUs();
+	if (myQueueCount)
+	{
+		IntegrateQueue(now);
+		myLastUpdateUs = now;
+		return;
+	}
+
+	double dt = (now - myLastUpdateUs) / 1e6;
+	myLastUpdateUs = now;
+
+	if (myMode == Mode::Idle || dt <= 0)
+	{
+		return;
+	}
+	if (myHasTarget)
+	{
+		IntegrateToTarget(dt);
+		return;
+	}
+
+	const double difference = myTargetVelocity - myVelocity;
+	if (difference != 0)
+	{
+		const double rampTime = std::fabs(difference) / myAcceleration;
+		const double t = std::min(dt, rampTime);
+		const double accel = difference > 0 ? myAcceleration : -myAcceleration;
+		const double v0 = myVelocity;
+		myVelocity = t == rampTime ? myTargetVelocity : v0 + accel * t;
+		myPosition += (v0 + myVelocity) / 2 * t;
+		dt -= t;
+	}
+	myPosition += myVelocity * dt;
+
+	if (myMode == Mode::Stopping && myVelocity == 0)
+	{
+		myMode = Mode::Idle;
+	}
+}
+
+void FastAccelStepper::IntegrateToTarget(double aSeconds)
+{
+	// Worked in the direction of the target, so speed and the distance left are positive
+	// while heading for it. Each pass runs to the end of one phase of the move.
+	const double direction = myTargetPosition > myPosition ? 1 : -1;
+	const double a = myAcceleration;
+	double dt = aSeconds;
+	// A handful of phases at most, the cap only guards against rounding at phase boundaries
+	for (int phase = 0; phase < 8 && dt > 0 && myMode != Mode::Idle; phase++)
+	{
+		const double v = myVelocity * direction;
+		const double remaining = (myTargetPosition - myPosition) * direction;
+		const double top = myMode == Mode::Stopping ? 0 : mySpeedInHz;
+		double accel = 0;
+		double t = dt;
+
+		if (v < 0)
+		{
+			// Still moving away from the target, turn around first
+			accel = a;
+			t = std::min(dt, -v / a);
+		}
+		else if (remaining <= 0 || (v > 0 && remaining <= v * v / (2 * a) + 1e-9))
+		{
+			// Braking, at just the rate that stops on the target
+			if (remaining <= 0 || v == 0)
+			{
+				myPosition = myTargetPosition;
+				myVelocity = 0;
+				myMode = Mode::Idle;
+				myHasTarget = false;
+				break;
+			}
+			accel = -v * v / (2 * remaining);
+			t = std::min(dt, v / -accel);
+		}
+		else if (v < top)
+		{
+			// Accelerating, up to the top speed or the point where braking has to start
+			accel = a;
+			const double braking = (-v + std::sqrt(v * v / 2 + a * remaining)) / a;
+			t = std::min({dt, (top - v) / a, braking});
+		}
+		else if (v > top)
+		{
+			accel = -a;
+			t = std::min(dt, (v - top) / a);
+		}
+		else
+		{
+			if (v == 0)
+			{
+				// Stopped short of the target by stopMove
+				myMode = Mode::Idle;
+				myHasTarget = false;
+				break;
+			}
+			t = std::min(dt, (remaining - v * v / (2 * a)) / v);
+		}
+
+		t = std::max(t, 0.0);
+		const double v1 = v + accel * t;
+		myPosition += direction * (v + v1) / 2 * t;
+		myVelocity = direction * v1;
+		dt -= t;
+	}
+	if (myMode == Mode::Stopping && myVelocity == 0)
+	{
+		myMode = Mode::Idle;
+		myHasTarget = false;
+	}
+}
+
+void FastAccelStepperEngine::init(uint8_t)
+{
+	// On the target the engine claims the PCNT ISR service, the encoder relies on that.
+	pcnt_isr_service_install(0);
+}
+
+FastAccelStepper *FastAccelStepperEngine::stepperConnectToPin(uint8_t step_pin)
+{
+	FastAccelStepper *&stepper = gSteppers[step_pin];
+	if (!stepper)
+	{
+		stepper = new FastAccelStepper(step_pin);
+	}
+	return stepper;
+}
+
+namespace HostFastAccelStepper
+{
+	FastAccelStepper *Get(uint8_t aStepPin)
+	{
+		auto it = gSteppers.find(aStepPin);
+		return it == gSteppers.end() ? nullptr : it->second;
+	}
+} // namespace HostFastAccelStepper
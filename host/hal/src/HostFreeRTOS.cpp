@@ -0,0 +1,311 @@
+#include "HostSim.h"
+#include "HostTask.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sys/lock.h"
+
+#include <cstring>
+#include <new>
+#include <deque>
+#include <vector>
+
+HostTask *HostSimCreateTask(TaskFunction_t aFunction, const char *aName, void *aParameters, UBaseType_t aPriority);
+void HostSimDeleteTask(HostTask *aTask);
+
+namespace
+{
+	uint64_t DeadlineFromTicks(TickType_t aTicks)
+	{
+		if (aTicks == portMAX_DELAY)
+		{
+			return UINT64_MAX;
+		}
+		return HostSim::NowUs() + HostSim::TicksToUs(aTicks);
+	}
+} // namespace
+
+// Items live in a ring over fixed storage, like the real queue, so sending and receiving
+// never allocate.
+struct HostQueue
+{
+	size_t myLength;
+	size_t myItemSize;
+	uint8_t *myStorage;
+	bool myOwnsStorage;
+	size_t myHead = 0;
+	size_t myCount = 0;
+	HostSim::WaitList myReceivers;
+	HostSim::WaitList mySenders;
+
+	uint8_t *Item(size_t anIndex) { return myStorage + ((myHead + anIndex) % myLength) * myItemSize; }
+};
+
+static_assert(sizeof(HostQueue) <= sizeof(StaticQueue_t), "StaticQueue_t is too small for a HostQueue");
+
+extern "C"
+{
+	BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t, void *pvParameters,
+									   UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask, BaseType_t)
+	{
+		HostTask *task = HostSimCreateTask(pvTaskCode, pcName, pvParameters, uxPriority);
+		if (pvCreatedTask)
+		{
+			*pvCreatedTask = task;
+		}
+		return pdPASS;
+	}
+
+	BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters,
+						   UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask)
+	{
+		return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask,
+									   tskNO_AFFINITY);
+	}
+
+	void vTaskDelete(TaskHandle_t xTaskToDelete)
+	{
+		HostSimDeleteTask(xTaskToDelete);
+	}
+
+	void vTaskDelay(TickType_t xTicksToDelay)
+	{
+		HostSim::Block(nullptr, HostSim::NowUs() + HostSim::TicksToUs(xTicksToDelay));
+	}
+
+	TickType_t xTaskGetTickCount(void)
+	{
+		return static_cast<TickType_t>(HostSim::NowUs() * configTICK_RATE_HZ / 1000000);
+	}
+
+	TickType_t xTaskGetTickCountFromISR(void)
+	{
+		return xTaskGetTickCount();
+	}
+
+	TaskHandle_t xTaskGetCurrentTaskHandle(void)
+	{
+		return HostSim::CurrentTask();
+	}
+
+	UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+	{
+		HostTask *task = xTask ? xTask : HostSim::CurrentTask();
+		return task ? task->myPriority : configMAX_PRIORITIES - 1;
+	}
+
+	BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction,
+								  uint32_t *pulPreviousNotificationValue)
+	{
+		HostTask *task = xTaskToNotify;
+		if (pulPreviousNotificationValue)
+		{
+			*pulPreviousNotificationValue = task->myNotifyValue;
+		}
+
+		switch (eAction)
+		{
+		case eNoAction:
+			break;
+		case eSetBits:
+			task->myNotifyValue |= ulValue;
+			break;
+		case eIncrement:
+			task->myNotifyValue++;
+			break;
+		case eSetValueWithOverwrite:
+			task->myNotifyValue = ulValue;
+			break;
+		case eSetValueWithoutOverwrite:
+			if (task->myNotifyPending)
+			{
+				return pdFAIL;
+			}
+			task->myNotifyValue = ulValue;
+			break;
+		}
+
+		task->myNotifyPending = true;
+		task->myNotifyWaiters.WakeAll();
+		HostSim::Preempt();
+		return pdPASS;
+	}
+
+	BaseType_t xTaskGenericNotifyFromISR(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction,
+										 uint32_t *pulPreviousNotificationValue, BaseType_t *pxHigherPriorityTaskWoken)
+	{
+		if (pxHigherPriorityTaskWoken)
+		{
+			*pxHigherPriorityTaskWoken = pdTRUE;
+		}
+		return xTaskGenericNotify(xTaskToNotify, ulValue, eAction, pulPreviousNotificationValue);
+	}
+
+	BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit,
+							   uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+	{
+		HostTask *task = HostSim::CurrentTask();
+		if (!task->myNotifyPending)
+		{
+			task->myNotifyValue &= ~ulBitsToClearOnEntry;
+			if (xTicksToWait != 0)
+			{
+				HostSim::Block(&task->myNotifyWaiters, DeadlineFromTicks(xTicksToWait));
+			}
+		}
+
+		if (pulNotificationValue)
+		{
+			*pulNotificationValue = task->myNotifyValue;
+		}
+		if (!task->myNotifyPending)
+		{
+			return pdFALSE;
+		}
+		task->myNotifyValue &= ~ulBitsToClearOnExit;
+		task->myNotifyPending = false;
+		return pdTRUE;
+	}
+
+	uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+	{
+		HostTask *task = HostSim::CurrentTask();
+		if (task->myNotifyValue == 0 && xTicksToWait != 0)
+		{
+			HostSim::Block(&task->myNotifyWaiters, DeadlineFromTicks(xTicksToWait));
+		}
+
+		const uint32_t value = task->myNotifyValue;
+		if (value != 0)
+		{
+			task->myNotifyValue = xClearCountOnExit ? 0 : value - 1;
+		}
+		task->myNotifyPending = false;
+		return value;
+	}
+
+	QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+	{
+		HostQueue *queue = new HostQueue();
+		queue->myLength = uxQueueLength;
+		queue->myItemSize = uxItemSize;
+		queue->myStorage = new uint8_t[uxQueueLength * uxItemSize];
+		queue->myOwnsStorage = true;
+		return queue;
+	}
+
+	QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t *pucQueueStorageBuffer,
+									 StaticQueue_t *pxStaticQueue)
+	{
+		HostQueue *queue = new (pxStaticQueue) HostQueue();
+		queue->myLength = uxQueueLength;
+		queue->myItemSize = uxItemSize;
+		queue->myStorage = pucQueueStorageBuffer;
+		queue->myOwnsStorage = false;
+		return queue;
+	}
+
+	void vQueueDelete(QueueHandle_t xQueue)
+	{
+		if (xQueue->myOwnsStorage)
+		{
+			delete[] xQueue->myStorage;
+			delete xQueue;
+		}
+		else
+		{
+			xQueue->~HostQueue();
+		}
+	}
+
+	static BaseType_t QueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait, bool aFront)
+	{
+		const uint64_t deadline = DeadlineFromTicks(xTicksToWait);
+		while (xQueue->myCount >= xQueue->myLength)
+		{
+			if (xTicksToWait == 0 || HostSim::CurrentTask() == nullptr || HostSim::NowUs() >= deadline)
+			{
+				return errQUEUE_FULL;
+			}
+			HostSim::Block(&xQueue->mySenders, deadline);
+		}
+
+		if (aFront)
+		{
+			xQueue->myHead = (xQueue->myHead + xQueue->myLength - 1) % xQueue->myLength;
+			memcpy(xQueue->Item(0), pvItemToQueue, xQueue->myItemSize);
+		}
+		else
+		{
+			memcpy(xQueue->Item(xQueue->myCount), pvItemToQueue, xQueue->myItemSize);
+		}
+		xQueue->myCount++;
+		xQueue->myReceivers.WakeOne();
+		HostSim::Preempt();
+		return pdPASS;
+	}
+
+	BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+	{
+		return QueueSend(xQueue, pvItemToQueue, xTicksToWait, false);
+	}
+
+	BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+	{
+		return QueueSend(xQueue, pvItemToQueue, xTicksToWait, true);
+	}
+
+	BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken)
+	{
+		if (pxHigherPriorityTaskWoken)
+		{
+			*pxHigherPriorityTaskWoken = pdTRUE;
+		}
+		return QueueSend(xQueue, pvItemToQueue, 0, false);
+	}
+
+	BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue)
+	{
+		xQueue->myCount = 0;
+		return QueueSend(xQueue, pvItemToQueue, 0, false);
+	}
+
+	BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+	{
+		const uint64_t deadline = DeadlineFromTicks(xTicksToWait);
+		while (xQueue->myCount == 0)
+		{
+			if (xTicksToWait == 0 || HostSim::CurrentTask() == nullptr || HostSim::NowUs() >= deadline)
+			{
+				return errQUEUE_EMPTY;
+			}
+			HostSim::Block(&xQueue->myReceivers, deadline);
+		}
+
+		memcpy(pvBuffer, xQueue->Item(0), xQueue->myItemSize);
+		xQueue->myHead = (xQueue->myHead + 1) % xQueue->myLength;
+		xQueue->myCount--;
+		xQueue->mySenders.WakeOne();
+		HostSim::Preempt();
+		return pdPASS;
+	}
+
+	UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+	{
+		return xQueue->myCount;
+	}
+
+	UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+	{
+		return xQueue->myLength - xQueue->myCount;
+	}
+
+	void _lock_acquire(_lock_t *)
+	{
+		// Only one task holds the simulated CPU at a time, so there is nothing to exclude.
+	}
+
+	void _lock_release(_lock_t *)
+	{
+	}
+}
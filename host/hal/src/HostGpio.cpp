@@ -0,0 +1,192 @@
+#include "HostGpio.h"
+#include "rom/gpio.h"
+
+namespace
+{
+	struct Pin
+	{
+		int myLevel = 0;
+		int myOutputLevel = 0;
+		gpio_mode_t myMode = GPIO_MODE_DISABLE;
+		gpio_pull_mode_t myPull = GPIO_FLOATING;
+		gpio_int_type_t myIntrType = GPIO_INTR_DISABLE;
+		bool myIntrEnabled = true;
+		gpio_isr_t myIsr = nullptr;
+		void *myIsrArg = nullptr;
+	};
+
+	Pin gPins[GPIO_NUM_MAX];
+	bool gIsrServiceInstalled = false;
+
+	bool IsValid(gpio_num_t aPin)
+	{
+		return aPin >= 0 && aPin < GPIO_NUM_MAX;
+	}
+} // namespace
+
+namespace HostGpio
+{
+	void SetLevel(gpio_num_t aPin, int aLevel)
+	{
+		if (!IsValid(aPin))
+		{
+			return;
+		}
+
+		Pin &pin = gPins[aPin];
+		const int previous = pin.myLevel;
+		pin.myLevel = aLevel ? 1 : 0;
+
+		if (!pin.myIsr || !pin.myIntrEnabled || !gIsrServiceInstalled)
+		{
+			return;
+		}
+
+		bool fire = false;
+		switch (pin.myIntrType)
+		{
+		case GPIO_INTR_POSEDGE:
+			fire = !previous && pin.myLevel;
+			break;
+		case GPIO_INTR_NEGEDGE:
+			fire = previous && !pin.myLevel;
+			break;
+		case GPIO_INTR_ANYEDGE:
+			fire = previous != pin.myLevel;
+			break;
+		case GPIO_INTR_LOW_LEVEL:
+			fire = !pin.myLevel;
+			break;
+		case GPIO_INTR_HIGH_LEVEL:
+			fire = pin.myLevel;
+			break;
+		default:
+			break;
+		}
+
+		if (fire)
+		{
+			pin.myIsr(pin.myIsrArg);
+		}
+	}
+
+	int GetOutputLevel(gpio_num_t aPin)
+	{
+		return IsValid(aPin) ? gPins[aPin].myOutputLevel : 0;
+	}
+} // namespace HostGpio
+
+extern "C"
+{
+	void gpio_pad_select_gpio(uint32_t)
+	{
+	}
+
+	esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gPins[gpio_num].myMode = mode;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		// An idle pulled-up input reads high until the bench drives it.
+		gPins[gpio_num].myPull = pull;
+		gPins[gpio_num].myLevel = pull == GPIO_PULLUP_ONLY ? 1 : 0;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gPins[gpio_num].myIntrType = intr_type;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gPins[gpio_num].myIntrEnabled = true;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gPins[gpio_num].myIntrEnabled = false;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_install_isr_service(int)
+	{
+		if (gIsrServiceInstalled)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		gIsrServiceInstalled = true;
+		return ESP_OK;
+	}
+
+	void gpio_uninstall_isr_service(void)
+	{
+		gIsrServiceInstalled = false;
+	}
+
+	esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		if (!gIsrServiceInstalled)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		gPins[gpio_num].myIsr = isr_handler;
+		gPins[gpio_num].myIsrArg = args;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gPins[gpio_num].myIsr = nullptr;
+		gPins[gpio_num].myIsrArg = nullptr;
+		return ESP_OK;
+	}
+
+	int gpio_get_level(gpio_num_t gpio_num)
+	{
+		return IsValid(gpio_num) ? gPins[gpio_num].myLevel : 0;
+	}
+
+	esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+	{
+		if (!IsValid(gpio_num))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gPins[gpio_num].myOutputLevel = level ? 1 : 0;
+		return ESP_OK;
+	}
+}
@@ -0,0 +1,152 @@
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include <map>
+#include <string>
+
+namespace
+{
+	struct Handle
+	{
+		std::string myNamespace;
+		nvs_open_mode_t myMode;
+	};
+
+	std::map<std::string, std::map<std::string, int64_t>> gStore;
+	std::map<nvs_handle_t, Handle> gHandles;
+	nvs_handle_t gNextHandle = 1;
+	bool gInitialized = false;
+
+	Handle *Find(nvs_handle_t aHandle)
+	{
+		auto it = gHandles.find(aHandle);
+		return it == gHandles.end() ? nullptr : &it->second;
+	}
+
+	esp_err_t Set(nvs_handle_t aHandle, const char *aKey, int64_t aValue)
+	{
+		Handle *handle = Find(aHandle);
+		if (!handle)
+		{
+			return ESP_ERR_NVS_INVALID_HANDLE;
+		}
+		if (handle->myMode == NVS_READONLY)
+		{
+			return ESP_ERR_NVS_READ_ONLY;
+		}
+		gStore[handle->myNamespace][aKey] = aValue;
+		return ESP_OK;
+	}
+
+	esp_err_t Get(nvs_handle_t aHandle, const char *aKey, int64_t &aValue)
+	{
+		Handle *handle = Find(aHandle);
+		if (!handle)
+		{
+			return ESP_ERR_NVS_INVALID_HANDLE;
+		}
+		auto &keys = gStore[handle->myNamespace];
+		auto it = keys.find(aKey);
+		if (it == keys.end())
+		{
+			return ESP_ERR_NVS_NOT_FOUND;
+		}
+		aValue = it->second;
+		return ESP_OK;
+	}
+} // namespace
+
+extern "C"
+{
+	esp_err_t nvs_flash_init(void)
+	{
+		gInitialized = true;
+		return ESP_OK;
+	}
+
+	esp_err_t nvs_flash_erase(void)
+	{
+		gStore.clear();
+		return ESP_OK;
+	}
+
+	esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+	{
+		if (!gInitialized)
+		{
+			return ESP_ERR_NVS_NOT_INITIALIZED;
+		}
+		if (open_mode == NVS_READONLY && gStore.find(name) == gStore.end())
+		{
+			return ESP_ERR_NVS_NOT_FOUND;
+		}
+		const nvs_handle_t handle = gNextHandle++;
+		gHandles[handle] = Handle{name, open_mode};
+		gStore[name];
+		*out_handle = handle;
+		return ESP_OK;
+	}
+
+	void nvs_close(nvs_handle_t handle)
+	{
+		gHandles.erase(handle);
+	}
+
+	esp_err_t nvs_commit(nvs_handle_t handle)
+	{
+		return Find(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+	}
+
+	esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+	{
+		Handle *h = Find(handle);
+		if (!h)
+		{
+			return ESP_ERR_NVS_INVALID_HANDLE;
+		}
+		return gStore[h->myNamespace].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+	}
+
+	esp_err_t nvs_erase_all(nvs_handle_t handle)
+	{
+		Handle *h = Find(handle);
+		if (!h)
+		{
+			return ESP_ERR_NVS_INVALID_HANDLE;
+		}
+		gStore[h->myNamespace].clear();
+		return ESP_OK;
+	}
+
+	esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value)
+	{
+		return Set(handle, key, value);
+	}
+
+	esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value)
+	{
+		int64_t value = 0;
+		esp_err_t err = Get(handle, key, value);
+		if (err == ESP_OK)
+		{
+			*out_value = static_cast<int32_t>(value);
+		}
+		return err;
+	}
+
+	esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+	{
+		return Set(handle, key, value);
+	}
+
+	esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+	{
+		int64_t value = 0;
+		esp_err_t err = Get(handle, key, value);
+		if (err == ESP_OK)
+		{
+			*out_value = static_cast<uint32_t>(value);
+		}
+		return err;
+	}
+}
@@ -0,0 +1,270 @@
+#include "HostPcnt.h"
+
+namespace
+{
+	struct Unit
+	{
+		int16_t myCount = 0;
+		int16_t myHighLimit = 0;
+		int16_t myLowLimit = 0;
+		int16_t myThreshold0 = 0;
+		int16_t myThreshold1 = 0;
+		uint32_t myEnabledEvents = 0;
+		uint32_t myStatus = 0;
+		bool myRunning = true;
+		void (*myIsr)(void *) = nullptr;
+		void *myIsrArg = nullptr;
+	};
+
+	Unit gUnits[PCNT_UNIT_MAX];
+	bool gIsrServiceInstalled = false;
+
+	bool IsValid(pcnt_unit_t aUnit)
+	{
+		return aUnit >= 0 && aUnit < PCNT_UNIT_MAX;
+	}
+
+	void Raise(Unit &aUnit, uint32_t anEvents)
+	{
+		anEvents &= aUnit.myEnabledEvents;
+		if (!anEvents || !aUnit.myIsr || !gIsrServiceInstalled)
+		{
+			return;
+		}
+		aUnit.myStatus = anEvents;
+		aUnit.myIsr(aUnit.myIsrArg);
+	}
+} // namespace
+
+namespace HostPcnt
+{
+	void AddCounts(pcnt_unit_t aUnit, int aDelta)
+	{
+		if (!IsValid(aUnit))
+		{
+			return;
+		}
+
+		Unit &unit = gUnits[aUnit];
+		const int step = aDelta > 0 ? 1 : -1;
+		for (int i = 0; i != aDelta && unit.myRunning; i += step)
+		{
+			unit.myCount += step;
+			uint32_t events = 0;
+
+			if (unit.myHighLimit && unit.myCount >= unit.myHighLimit)
+			{
+				events |= PCNT_EVT_H_LIM;
+			}
+			else if (unit.myLowLimit && unit.myCount <= unit.myLowLimit)
+			{
+				events |= PCNT_EVT_L_LIM;
+			}
+			if (unit.myCount == unit.myThreshold0)
+			{
+				events |= PCNT_EVT_THRES_0;
+			}
+			if (unit.myCount == unit.myThreshold1)
+			{
+				events |= PCNT_EVT_THRES_1;
+			}
+			if (unit.myCount == 0)
+			{
+				events |= PCNT_EVT_ZERO;
+			}
+
+			// The counter resets itself on either limit before the interrupt is serviced.
+			if (events & (PCNT_EVT_H_LIM | PCNT_EVT_L_LIM))
+			{
+				unit.myCount = 0;
+			}
+			Raise(unit, events);
+		}
+	}
+} // namespace HostPcnt
+
+extern "C"
+{
+	esp_err_t pcnt_unit_config(const pcnt_config_t *pcnt_config)
+	{
+		if (!pcnt_config || !IsValid(pcnt_config->unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		Unit &unit = gUnits[pcnt_config->unit];
+		unit.myHighLimit = pcnt_config->counter_h_lim;
+		unit.myLowLimit = pcnt_config->counter_l_lim;
+		unit.myCount = 0;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_get_counter_value(pcnt_unit_t pcnt_unit, int16_t *count)
+	{
+		if (!IsValid(pcnt_unit) || !count)
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		*count = gUnits[pcnt_unit].myCount;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_counter_pause(pcnt_unit_t pcnt_unit)
+	{
+		if (!IsValid(pcnt_unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[pcnt_unit].myRunning = false;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_counter_resume(pcnt_unit_t pcnt_unit)
+	{
+		if (!IsValid(pcnt_unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[pcnt_unit].myRunning = true;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_counter_clear(pcnt_unit_t pcnt_unit)
+	{
+		if (!IsValid(pcnt_unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[pcnt_unit].myCount = 0;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t)
+	{
+		return IsValid(unit) ? ESP_OK : ESP_ERR_INVALID_ARG;
+	}
+
+	esp_err_t pcnt_filter_enable(pcnt_unit_t unit)
+	{
+		return IsValid(unit) ? ESP_OK : ESP_ERR_INVALID_ARG;
+	}
+
+	esp_err_t pcnt_filter_disable(pcnt_unit_t unit)
+	{
+		return IsValid(unit) ? ESP_OK : ESP_ERR_INVALID_ARG;
+	}
+
+	esp_err_t pcnt_event_enable(pcnt_unit_t unit, pcnt_evt_type_t evt_type)
+	{
+		if (!IsValid(unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[unit].myEnabledEvents |= evt_type;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_event_disable(pcnt_unit_t unit, pcnt_evt_type_t evt_type)
+	{
+		if (!IsValid(unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[unit].myEnabledEvents &= ~static_cast<uint32_t>(evt_type);
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_set_event_value(pcnt_unit_t unit, pcnt_evt_type_t evt_type, int16_t value)
+	{
+		if (!IsValid(unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		switch (evt_type)
+		{
+		case PCNT_EVT_THRES_0:
+			gUnits[unit].myThreshold0 = value;
+			break;
+		case PCNT_EVT_THRES_1:
+			gUnits[unit].myThreshold1 = value;
+			break;
+		case PCNT_EVT_H_LIM:
+			gUnits[unit].myHighLimit = value;
+			break;
+		case PCNT_EVT_L_LIM:
+			gUnits[unit].myLowLimit = value;
+			break;
+		default:
+			return ESP_ERR_INVALID_ARG;
+		}
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_get_event_value(pcnt_unit_t unit, pcnt_evt_type_t evt_type, int16_t *value)
+	{
+		if (!IsValid(unit) || !value)
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		switch (evt_type)
+		{
+		case PCNT_EVT_THRES_0:
+			*value = gUnits[unit].myThreshold0;
+			break;
+		case PCNT_EVT_THRES_1:
+			*value = gUnits[unit].myThreshold1;
+			break;
+		case PCNT_EVT_H_LIM:
+			*value = gUnits[unit].myHighLimit;
+			break;
+		case PCNT_EVT_L_LIM:
+			*value = gUnits[unit].myLowLimit;
+			break;
+		default:
+			return ESP_ERR_INVALID_ARG;
+		}
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_get_event_status(pcnt_unit_t unit, uint32_t *status)
+	{
+		if (!IsValid(unit) || !status)
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		*status = gUnits[unit].myStatus;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_isr_service_install(int)
+	{
+		gIsrServiceInstalled = true;
+		return ESP_OK;
+	}
+
+	void pcnt_isr_service_uninstall(void)
+	{
+		gIsrServiceInstalled = false;
+	}
+
+	esp_err_t pcnt_isr_handler_add(pcnt_unit_t unit, void (*isr_handler)(void *), void *args)
+	{
+		if (!IsValid(unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[unit].myIsr = isr_handler;
+		gUnits[unit].myIsrArg = args;
+		return ESP_OK;
+	}
+
+	esp_err_t pcnt_isr_handler_remove(pcnt_unit_t unit)
+	{
+		if (!IsValid(unit))
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		gUnits[unit].myIsr = nullptr;
+		gUnits[unit].myIsrArg = nullptr;
+		return ESP_OK;
+	}
+}
@@ -0,0 +1,443 @@
+#include "HostSim.h"
+#include "HostTask.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	std::mutex gLock;
+	std::condition_variable gIdleCv;
+	std::atomic<uint64_t> gNowUs{0};
+
+	// The simulated CPU. nullptr when free, kSimulator while the bench thread holds it.
+	HostTask *const kSimulator = reinterpret_cast<HostTask *>(1);
+	HostTask *gOwner = nullptr;
+	std::vector<HostTask *> gReady;
+	std::vector<HostTask *> gSleeping;
+	uint64_t gSequence = 0;
+
+	std::vector<HostSim::Pump> gPumps;
+	std::multimap<uint64_t, std::pair<uint32_t, std::function<void()>>> gCallbacks;
+	uint32_t gNextCallbackId = 1;
+
+	thread_local HostTask *tCurrent = nullptr;
+
+	// Caller holds gLock.
+	void MakeReady(HostTask *aTask)
+	{
+		if (!aTask->myBlocked)
+		{
+			return;
+		}
+		// A task still listed in a WaitList removes itself once it runs again, see Block.
+		gSleeping.erase(std::remove(gSleeping.begin(), gSleeping.end(), aTask), gSleeping.end());
+		aTask->myBlocked = false;
+		aTask->mySequence = gSequence++;
+		gReady.push_back(aTask);
+	}
+
+	// Caller holds gLock. Hands the CPU to the highest priority ready task, oldest first.
+	void ReleaseCpu()
+	{
+		if (gReady.empty())
+		{
+			gOwner = nullptr;
+			gIdleCv.notify_all();
+			return;
+		}
+
+		auto next = std::min_element(gReady.begin(), gReady.end(), [](HostTask *a, HostTask *b) {
+			if (a->myPriority != b->myPriority)
+			{
+				return a->myPriority > b->myPriority;
+			}
+			return a->mySequence < b->mySequence;
+		});
+		HostTask *task = *next;
+		gReady.erase(next);
+		gOwner = task;
+		task->myCv.notify_all();
+	}
+
+	// Caller holds gLock via aLock. Returns once aTask owns the CPU.
+	void WaitForCpu(std::unique_lock<std::mutex> &aLock, HostTask *aTask)
+	{
+		aTask->myCv.wait(aLock, [aTask] { return gOwner == aTask; });
+	}
+
+	void TaskTrampoline(HostTask *aTask)
+	{
+		{
+			std::unique_lock<std::mutex> lock(gLock);
+			WaitForCpu(lock, aTask);
+		}
+		tCurrent = aTask;
+
+		try
+		{
+			if (!aTask->myDeleted)
+			{
+				aTask->myFunction(aTask->myParameters);
+			}
+		}
+		catch (const HostTaskDeleted &)
+		{
+		}
+
+		std::unique_lock<std::mutex> lock(gLock);
+		ReleaseCpu();
+		// The handle may still be referenced by firmware code, so it is never freed.
+	}
+
+	bool WakeDueSleepers()
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		bool woke = false;
+		const uint64_t now = gNowUs;
+		std::vector<HostTask *> due;
+		for (HostTask *task : gSleeping)
+		{
+			if (task->myWakeUs <= now)
+			{
+				due.push_back(task);
+			}
+		}
+		for (HostTask *task : due)
+		{
+			task->myTimedOut = true;
+			MakeReady(task);
+			woke = true;
+		}
+		return woke;
+	}
+
+	bool FireDueCallbacks()
+	{
+		bool fired = false;
+		while (true)
+		{
+			std::function<void()> callback;
+			{
+				std::unique_lock<std::mutex> lock(gLock);
+				auto it = gCallbacks.begin();
+				if (it == gCallbacks.end() || it->first > gNowUs)
+				{
+					break;
+				}
+				callback = std::move(it->second.second);
+				gCallbacks.erase(it);
+			}
+			callback();
+			fired = true;
+		}
+		return fired;
+	}
+
+	uint64_t NextDeadline()
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		uint64_t next = UINT64_MAX;
+		for (HostTask *task : gSleeping)
+		{
+			next = std::min(next, task->myWakeUs);
+		}
+		if (!gCallbacks.empty())
+		{
+			next = std::min(next, gCallbacks.begin()->first);
+		}
+		return next;
+	}
+} // namespace
+
+namespace HostSim
+{
+	uint64_t NowUs()
+	{
+		return gNowUs;
+	}
+
+	uint64_t TicksToUs(uint32_t aTicks)
+	{
+		return static_cast<uint64_t>(aTicks) * 1000000 / configTICK_RATE_HZ;
+	}
+
+	HostTask *CurrentTask()
+	{
+		return tCurrent;
+	}
+
+	CpuLock::CpuLock()
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		gIdleCv.wait(lock, [] { return gOwner == nullptr && gReady.empty(); });
+		gOwner = kSimulator;
+	}
+
+	CpuLock::~CpuLock()
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		ReleaseCpu();
+	}
+
+	void AddPump(Pump aPump)
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		gPumps.push_back(std::move(aPump));
+	}
+
+	uint32_t ScheduleCallback(uint64_t aWhenUs, std::function<void()> aCallback)
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		const uint32_t id = gNextCallbackId++;
+		gCallbacks.emplace(aWhenUs, std::make_pair(id, std::move(aCallback)));
+		return id;
+	}
+
+	void CancelCallback(uint32_t anId)
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		for (auto it = gCallbacks.begin(); it != gCallbacks.end(); ++it)
+		{
+			if (it->second.first == anId)
+			{
+				gCallbacks.erase(it);
+				return;
+			}
+		}
+	}
+
+	void RunUntilIdle()
+	{
+		bool didWork = true;
+		while (didWork)
+		{
+			CpuLock cpu;
+			didWork = WakeDueSleepers();
+			didWork |= FireDueCallbacks();
+
+			std::vector<Pump> pumps;
+			{
+				std::unique_lock<std::mutex> lock(gLock);
+				pumps = gPumps;
+			}
+			for (Pump &pump : pumps)
+			{
+				didWork |= pump();
+			}
+		}
+	}
+
+	void AdvanceTo(uint64_t aTimeUs)
+	{
+		RunUntilIdle();
+		while (true)
+		{
+			const uint64_t next = NextDeadline();
+			if (next > aTimeUs)
+			{
+				break;
+			}
+			gNowUs = std::max<uint64_t>(gNowUs, next);
+			RunUntilIdle();
+		}
+		gNowUs = std::max<uint64_t>(gNowUs, aTimeUs);
+		RunUntilIdle();
+	}
+
+	void Advance(uint64_t aDeltaUs)
+	{
+		AdvanceTo(gNowUs + aDeltaUs);
+	}
+
+	bool AdvanceUntil(const std::function<bool()> &aCondition, uint64_t aTimeoutUs, uint64_t aStepUs)
+	{
+		const uint64_t deadline = gNowUs + aTimeoutUs;
+		RunUntilIdle();
+		while (true)
+		{
+			{
+				CpuLock cpu;
+				if (aCondition())
+				{
+					return true;
+				}
+			}
+			if (gNowUs >= deadline)
+			{
+				return false;
+			}
+			AdvanceTo(std::min<uint64_t>(gNowUs + aStepUs, deadline));
+		}
+	}
+
+	void WaitList::WakeAll()
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		for (HostTask *task : myWaiters)
+		{
+			if (task->myBlocked)
+			{
+				task->myTimedOut = false;
+				MakeReady(task);
+			}
+		}
+		myWaiters.clear();
+	}
+
+	void WaitList::WakeOne()
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		if (myWaiters.empty())
+		{
+			return;
+		}
+		for (auto it = myWaiters.begin(); it != myWaiters.end(); ++it)
+		{
+			HostTask *task = *it;
+			if (task->myBlocked)
+			{
+				myWaiters.erase(it);
+				task->myTimedOut = false;
+				MakeReady(task);
+				return;
+			}
+		}
+	}
+
+	bool Block(WaitList *aWaitList, uint64_t aWakeUs)
+	{
+		HostTask *task = tCurrent;
+		if (task == nullptr)
+		{
+			fprintf(stderr, "HostSim: blocking call outside of a task\n");
+			abort();
+		}
+
+		std::unique_lock<std::mutex> lock(gLock);
+		task->myBlocked = true;
+		task->myTimedOut = false;
+		task->myWakeUs = aWakeUs;
+		task->myWaitList = aWaitList;
+		if (aWaitList)
+		{
+			aWaitList->myWaiters.push_back(task);
+		}
+		gSleeping.push_back(task);
+
+		ReleaseCpu();
+		WaitForCpu(lock, task);
+
+		if (aWaitList)
+		{
+			aWaitList->myWaiters.erase(std::remove(aWaitList->myWaiters.begin(), aWaitList->myWaiters.end(), task),
+									   aWaitList->myWaiters.end());
+		}
+		task->myWaitList = nullptr;
+		task->myWakeUs = UINT64_MAX;
+
+		if (task->myDeleted)
+		{
+			lock.unlock();
+			throw HostTaskDeleted();
+		}
+		return !task->myTimedOut;
+	}
+
+	void Preempt()
+	{
+		HostTask *task = tCurrent;
+		if (task == nullptr)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(gLock);
+		const bool higher = std::any_of(gReady.begin(), gReady.end(),
+										[task](HostTask *aReady) { return aReady->myPriority > task->myPriority; });
+		if (!higher)
+		{
+			return;
+		}
+		// Back in line ahead of its equals, as FreeRTOS leaves a preempted task
+		task->mySequence = 0;
+		gReady.push_back(task);
+		ReleaseCpu();
+		WaitForCpu(lock, task);
+	}
+
+	void Busy(uint64_t aUs)
+	{
+		HostTask *task = tCurrent;
+		const uint64_t end = gNowUs + aUs;
+
+		// Interrupts and timers still run while the task works, as they fall due
+		tCurrent = nullptr;
+		while (true)
+		{
+			uint64_t next;
+			{
+				std::unique_lock<std::mutex> lock(gLock);
+				next = gCallbacks.empty() ? UINT64_MAX : gCallbacks.begin()->first;
+			}
+			if (next > end)
+			{
+				break;
+			}
+			gNowUs = std::max<uint64_t>(gNowUs, next);
+			FireDueCallbacks();
+		}
+		gNowUs = end;
+		tCurrent = task;
+
+		// Then the tick hands the CPU to whatever of higher priority woke meanwhile
+		WakeDueSleepers();
+		Preempt();
+	}
+
+	void Exit(int aCode)
+	{
+		fflush(stdout);
+		fflush(stderr);
+		std::_Exit(aCode);
+	}
+} // namespace HostSim
+
+// Called from the FreeRTOS shim.
+HostTask *HostSimCreateTask(TaskFunction_t aFunction, const char *aName, void *aParameters, UBaseType_t aPriority)
+{
+	HostTask *task = new HostTask();
+	task->myName = aName ? aName : "";
+	task->myFunction = aFunction;
+	task->myParameters = aParameters;
+	task->myPriority = aPriority;
+
+	{
+		std::unique_lock<std::mutex> lock(gLock);
+		task->mySequence = gSequence++;
+		gReady.push_back(task);
+	}
+
+	std::thread(TaskTrampoline, task).detach();
+	return task;
+}
+
+void HostSimDeleteTask(HostTask *aTask)
+{
+	if (aTask == nullptr || aTask == tCurrent)
+	{
+		throw HostTaskDeleted();
+	}
+
+	std::unique_lock<std::mutex> lock(gLock);
+	aTask->myDeleted = true;
+	if (aTask->myBlocked)
+	{
+		MakeReady(aTask);
+	}
+}
@@ -0,0 +1,108 @@
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "hal/cpu_hal.h"
+#include "HostSim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+
+namespace
+{
+	// Clock of the S3 at its fastest setting
+	constexpr uint32_t CPU_TICKS_PER_US = 240;
+
+	esp_log_level_t gDefaultLevel = ESP_LOG_INFO;
+	std::map<std::string, esp_log_level_t> gTagLevels;
+
+	char LevelLetter(esp_log_level_t aLevel)
+	{
+		switch (aLevel)
+		{
+		case ESP_LOG_ERROR:
+			return 'E';
+		case ESP_LOG_WARN:
+			return 'W';
+		case ESP_LOG_INFO:
+			return 'I';
+		case ESP_LOG_DEBUG:
+			return 'D';
+		case ESP_LOG_VERBOSE:
+			return 'V';
+		default:
+			return '?';
+		}
+	}
+} // namespace
+
+extern "C"
+{
+	const char *esp_err_to_name(esp_err_t code)
+	{
+		switch (code)
+		{
+		case ESP_OK:
+			return "ESP_OK";
+		case ESP_FAIL:
+			return "ESP_FAIL";
+		case ESP_ERR_NO_MEM:
+			return "ESP_ERR_NO_MEM";
+		case ESP_ERR_INVALID_ARG:
+			return "ESP_ERR_INVALID_ARG";
+		case ESP_ERR_INVALID_STATE:
+			return "ESP_ERR_INVALID_STATE";
+		case ESP_ERR_INVALID_SIZE:
+			return "ESP_ERR_INVALID_SIZE";
+		case ESP_ERR_NOT_FOUND:
+			return "ESP_ERR_NOT_FOUND";
+		case ESP_ERR_NOT_SUPPORTED:
+			return "ESP_ERR_NOT_SUPPORTED";
+		case ESP_ERR_TIMEOUT:
+			return "ESP_ERR_TIMEOUT";
+		default:
+			return "UNKNOWN ERROR";
+		}
+	}
+
+	void esp_log_level_set(const char *tag, esp_log_level_t level)
+	{
+		if (std::string(tag) == "*")
+		{
+			gDefaultLevel = level;
+			gTagLevels.clear();
+			return;
+		}
+		gTagLevels[tag] = level;
+	}
+
+	void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+	{
+		auto it = gTagLevels.find(tag);
+		const esp_log_level_t limit = it != gTagLevels.end() ? it->second : gDefaultLevel;
+		if (level > limit)
+		{
+			return;
+		}
+
+		printf("%c (%llu) %s: ", LevelLetter(level), static_cast<unsigned long long>(HostSim::NowUs() / 1000), tag);
+		va_list args;
+		va_start(args, format);
+		vprintf(format, args);
+		va_end(args);
+		printf("\n");
+	}
+
+	uint32_t esp_rom_get_cpu_ticks_per_us(void)
+	{
+		return CPU_TICKS_PER_US;
+	}
+
+	uint32_t cpu_hal_get_cycle_count(void)
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch();
+		const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+		return static_cast<uint32_t>(ns * CPU_TICKS_PER_US / 1000);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <string>
+#include "HostSim.h"
+#include "freertos/task.h"
+
+struct HostTask
+{
+	std::string myName;
+	TaskFunction_t myFunction = nullptr;
+	void *myParameters = nullptr;
+	UBaseType_t myPriority = 0;
+	uint64_t mySequence = 0;
+
+	std::condition_variable myCv;
+	uint64_t myWakeUs = UINT64_MAX;
+	HostSim::WaitList *myWaitList = nullptr;
+	bool myBlocked = false;
+	bool myTimedOut = false;
+	bool myDeleted = false;
+
+	uint32_t myNotifyValue = 0;
+	bool myNotifyPending = false;
+	HostSim::WaitList myNotifyWaiters;
+};
+
+// Thrown through a task's stack by vTaskDelete(NULL), caught by the thread trampoline.
+struct HostTaskDeleted
+{
+};
@@ -0,0 +1,95 @@
+#include "esp_timer.h"
+#include "HostSim.h"
+
+struct esp_timer
+{
+	esp_timer_create_args_t myArgs;
+	uint32_t myCallbackId = 0;
+	uint64_t myPeriodUs = 0;
+	bool myActive = false;
+};
+
+namespace
+{
+	void Arm(esp_timer *aTimer, uint64_t aDelayUs)
+	{
+		aTimer->myActive = true;
+		aTimer->myCallbackId = HostSim::ScheduleCallback(HostSim::NowUs() + aDelayUs, [aTimer]() {
+			aTimer->myActive = false;
+			if (aTimer->myPeriodUs)
+			{
+				Arm(aTimer, aTimer->myPeriodUs);
+			}
+			aTimer->myArgs.callback(aTimer->myArgs.arg);
+		});
+	}
+} // namespace
+
+extern "C"
+{
+	esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+	{
+		if (!create_args || !create_args->callback || !out_handle)
+		{
+			return ESP_ERR_INVALID_ARG;
+		}
+		esp_timer *timer = new esp_timer();
+		timer->myArgs = *create_args;
+		*out_handle = timer;
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+	{
+		if (timer->myActive)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		timer->myPeriodUs = 0;
+		Arm(timer, timeout_us);
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+	{
+		if (timer->myActive)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		timer->myPeriodUs = period;
+		Arm(timer, period);
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+	{
+		if (!timer->myActive)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		HostSim::CancelCallback(timer->myCallbackId);
+		timer->myActive = false;
+		timer->myPeriodUs = 0;
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+	{
+		if (timer->myActive)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+		delete timer;
+		return ESP_OK;
+	}
+
+	bool esp_timer_is_active(esp_timer_handle_t timer)
+	{
+		return timer->myActive;
+	}
+
+	int64_t esp_timer_get_time(void)
+	{
+		return static_cast<int64_t>(HostSim::NowUs());
+	}
+}
@@ -0,0 +1,330 @@
+// Replays an event recording, the output of the console's record command, through the
+// firmware sources in main/ on the HostSim virtual clock. The switch, encoder and command
+// events in it are fed in at the times they were recorded, the control path plays them out
+// again, and what it publishes is compared with what the machine published, so a problem
+// seen in the field can be stepped through here, the same way every run.
+//
+//   host_replay [-v] [--normal N] [--rapid N] [--backlash N] capture.txt
+//
+// The speeds and backlash the machine had when the recording starts aren't in it, give
+// them with the options if they aren't the settings defaults. The display isn't built on
+// the host, so UI events are compared rather than drawn.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Encoder.h"
+#include "Event.h"
+#include "EventBus.h"
+#include "EventRecorder.h"
+#include "EventTrace.h"
+#include "EventTypes.h"
+#include "HostSim.h"
+#include "MovementSwitches.h"
+#include "Settings.h"
+#include "StateMachine.h"
+#include "config.h"
+#include "stepper.h"
+
+namespace
+{
+	using Record = EventRecorder::Record;
+	using Source = EventRecorder::Source;
+
+	std::shared_ptr<Settings> mySettings;
+	std::shared_ptr<Stepper> myStepper;
+	std::shared_ptr<StateMachine> myState;
+	std::shared_ptr<RotaryEncoder> myEncoder;
+
+	struct Options
+	{
+		const char *myFile = nullptr;
+		bool myVerbose = false;
+		int32_t myNormalSpeed = -1; // -1 for the settings default
+		int32_t myRapidSpeed = -1;
+		int32_t myBacklash = -1;
+	};
+
+	// What the operator and the outside world did. SetStopped and MoveComplete are published
+	// on COMMAND_EVENT too, but by the stepper, which does so again as the replay plays out.
+	bool IsInput(const Record &aRecord)
+	{
+		switch (aRecord.mySource)
+		{
+		case Source::Switches:
+		case Source::Encoder:
+			return true;
+		case Source::Command:
+			return static_cast<Event>(aRecord.myId) != Event::SetStopped &&
+				   static_cast<Event>(aRecord.myId) != Event::MoveComplete;
+		default:
+			return false;
+		}
+	}
+
+	// What the control path made of them
+	bool IsOutput(const Record &aRecord)
+	{
+		return aRecord.mySource == Source::Settings || aRecord.mySource == Source::StateTransition ||
+			   aRecord.mySource == Source::UI || (aRecord.mySource == Source::Command && !IsInput(aRecord));
+	}
+
+	bool IsSameEvent(const Record &aCaptured, const Record &aReplayed)
+	{
+		return aCaptured.mySource == aReplayed.mySource && aCaptured.myId == aReplayed.myId &&
+			   aCaptured.mySize == aReplayed.mySize &&
+			   memcmp(aCaptured.myPayload, aReplayed.myPayload, aCaptured.mySize) == 0;
+	}
+
+	std::string Describe(const Record &aRecord, uint32_t aStartUs)
+	{
+		char text[96];
+		int length = snprintf(text, sizeof(text), "%s/%s", EventRecorder::GetSourceName(aRecord.mySource),
+							  EventTrace::GetName(aRecord.myId));
+		for (size_t byte = 0; byte < aRecord.mySize && length < 80; byte++)
+		{
+			length += snprintf(text + length, sizeof(text) - length, byte ? "%02x" : " %02x", aRecord.myPayload[byte]);
+		}
+		snprintf(text + length, sizeof(text) - length, " at %.3f s", (aRecord.myTimeUs - aStartUs) / 1e6);
+		return text;
+	}
+
+	bool Load(const char *aFile, std::vector<Record> &aRecords, uint32_t &anOverwritten)
+	{
+		FILE *file = fopen(aFile, "r");
+		if (!file)
+		{
+			fprintf(stderr, "Can't open %s\n", aFile);
+			return false;
+		}
+
+		char line[256];
+		while (fgets(line, sizeof(line), file))
+		{
+			Record record;
+			unsigned count;
+			unsigned overwritten;
+			if (EventRecorder::ParseLine(line, record))
+			{
+				aRecords.push_back(record);
+			}
+			else if (const char *begin = strstr(line, "EVREC BEGIN"); begin && sscanf(begin, "EVREC BEGIN %u %u", &count, &overwritten) == 2)
+			{
+				// A second dump in the same log replaces the first
+				aRecords.clear();
+				anOverwritten = overwritten;
+			}
+		}
+		fclose(file);
+		return true;
+	}
+
+	// Mirrors setup() in main.cpp without the display, LED and button task, starting from
+	// the speeds the machine had rather than the saved ones when they are given.
+	void Setup(const Options &anOptions)
+	{
+		HostSim::CpuLock cpu;
+		mySettings = std::make_shared<Settings>();
+		std::shared_ptr<SettingsData> savedSettings = mySettings->Get();
+		const int32_t rapid = anOptions.myRapidSpeed >= 0 ? anOptions.myRapidSpeed : savedSettings->myRapidSpeed;
+		const int32_t normal = anOptions.myNormalSpeed >= 0 ? anOptions.myNormalSpeed : savedSettings->myNormalSpeed;
+		const int32_t backlash = anOptions.myBacklash >= 0 ? anOptions.myBacklash : savedSettings->myBacklashSteps;
+
+		myStepper = std::make_shared<Stepper>();
+		myStepper->Init(dirPinStepper, enablePinStepper, stepPinStepper, rapid, normal);
+		myStepper->SetBacklash(backlash);
+		myState = std::make_shared<StateMachine>(myStepper);
+		// From a count of 0, where the machine starts from its saved count and so posts that as
+		// a speed change at boot. That change is in the recording if it goes back that far.
+		myEncoder = std::make_shared<RotaryEncoder>(ENCODER_A_PIN, ENCODER_B_PIN, ENCODER_BUTTON_PIN,
+												   maxStepsPerSecond, 0);
+
+		// The switches only read the real pins, which stay still here, the
+		// recorded presses go straight into the motion task's switch ring
+		MovementSwitches::Create();
+		MovementSwitches::AddSwitch(SwitchName::LEFT, std::make_shared<Switch>(LEFTPIN, 50, Event::MoveLeft, Event::StopMoveLeft));
+		MovementSwitches::AddSwitch(SwitchName::RIGHT, std::make_shared<Switch>(RIGHTPIN, 50, Event::MoveRight, Event::StopMoveRight));
+		MovementSwitches::AddSwitch(SwitchName::RAPID, std::make_shared<Switch>(RAPIDPIN, 50, Event::RapidSpeed, Event::NormalSpeed));
+
+		myState->Start();
+		MovementSwitches::Start(myState->GetSwitchCommands());
+		myEncoder->begin(myState->GetEncoderCommands());
+		printf("Starting from normal %d, rapid %d steps/s, backlash %d steps\n", normal, rapid, backlash);
+	}
+
+	// Feeds anInput in through the same door it came in by on the machine
+	void Inject(const Record &anInput)
+	{
+		const Event event = static_cast<Event>(anInput.myId);
+		const void *payload = anInput.mySize ? anInput.myPayload : nullptr;
+		bool posted = false;
+		switch (anInput.mySource)
+		{
+		case Source::Switches:
+			posted = myState->GetSwitchCommands().Post(event, payload, anInput.mySize);
+			break;
+		case Source::Encoder:
+			posted = myState->GetEncoderCommands().Post(event, payload, anInput.mySize);
+			break;
+		default:
+			posted = EventBus::Post(COMMAND_EVENT, anInput.myId, payload, anInput.mySize, 0) == ESP_OK;
+			break;
+		}
+		if (!posted)
+		{
+			printf("  couldn't post %s, its queue was full\n", EventTrace::GetName(anInput.myId));
+		}
+	}
+
+	bool Parse(int argc, char **argv, Options &anOptions)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const bool hasValue = i + 1 < argc;
+			if (strcmp(argv[i], "-v") == 0)
+			{
+				anOptions.myVerbose = true;
+			}
+			else if (strcmp(argv[i], "--normal") == 0 && hasValue)
+			{
+				anOptions.myNormalSpeed = atoi(argv[++i]);
+			}
+			else if (strcmp(argv[i], "--rapid") == 0 && hasValue)
+			{
+				anOptions.myRapidSpeed = atoi(argv[++i]);
+			}
+			else if (strcmp(argv[i], "--backlash") == 0 && hasValue)
+			{
+				anOptions.myBacklash = atoi(argv[++i]);
+			}
+			else if (argv[i][0] != '-' && !anOptions.myFile)
+			{
+				anOptions.myFile = argv[i];
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return anOptions.myFile != nullptr;
+	}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: %s [-v] [--normal N] [--rapid N] [--backlash N] capture.txt\n", argv[0]);
+		return 2;
+	}
+	esp_log_level_set("*", options.myVerbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+	std::vector<Record> captured;
+	uint32_t overwritten = 0;
+	if (!Load(options.myFile, captured, overwritten))
+	{
+		return 2;
+	}
+	if (captured.empty())
+	{
+		fprintf(stderr, "No event records in %s\n", options.myFile);
+		return 2;
+	}
+
+	std::vector<Record> inputs;
+	std::vector<Record> capturedOutputs;
+	for (const Record &record : captured)
+	{
+		if (IsInput(record))
+		{
+			inputs.push_back(record);
+		}
+		else if (IsOutput(record))
+		{
+			capturedOutputs.push_back(record);
+		}
+	}
+	const uint32_t firstUs = captured.front().myTimeUs;
+	const uint32_t spanUs = captured.back().myTimeUs - firstUs;
+	printf("Replaying %s: %zu records, %zu inputs and %zu outputs over %.3f s\n", options.myFile, captured.size(),
+		   inputs.size(), capturedOutputs.size(), spanUs / 1e6);
+	if (overwritten)
+	{
+		printf("  the machine overwrote %u older records, whatever they changed is assumed to be as at boot\n",
+			   overwritten);
+	}
+
+	Setup(options);
+	HostSim::Advance(100000);
+
+	uint64_t startUs;
+	{
+		HostSim::CpuLock cpu;
+		EventRecorder::Clear();
+		EventTrace::Reset();
+		startUs = HostSim::NowUs();
+	}
+	for (const Record &input : inputs)
+	{
+		HostSim::AdvanceTo(startUs + static_cast<uint32_t>(input.myTimeUs - firstUs));
+		HostSim::CpuLock cpu;
+		Inject(input);
+	}
+	// Long enough for the last stop to play out, and past the last recorded output
+	HostSim::AdvanceTo(startUs + spanUs + 2000000);
+
+	std::vector<Record> replayedOutputs;
+	{
+		HostSim::CpuLock cpu;
+		EventRecorder::SetEnabled(false);
+		Record record;
+		for (size_t i = 0; EventRecorder::GetRecord(i, record); i++)
+		{
+			if (IsOutput(record))
+			{
+				replayedOutputs.push_back(record);
+			}
+		}
+	}
+
+	size_t matched = 0;
+	double maxSkewMs = 0;
+	double totalSkewMs = 0;
+	const uint32_t replayStartUs = static_cast<uint32_t>(startUs);
+	while (matched < capturedOutputs.size() && matched < replayedOutputs.size() &&
+		   IsSameEvent(capturedOutputs[matched], replayedOutputs[matched]))
+	{
+		const double capturedMs = (capturedOutputs[matched].myTimeUs - firstUs) / 1000.0;
+		const double replayedMs = (replayedOutputs[matched].myTimeUs - replayStartUs) / 1000.0;
+		maxSkewMs = std::max(maxSkewMs, std::fabs(replayedMs - capturedMs));
+		totalSkewMs += std::fabs(replayedMs - capturedMs);
+		matched++;
+	}
+
+	printf("  %-34s %zu captured, %zu replayed, %zu the same in order\n", "outputs", capturedOutputs.size(),
+		   replayedOutputs.size(), matched);
+	if (matched)
+	{
+		printf("  %-34s max %9.2f  mean %9.2f ms\n", "timing against the capture", maxSkewMs, totalSkewMs / matched);
+	}
+	const bool same = matched == capturedOutputs.size() && matched == replayedOutputs.size();
+	if (!same)
+	{
+		printf("  first difference, output %zu\n", matched);
+		printf("    captured  %s\n", matched < capturedOutputs.size() ? Describe(capturedOutputs[matched], firstUs).c_str() : "nothing");
+		printf("    replayed  %s\n", matched < replayedOutputs.size() ? Describe(replayedOutputs[matched], replayStartUs).c_str() : "nothing");
+	}
+
+	{
+		HostSim::CpuLock cpu;
+		EventTrace::Print();
+	}
+	HostSim::Exit(same ? 0 : 1);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "EventBus.h"
+#include "EventRecorder.h"
+#include "EventTypes.h"
+
+/**
+ * @brief Lock-free ring for exactly one producer task and one consumer task.
+ *
+ * Each side only writes its own index, so a push or pop is a copy plus one atomic
+ * store, with no critical section or mutex. N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+	static_assert(N && (N & (N - 1)) == 0, "ring size must be a power of two");
+	static_assert(std::is_trivially_copyable<T>::value, "ring items are copied as bytes");
+
+  public:
+	bool Push(const T &anItem)
+	{
+		const uint32_t head = myHead.load(std::memory_order_relaxed);
+		if (head - myTail.load(std::memory_order_acquire) >= N)
+		{
+			return false;
+		}
+		myItems[head & (N - 1)] = anItem;
+		myHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T &anItem)
+	{
+		const uint32_t tail = myTail.load(std::memory_order_relaxed);
+		if (tail == myHead.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		anItem = myItems[tail & (N - 1)];
+		myTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const { return myTail.load(std::memory_order_acquire) == myHead.load(std::memory_order_acquire); }
+
+  private:
+	T myItems[N];
+	std::atomic<uint32_t> myHead{0};
+	std::atomic<uint32_t> myTail{0};
+};
+
+/**
+ **@brief A command on its way to the motion task, with the payload it was posted with
+ **/
+struct MotionCommand
+{
+	Event myEvent;
+	uint32_t mySize; // 0 when there is no payload
+	int64_t myPostedUs; // esp_timer clock, when it was first published
+	alignas(8) uint8_t myPayload[EventBus::PAYLOAD_SIZE];
+};
+
+/**
+ * @brief Commands from one producer task to the motion task.
+ *
+ * Post copies the command into the ring and gives the consumer a task notification,
+ * so delivery costs no more than that, instead of a trip through the shared event
+ * queue and its dispatch task.
+ */
+class CommandRing
+{
+  public:
+	static constexpr size_t LENGTH = 16;
+
+	/**
+	 **@brief aSource is what the event recorder files its commands under, None for a ring
+	 ** whose commands were already recorded on the way in
+	 **/
+	explicit CommandRing(EventRecorder::Source aSource = EventRecorder::Source::None) : mySource(aSource) {}
+
+	/**
+	 **@brief Queue E for the motion task with its payload, false if the ring is full
+	 **/
+	template <Event E>
+	bool Post(const EventPayloadType<E> &aPayload)
+	{
+		static_assert(sizeof(EventPayloadType<E>) <= EventBus::PAYLOAD_SIZE, "payload is larger than EventBus::PAYLOAD_SIZE");
+		return Post(E, &aPayload, sizeof(aPayload));
+	}
+
+	/**
+	 **@brief Queue a command without a payload, false if the ring is full or the event needs one
+	 **/
+	bool Post(Event anEvent) { return Post(anEvent, nullptr, 0); }
+
+	/**
+	 **@brief Queue a command with aSize bytes of payload, checked against the event registry.
+	 ** aPostedUs is when it was first published, if it was passed on from somewhere else.
+	 **/
+	bool Post(Event anEvent, const void *aPayload, size_t aSize, int64_t aPostedUs = 0)
+	{
+		if (!EventRegistry::IsValidPayload(anEvent, aPayload ? aSize : 0))
+		{
+			ESP_LOGE("CommandRing", "Event %d doesn't take a %u byte payload", static_cast<int>(anEvent),
+					 static_cast<unsigned>(aPayload ? aSize : 0));
+			return false;
+		}
+
+		MotionCommand command;
+		command.myEvent = anEvent;
+		command.mySize = aPayload ? aSize : 0;
+		command.myPostedUs = aPostedUs ? aPostedUs : esp_timer_get_time();
+		if (command.mySize)
+		{
+			memcpy(command.myPayload, aPayload, command.mySize);
+		}
+		if (!myRing.Push(command))
+		{
+			return false;
+		}
+		EventRecorder::Add(mySource, static_cast<int32_t>(anEvent), aPayload, command.mySize);
+
+		TaskHandle_t consumer = myConsumer.load(std::memory_order_acquire);
+		if (consumer)
+		{
+			xTaskNotifyGive(consumer);
+		}
+		return true;
+	}
+
+	bool Take(MotionCommand &aCommand) { return myRing.Pop(aCommand); }
+
+	/**
+	 **@brief Task to notify on each post. Commands posted before it is set wait for its first pass.
+	 **/
+	void SetConsumer(TaskHandle_t aTask) { myConsumer.store(aTask, std::memory_order_release); }
+
+  private:
+	SpscRing<MotionCommand, LENGTH> myRing;
+	std::atomic<TaskHandle_t> myConsumer{nullptr};
+	const EventRecorder::Source mySource;
+};
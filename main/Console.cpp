@@ -0,0 +1,143 @@
+#include "Console.h"
+#include "EventBus.h"
+#include "EventRecorder.h"
+#include "EventTrace.h"
+#include "MovementSwitches.h"
+#include "StateMachine.h"
+
+#include <cstdio>
+#include <cstring>
+#include <esp_console.h>
+#include <esp_log.h>
+
+std::shared_ptr<StateMachine> Console::myStateMachine;
+
+void Console::Start(std::shared_ptr<StateMachine> aStateMachine)
+{
+	myStateMachine = aStateMachine;
+
+	esp_console_repl_t *repl = nullptr;
+	esp_console_repl_config_t replConfig = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+	replConfig.prompt = "feed>";
+
+#if CONFIG_ESP_CONSOLE_USB_CDC
+	esp_console_dev_usb_cdc_config_t deviceConfig = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+	ESP_ERROR_CHECK(esp_console_new_repl_usb_cdc(&deviceConfig, &replConfig, &repl));
+#else
+	esp_console_dev_uart_config_t deviceConfig = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+	ESP_ERROR_CHECK(esp_console_new_repl_uart(&deviceConfig, &replConfig, &repl));
+#endif
+
+	esp_console_register_help_command();
+
+	const esp_console_cmd_t trace = {
+		.command = "trace",
+		.help = "Event latency and handler time histograms, 'trace reset' to clear them",
+		.hint = "[reset]",
+		.func = &TraceCommand,
+		.argtable = nullptr};
+	ESP_ERROR_CHECK(esp_console_cmd_register(&trace));
+
+	const esp_console_cmd_t record = {
+		.command = "record",
+		.help = "Dump the recorded events for the host replayer, 'record clear' to start over",
+		.hint = "[clear]",
+		.func = &RecordCommand,
+		.argtable = nullptr};
+	ESP_ERROR_CHECK(esp_console_cmd_register(&record));
+
+	const esp_console_cmd_t motion = {
+		.command = "motion",
+		.help = "Worst case time from a command being published to the motion task finishing with it, 'motion reset' to clear it",
+		.hint = "[reset]",
+		.func = &MotionCommand,
+		.argtable = nullptr};
+	ESP_ERROR_CHECK(esp_console_cmd_register(&motion));
+
+	const esp_console_cmd_t bus = {
+		.command = "bus",
+		.help = "Event bus queue depth, overflows and time posts spent waiting, per base and handler, 'bus reset' to clear them",
+		.hint = "[reset]",
+		.func = &BusCommand,
+		.argtable = nullptr};
+	ESP_ERROR_CHECK(esp_console_cmd_register(&bus));
+
+	const esp_console_cmd_t switches = {
+		.command = "switches",
+		.help = "Contact bounce and time to confirm, per movement switch, 'switches reset' to clear them",
+		.hint = "[reset]",
+		.func = &SwitchesCommand,
+		.argtable = nullptr};
+	ESP_ERROR_CHECK(esp_console_cmd_register(&switches));
+
+	ESP_ERROR_CHECK(esp_console_start_repl(repl));
+	ESP_LOGI("Console", "Console started");
+}
+
+int Console::TraceCommand(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		EventTrace::Reset();
+		return 0;
+	}
+
+	EventTrace::Print();
+	return 0;
+}
+
+int Console::RecordCommand(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "clear") == 0)
+	{
+		EventRecorder::Clear();
+		return 0;
+	}
+
+	// Nothing recorded while dumping, so a slow console can't have the ring lapping the dump
+	EventRecorder::SetEnabled(false);
+	EventRecorder::Dump(stdout);
+	EventRecorder::SetEnabled(true);
+	return 0;
+}
+
+int Console::MotionCommand(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		myStateMachine->ResetResponseStats();
+		return 0;
+	}
+
+	const StateMachine::ResponseStats stats = myStateMachine->GetResponseStats();
+	printf("motion task response, publish to handled\n");
+	printf("  commands %u  mean %lld us  worst %lld us (%s)\n", stats.myCommands,
+		   stats.myCommands ? stats.myTotalUs / stats.myCommands : 0LL, stats.myWorstUs,
+		   EventTrace::GetName(static_cast<int32_t>(stats.myWorstEvent)));
+	printf("  stops    %u  worst %lld us\n", stats.myStops, stats.myWorstStopUs);
+	return 0;
+}
+
+int Console::BusCommand(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		EventBus::ResetStats();
+		return 0;
+	}
+
+	EventBus::PrintStats();
+	return 0;
+}
+
+int Console::SwitchesCommand(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		MovementSwitches::ResetBounceStats();
+		return 0;
+	}
+
+	MovementSwitches::PrintStats();
+	return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+
+class StateMachine;
+
+/**
+ * @brief Serial console for reading telemetry off the machine.
+ *
+ * Runs an esp_console REPL on whichever console the sdkconfig picks (USB CDC on the
+ * S2/S3 boards). Commands:
+ *   trace        per event latency and handler time histograms, see EventTrace
+ *   trace reset  start the histograms over
+ *   record       dump the event recorder, for host/replay, see EventRecorder
+ *   record clear start the recording over
+ *   motion       the motion task's worst case response time, see StateMachine::ResponseStats
+ *   motion reset start the response times over
+ *   bus          event bus queue depths and overflows, per base and per handler
+ *   bus reset    start the counts and high water marks over
+ *   switches     contact bounce per movement switch, for setting its delay, see BounceStats
+ *   switches reset start the bounce statistics over
+ */
+class Console
+{
+  public:
+	static void Start(std::shared_ptr<StateMachine> aStateMachine);
+
+  private:
+	static int TraceCommand(int argc, char **argv);
+	static int RecordCommand(int argc, char **argv);
+	static int MotionCommand(int argc, char **argv);
+	static int BusCommand(int argc, char **argv);
+	static int SwitchesCommand(int argc, char **argv);
+
+	static std::shared_ptr<StateMachine> myStateMachine;
+};
@@ -0,0 +1,113 @@
+#include "DendoStepperBackend.h"
+
+#ifdef USE_DENDO_STEPPER
+
+std::unique_ptr<StepGenerator> CreateStepGenerator()
+{
+	return std::unique_ptr<StepGenerator>(new DendoStepperBackend());
+}
+
+void DendoStepperBackend::Init(uint8_t aDirPin, uint8_t anEnablePin, uint8_t aStepPin)
+{
+	myStepperCfg = {
+		.stepPin = aStepPin,
+		.dirPin = aDirPin,
+		.enPin = anEnablePin,
+		.timer_group = TIMER_GROUP_0,
+		.timer_idx = TIMER_0,
+		.miStep = MICROSTEP_1,
+		.stepAngle = 1.8};
+
+	myStepper.config(&myStepperCfg);
+	myStepper.init();
+}
+
+void DendoStepperBackend::SetSpeed(uint32_t aStepsPerSecond)
+{
+	double targetSpeed = aStepsPerSecond;
+	double currentSpeed = myStepper.getTargetSpeed();
+
+	if (targetSpeed == currentSpeed)
+	{
+		return;
+	}
+	double accTime = myStepper.getAcc();
+	double decTime = myStepper.getDec();
+
+	if (targetSpeed > currentSpeed)
+	{
+		// Accelerating
+		double speedDifference = targetSpeed - currentSpeed;
+		accTime = (speedDifference / MAX_DRIVER_STEPS_PER_SECOND) * FULL_SPEED_ACCELERATION_LINEAR_TIME;
+
+		//this becomes the stopping speed
+		decTime = (targetSpeed / MAX_DRIVER_STEPS_PER_SECOND) * FULL_SPEED_DECELERATION_LINEAR_TIME;
+
+		myStepper.setSpeed(targetSpeed, accTime, decTime);
+	}
+	else
+	{
+		// Decelerating
+		double speedDifference = currentSpeed - targetSpeed;
+		decTime = (speedDifference / MAX_DRIVER_STEPS_PER_SECOND) * FULL_SPEED_DECELERATION_LINEAR_TIME;
+
+		myStepper.setSpeed(targetSpeed, accTime, decTime);
+	}
+}
+
+uint32_t DendoStepperBackend::GetTargetSpeed()
+{
+	return myStepper.getTargetSpeed();
+}
+
+void DendoStepperBackend::Run(bool aForward)
+{
+	myForward = aForward;
+	myStepper.runInf(aForward);
+}
+
+void DendoStepperBackend::RunTo(int32_t aPosition)
+{
+	myForward = aPosition > GetPosition();
+	myStepper.runAbs(aPosition);
+}
+
+void DendoStepperBackend::Stop()
+{
+	myStepper.stop();
+}
+
+bool DendoStepperBackend::IsStopped()
+{
+	return myStepper.getState() == IDLE || myStepper.getState() == DISABLED;
+}
+
+int32_t DendoStepperBackend::GetCurrentSpeed()
+{
+	const int32_t speed = myStepper.getSpeed();
+	return myForward ? speed : -speed;
+}
+
+int32_t DendoStepperBackend::GetPosition()
+{
+	return static_cast<int32_t>(myStepper.getPosition());
+}
+
+std::string DendoStepperBackend::GetState()
+{
+	switch (myStepper.getState())
+	{
+	case IDLE:
+		return "IDLE";
+	case ACC:
+		return "ACCELERATING";
+	case DEC:
+		return "DECELERATING";
+	case COAST:
+		return "COASTING";
+	case DISABLED:
+		return "DISABLED";
+	}
+	return "ERROR";
+}
+#endif
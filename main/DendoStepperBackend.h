@@ -0,0 +1,33 @@
+#pragma once
+
+#include "config.h"
+
+#ifdef USE_DENDO_STEPPER
+#include "DendoStepper.h"
+#include "StepGenerator.h"
+
+/**
+ * @brief DendoStepper only ramps by itself, it has no step queue
+ */
+class DendoStepperBackend : public StepGenerator
+{
+  public:
+	void Init(uint8_t aDirPin, uint8_t anEnablePin, uint8_t aStepPin) override;
+	const char *GetName() override { return "DendoStepper"; }
+
+	void SetSpeed(uint32_t aStepsPerSecond) override;
+	uint32_t GetTargetSpeed() override;
+	void Run(bool aForward) override;
+	void RunTo(int32_t aPosition) override;
+	void Stop() override;
+	bool IsStopped() override;
+	int32_t GetCurrentSpeed() override;
+	std::string GetState() override;
+	int32_t GetPosition() override;
+
+  private:
+	DendoStepper myStepper;
+	DendoStepper_config_t myStepperCfg;
+	bool myForward = true;
+};
+#endif
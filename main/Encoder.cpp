@@ -7,6 +7,7 @@
 #include <esp_event.h>
 #include "EventTypes.h"
 #include "shared.h"
+#include <esp_timer.h>
 
 #include <rotary_encoder.h>
 
@@ -22,6 +23,7 @@ RotaryEncoder::RotaryEncoder(
 								   myPrevCount(0),
 								   myCount(0),
 								   myEncoder(nullptr),
+								   myButton(aButtonPin),
 								   myMaxStepsPerSecond(aMaxStepsPerSecond)
 																											
 {
@@ -42,12 +44,20 @@ RotaryEncoder::~RotaryEncoder()
 	pause();
 }
 
-void RotaryEncoder::begin()
+void RotaryEncoder::begin(CommandRing &aCommands)
 {
+	myCommands = &aCommands;
+
+	RegisterEventHandler(SETTINGS_EVENT, Event::SetSpeedUnit, &SpeedUnitEventCallback);
+	myButton.Start();
+
+	xTaskCreate(UpdateTask, "UpdateTask", 2048*4, this, 10, &myUpdateTask);
+
+	// An interrupt a detent rather than a look every so often
+	ESP_ERROR_CHECK(myEncoder->set_watch_step(myEncoder, ENCODER_COUNTS_PER_DETENT, &DetentHandler, this));
+
 	// Start encoder
 	ESP_ERROR_CHECK(myEncoder->start(myEncoder));
-	
-	xTaskCreate(UpdateTask, "UpdateTask", 2048*4, this, 10, NULL);
 }
 
 void RotaryEncoder::pause()
@@ -88,30 +98,76 @@ void RotaryEncoder::resume()
 	myEncoder->start(myEncoder);
 }
 
+void IRAM_ATTR RotaryEncoder::DetentHandler(void *anEncoder)
+{
+	RotaryEncoder *encoder = static_cast<RotaryEncoder *>(anEncoder);
+	BaseType_t woken = pdFALSE;
+	vTaskNotifyGiveFromISR(encoder->myUpdateTask, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
 void RotaryEncoder::UpdateTask(void *pvParameters)
 {
 	RotaryEncoder *encoder = (RotaryEncoder *)pvParameters;
 	
+	// Straight away for the saved count, then asleep until a detent, or shortly if the
+	// motion task had no room for the last one
+	TickType_t wait = 0;
 	while (true)
 	{
-		encoder->Update();
-		vTaskDelay(200 / portTICK_PERIOD_MS);
+		ulTaskNotifyTake(pdTRUE, wait);
+		encoder->myWakeups.fetch_add(1, std::memory_order_relaxed);
+		wait = encoder->Update() ? portMAX_DELAY : pdMS_TO_TICKS(RETRY_MS);
 	}
 }
 
-void RotaryEncoder::Update()
+void RotaryEncoder::SpeedUnitEventCallback(void *anEncoder, esp_event_base_t aBase, int32_t anId, void *aPayload)
+{
+	RotaryEncoder *encoder = static_cast<RotaryEncoder *>(static_cast<EventHandler *>(anEncoder));
+	encoder->SetSpeedUnit(GetPayload<Event::SetSpeedUnit>(aPayload)->myValue);
+}
+
+void RotaryEncoder::SetCurve(SpeedUnit aUnit, const EncoderCurve &aCurve)
+{
+	myCurves[static_cast<int>(aUnit)] = aCurve;
+}
+
+const EncoderCurve &RotaryEncoder::GetCurve(SpeedUnit aUnit) const
+{
+	return myCurves[static_cast<int>(aUnit)];
+}
+
+// true once everything turned has gone to the motion task
+bool RotaryEncoder::Update()
 {
 	myCount = getCount();
 
 	if (myPrevCount != myCount)
 	{	
+		// How fast it's turning, over the time since it last moved, so a single detent after
+		// a pause counts as slow
+		const int64_t now = esp_timer_get_time();
+		const float detents = static_cast<float>(myCount - myPrevCount) / ENCODER_COUNTS_PER_DETENT;
+		const float seconds = myLastTurnUs ? (now - myLastTurnUs) / 1e6f : 0;
+		const EncoderCurve &curve = GetCurve(mySpeedUnit);
+		float turnDelta = curve.GetSpeedDelta(detents, seconds);
+		if (myButton.IsPressed())
+		{
+			// Pressed and turned, coarse steps without having to spin it
+			myButton.NoteTurn();
+			turnDelta = curve.GetCoarseSpeedDelta(detents);
+		}
+		const float speedDelta = mySpeedRemainder + turnDelta;
+		const int32_t delta = static_cast<int32_t>(speedDelta);
 		
-		int32_t delta = (myCount - myPrevCount)*2;
+		// If the motion task's ring is full the turn isn't lost, it goes with the next update
+		if (delta != 0 && !myCommands->Post<Event::UpdateSpeed>(delta))
+		{
+			return false;
+		}
 		myPrevCount = myCount;
-		
-		auto *eventData = new SingleValueEventData<int32_t>(delta);
-
-		PublishEvent(COMMAND_EVENT, Event::UpdateSpeed, eventData);
-
+		myLastTurnUs = now;
+		mySpeedRemainder = speedDelta - delta;
 	}
+	return true;
 }
\ No newline at end of file
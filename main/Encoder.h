@@ -1,12 +1,16 @@
 #pragma once
 #include <driver/gpio.h>
 #include <esp_event.h>
+#include <atomic>
 #include <memory>
 
 #include <rotary_encoder.h>
 #include "Event.h"
+#include "CommandRing.h"
+#include "EncoderButton.h"
+#include "EncoderCurve.h"
 
-class RotaryEncoder : public EventPublisher {
+class RotaryEncoder : public EventPublisher, EventHandler {
 public:
   RotaryEncoder(gpio_num_t anAPin,
 				gpio_num_t aBPin,
@@ -14,13 +18,36 @@ public:
 				uint32_t maxStepsPerSecond,
 				int32_t aSavedEncoderCount = 0);
 	~RotaryEncoder();
-	void begin();
+	/**
+	 **@brief Start reading the encoder, sending speed changes through aCommands
+	 **/
+	void begin(CommandRing &aCommands);
 	int getCount();
 	void resetCount();
+
+	/**
+	 **@brief The unit the speed is shown in, whose curve turns are mapped through. Follows
+	 ** SetSpeedUnit on SETTINGS_EVENT once started.
+	 **/
+	void SetSpeedUnit(SpeedUnit aUnit) { mySpeedUnit = aUnit; }
+	/**
+	 **@brief Replace aUnit's curve, GetEncoderCurve's until then
+	 **/
+	void SetCurve(SpeedUnit aUnit, const EncoderCurve &aCurve);
+	const EncoderCurve &GetCurve(SpeedUnit aUnit) const;
+
+	/**
+	 **@brief Times the update task has woken, to show it sleeps while the knob is still
+	 **/
+	uint32_t GetWakeups() const { return myWakeups.load(std::memory_order_relaxed); }
+
+	const EncoderButton &GetButton() const { return myButton; }
   
 private:
 	static void UpdateTask(void *pvParameters);
-	void Update();
+	static void SpeedUnitEventCallback(void *anEncoder, esp_event_base_t aBase, int32_t anId, void *aPayload);
+	static void IRAM_ATTR DetentHandler(void *anEncoder);
+	bool Update();
 	void pause();
 	void resume();
 	int count;
@@ -32,5 +59,18 @@ private:
 	int mySavedCount;
 	std::shared_ptr<esp_event_loop_handle_t> myEventLoop;
 	rotary_encoder_t *myEncoder;
+	EncoderButton myButton;
+	CommandRing *myCommands = nullptr;
 	uint32_t myMaxStepsPerSecond;
+	TaskHandle_t myUpdateTask = nullptr;
+	std::atomic<uint32_t> myWakeups{0};
+
+	// How soon a turn the motion task's ring had no room for goes again
+	static constexpr uint32_t RETRY_MS = 5;
+
+	std::atomic<SpeedUnit> mySpeedUnit{SpeedUnit::MMPM};
+	EncoderCurve myCurves[2] = {MMPM_ENCODER_CURVE, IPM_ENCODER_CURVE}; // by SpeedUnit
+	int64_t myLastTurnUs = 0;
+	// What didn't come to a whole step/s yet, so fine steps don't round away
+	float mySpeedRemainder = 0;
 };
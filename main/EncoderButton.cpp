@@ -0,0 +1,194 @@
+#include "EncoderButton.h"
+
+#include "EventBus.h"
+
+#include <esp_log.h>
+#include <rom/gpio.h>
+
+EncoderButton::EncoderButton(gpio_num_t aPin) : myPin(aPin)
+{
+	gpio_pad_select_gpio(myPin);
+	gpio_set_direction(myPin, GPIO_MODE_INPUT);
+	gpio_set_pull_mode(myPin, GPIO_PULLUP_ONLY);
+}
+
+void EncoderButton::Start()
+{
+	const esp_timer_create_args_t debounceArgs = {
+		.callback = &DebounceTimerCallback,
+		.arg = this,
+		.dispatch_method = ESP_TIMER_TASK,
+		.name = "ButtonDebounce",
+		.skip_unhandled_events = false};
+	ESP_ERROR_CHECK(esp_timer_create(&debounceArgs, &myDebounceTimer));
+
+	const esp_timer_create_args_t gestureArgs = {
+		.callback = &GestureTimerCallback,
+		.arg = this,
+		.dispatch_method = ESP_TIMER_TASK,
+		.name = "ButtonGesture",
+		.skip_unhandled_events = false};
+	ESP_ERROR_CHECK(esp_timer_create(&gestureArgs, &myGestureTimer));
+
+	// Already installed is fine, the movement switches may have got there first
+	const esp_err_t installed = gpio_install_isr_service(0);
+	ESP_ERROR_CHECK(installed == ESP_ERR_INVALID_STATE ? ESP_OK : installed);
+	gpio_set_intr_type(myPin, GPIO_INTR_ANYEDGE);
+	ESP_ERROR_CHECK(gpio_isr_handler_add(myPin, &EdgeHandler, this));
+	gpio_intr_enable(myPin);
+}
+
+void EncoderButton::NoteTurn()
+{
+	myTurned.store(true, std::memory_order_relaxed);
+}
+
+uint32_t EncoderButton::GetCount(Gesture aGesture) const
+{
+	return myCounts[static_cast<int>(aGesture)].load(std::memory_order_relaxed);
+}
+
+// The first edge starts the debounce, the bounces after it land inside it and change nothing
+void IRAM_ATTR EncoderButton::EdgeHandler(void *anArg)
+{
+	EncoderButton *button = static_cast<EncoderButton *>(anArg);
+	if (!esp_timer_is_active(button->myDebounceTimer))
+	{
+		esp_timer_start_once(button->myDebounceTimer, DEBOUNCE_MS * 1000ULL);
+	}
+}
+
+void EncoderButton::DebounceTimerCallback(void *anArg)
+{
+	EncoderButton *button = static_cast<EncoderButton *>(anArg);
+
+	// Pulled up, so down reads low
+	const bool pressed = !gpio_get_level(button->myPin);
+	if (pressed == button->IsPressed())
+	{
+		return;
+	}
+
+	button->myPressed.store(pressed, std::memory_order_relaxed);
+	if (pressed)
+	{
+		button->OnPress();
+	}
+	else
+	{
+		button->OnRelease();
+	}
+}
+
+void EncoderButton::GestureTimerCallback(void *anArg)
+{
+	static_cast<EncoderButton *>(anArg)->OnTimeout();
+}
+
+void EncoderButton::OnPress()
+{
+	switch (myPhase)
+	{
+	case Phase::Idle:
+		myTurned.store(false, std::memory_order_relaxed);
+		myPhase = Phase::Pressed;
+		esp_timer_start_once(myGestureTimer, LONG_PRESS_MS * 1000ULL);
+		break;
+	case Phase::Released:
+		esp_timer_stop(myGestureTimer);
+		myPhase = Phase::SecondPress;
+		break;
+	default:
+		break;
+	}
+}
+
+void EncoderButton::OnRelease()
+{
+	const bool turned = myTurned.load(std::memory_order_relaxed);
+	switch (myPhase)
+	{
+	case Phase::Pressed:
+		esp_timer_stop(myGestureTimer);
+		if (turned)
+		{
+			Emit(Gesture::PressTurn);
+			myPhase = Phase::Idle;
+		}
+		else
+		{
+			myPhase = Phase::Released;
+			esp_timer_start_once(myGestureTimer, DOUBLE_PRESS_MS * 1000ULL);
+		}
+		break;
+	case Phase::SecondPress:
+		Emit(turned ? Gesture::PressTurn : Gesture::Double);
+		myPhase = Phase::Idle;
+		break;
+	case Phase::Held:
+		if (turned)
+		{
+			Emit(Gesture::PressTurn);
+		}
+		myPhase = Phase::Idle;
+		break;
+	default:
+		break;
+	}
+}
+
+void EncoderButton::OnTimeout()
+{
+	switch (myPhase)
+	{
+	case Phase::Pressed:
+		// Still down, sent now so the screen answers while it's held
+		if (!myTurned.load(std::memory_order_relaxed))
+		{
+			Emit(Gesture::Long);
+		}
+		myPhase = Phase::Held;
+		break;
+	case Phase::Released:
+		Emit(Gesture::Short);
+		myPhase = Phase::Idle;
+		break;
+	default:
+		break;
+	}
+}
+
+void EncoderButton::Emit(Gesture aGesture)
+{
+	myCounts[static_cast<int>(aGesture)].fetch_add(1, std::memory_order_relaxed);
+	ESP_LOGI("EncoderButton", "%s", GetGestureName(aGesture));
+
+	const Event command = GESTURE_COMMANDS[static_cast<int>(aGesture)];
+	if (command == Event::Count)
+	{
+		return;
+	}
+
+	// Not waiting on the timer task, a full event bus loses the gesture rather than holding up every timer
+	if (EventBus::Post(COMMAND_EVENT, static_cast<int32_t>(command), nullptr, 0, 0) != ESP_OK)
+	{
+		ESP_LOGW("EncoderButton", "%s dropped, the event bus is full", GetGestureName(aGesture));
+	}
+}
+
+const char *EncoderButton::GetGestureName(Gesture aGesture)
+{
+	switch (aGesture)
+	{
+	case Gesture::Short:
+		return "short press";
+	case Gesture::Long:
+		return "long press";
+	case Gesture::Double:
+		return "double press";
+	case Gesture::PressTurn:
+		return "press and turn";
+	default:
+		return "?";
+	}
+}
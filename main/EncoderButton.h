@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <driver/gpio.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#include "EventTypes.h"
+
+/**
+ * @brief Gestures on the encoder's push button, told apart by interrupts and timers rather
+ * than a task watching the pin.
+ *
+ * An edge starts a debounce timer, and the level when it fires is the button's. A press held
+ * LONG_PRESS_MS is a long press, sent while it is still held. A press let go sooner waits
+ * DOUBLE_PRESS_MS for a second one, and is a short press if none comes. Turning the knob
+ * while the button is down makes it a press and turn instead, and the encoder changes the
+ * speed in coarse steps for as long as it is held; nothing is sent on release.
+ *
+ * Short, long and double presses go out on COMMAND_EVENT as GESTURE_COMMANDS says.
+ */
+class EncoderButton
+{
+  public:
+	enum class Gesture : uint8_t
+	{
+		Short,
+		Long,
+		Double,
+		PressTurn,
+		Count
+	};
+
+	// What each gesture sends, Event::Count for nothing
+	static constexpr Event GESTURE_COMMANDS[static_cast<int>(Gesture::Count)] = {
+		Event::ToggleView,	 // Short
+		Event::ToggleUnits,	 // Long
+		Event::ZeroPosition, // Double, zero the DRO
+		Event::Count		 // PressTurn, the encoder takes care of it
+	};
+
+	static constexpr uint32_t DEBOUNCE_MS = 10;
+	static constexpr uint32_t LONG_PRESS_MS = 1000;
+	static constexpr uint32_t DOUBLE_PRESS_MS = 300;
+
+	explicit EncoderButton(gpio_num_t aPin);
+
+	/**
+	 **@brief Take the pin's interrupt and create the timers, once the event bus is up
+	 **/
+	void Start();
+
+	/**
+	 **@brief Down, debounced. The encoder asks on each detent.
+	 **/
+	bool IsPressed() const { return myPressed.load(std::memory_order_relaxed); }
+
+	/**
+	 **@brief The knob turned while the button was down, so this press is a press and turn.
+	 ** From the encoder's task.
+	 **/
+	void NoteTurn();
+
+	uint32_t GetCount(Gesture aGesture) const;
+	static const char *GetGestureName(Gesture aGesture);
+
+  private:
+	enum class Phase : uint8_t
+	{
+		Idle,
+		Pressed,	 // down, a long press or a turn will decide it
+		Held,		 // down and decided, nothing more until it's let go
+		Released,	 // let go, waiting to see if a second press follows
+		SecondPress, // down again inside the window
+	};
+
+	static void IRAM_ATTR EdgeHandler(void *anArg);
+	static void DebounceTimerCallback(void *anArg);
+	static void GestureTimerCallback(void *anArg);
+
+	// These run on the esp_timer task, one at a time
+	void OnPress();
+	void OnRelease();
+	void OnTimeout();
+	void Emit(Gesture aGesture);
+
+	gpio_num_t myPin;
+	esp_timer_handle_t myDebounceTimer = nullptr;
+	esp_timer_handle_t myGestureTimer = nullptr;
+	Phase myPhase = Phase::Idle;
+	std::atomic<bool> myPressed{false};
+	std::atomic<bool> myTurned{false};
+	std::atomic<uint32_t> myCounts[static_cast<int>(Gesture::Count)] = {};
+};
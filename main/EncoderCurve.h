@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include "config.h"
+#include "state.h"
+
+/**
+ * @brief How much a detent of the speed knob changes the speed, by how fast it is turned.
+ *
+ * Turned slowly, every detent is myFineStep, for setting a finishing feed exactly. Above
+ * mySlowRate the step grows with the square of how far the rate is towards myFastRate, and
+ * spun at myFastRate or faster every detent is myCoarseStep, so going from a finishing feed
+ * to a roughing one takes a flick rather than many turns. Steps are in the unit the speed is
+ * shown in, so a detent moves the display by the same round amount in either unit.
+ */
+struct EncoderCurve
+{
+	float myFineStep;	// per detent, in the unit per minute
+	float myCoarseStep; // per detent, at myFastRate and above
+	float mySlowRate;	// detents per second, at or below which every detent is a fine step
+	float myFastRate;
+	float myMmPerUnit;
+
+	constexpr float GetStep(float aDetentsPerSecond) const
+	{
+		if (aDetentsPerSecond <= mySlowRate)
+		{
+			return myFineStep;
+		}
+		if (aDetentsPerSecond >= myFastRate)
+		{
+			return myCoarseStep;
+		}
+		const float towardsFast = (aDetentsPerSecond - mySlowRate) / (myFastRate - mySlowRate);
+		return myFineStep + (myCoarseStep - myFineStep) * towardsFast * towardsFast;
+	}
+
+	/**
+	 **@brief Speed change in steps/s for aDetents, signed, turned over aSeconds
+	 **/
+	float GetSpeedDelta(float aDetents, float aSeconds) const
+	{
+		const float detents = aDetents < 0 ? -aDetents : aDetents;
+		const float rate = aSeconds > 0 ? detents / aSeconds : 0;
+		return aDetents * GetStep(rate) * myMmPerUnit * stepsPerMm / 60;
+	}
+
+	/**
+	 **@brief Speed change in steps/s for aDetents all at the coarse step, however slowly turned
+	 **/
+	float GetCoarseSpeedDelta(float aDetents) const { return aDetents * myCoarseStep * myMmPerUnit * stepsPerMm / 60; }
+};
+
+// Half a mm/min a detent, about what a detent used to be, to 25 mm/min spun fast
+constexpr EncoderCurve MMPM_ENCODER_CURVE = {0.5f, 25.0f, 5.0f, 40.0f, 1.0f};
+// 0.02 IPM a detent to 1 IPM
+constexpr EncoderCurve IPM_ENCODER_CURVE = {0.02f, 1.0f, 5.0f, 40.0f, 25.4f};
+
+constexpr const EncoderCurve &GetEncoderCurve(SpeedUnit aUnit)
+{
+	return aUnit == SpeedUnit::IPM ? IPM_ENCODER_CURVE : MMPM_ENCODER_CURVE;
+}
@@ -7,5 +7,4 @@ ESP_EVENT_DEFINE_BASE(SETTINGS_EVENT);
 ESP_EVENT_DEFINE_BASE(STATE_TRANSITION_EVENT);
 ESP_EVENT_DEFINE_BASE(UI_EVENT);
 
-bool EventBase::myEventLoopInstalled = false;
-std::string EventPublisher::myPublisherName = "EventPublisher";
\ No newline at end of file
+bool EventBase::myEventLoopInstalled = false;
\ No newline at end of file
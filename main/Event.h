@@ -1,8 +1,10 @@
 #pragma once
 #include <esp_event.h>
+#include "EventBus.h"
 #include "EventTypes.h"
 #include "shared.h"
-#include <typeinfo>
+#include <esp_log.h>
+#include <type_traits>
 
 class EventBase
 {
@@ -11,7 +13,7 @@ class EventBase
 	{
 		if (!myEventLoopInstalled)
 		{
-			ESP_ERROR_CHECK(esp_event_loop_create_default());
+			EventBus::Start();
 			myEventLoopInstalled = true;
 		}
 	};
@@ -25,26 +27,31 @@ class EventPublisher : public EventBase
   public:
 	EventPublisher() : EventBase()
 	{
-		//myPublisherName = DemangleTypeName(typeid(*this).name());
 	}
 	virtual ~EventPublisher(){};
 
-	template <typename T>
-	static esp_err_t PublishEvent(esp_event_base_t aBase, Event event, T *eventData)
+	/**
+	 **@brief Post E with its payload, of the type EventPayload<E> gives it, copied by value into the event queue
+	 **/
+	template <Event E>
+	static esp_err_t PublishEvent(esp_event_base_t aBase, const EventPayloadType<E> &eventData)
 	{
-		static_assert(std::is_base_of<EventData, T>::value, "T must be derived from EventData");
-		//EventData *baseEventData = static_cast<EventData *>(eventData);
-
-		//baseEventData->myPublisher = myPublisherName;
-		return esp_event_post(aBase, static_cast<int32_t>(event), (void *)eventData, sizeof(T), portTICK_PERIOD_MS * 200);
+		static_assert(sizeof(EventPayloadType<E>) <= EventBus::PAYLOAD_SIZE, "payload is larger than EventBus::PAYLOAD_SIZE");
+		return EventBus::Post(aBase, static_cast<int32_t>(E), &eventData, sizeof(eventData), portTICK_PERIOD_MS * 200);
 	}
 
+	/**
+	 **@brief Post an event without a payload. Refused, with an error, for one that needs a payload.
+	 **/
 	static esp_err_t PublishEvent(esp_event_base_t aBase, Event event)
 	{
-		return esp_event_post(aBase, static_cast<int32_t>(event), nullptr, sizeof(nullptr), portTICK_PERIOD_MS * 200);
+		if (!EventRegistry::IsValidPayload(event, 0))
+		{
+			ESP_LOGE("Event", "Event %d needs a payload", static_cast<int>(event));
+			return ESP_ERR_INVALID_ARG;
+		}
+		return EventBus::Post(aBase, static_cast<int32_t>(event), nullptr, 0, portTICK_PERIOD_MS * 200);
 	}
-  protected:
-	static std::string myPublisherName;
 };
 
 class EventHandler : public EventBase
@@ -55,7 +62,7 @@ class EventHandler : public EventBase
 	}
 	virtual void RegisterEventHandler(esp_event_base_t aBase, Event event, esp_event_handler_t callback)
 	{
-		ESP_ERROR_CHECK(esp_event_handler_instance_register(aBase, (int32_t)event, callback, this, nullptr));
+		ESP_ERROR_CHECK(EventBus::Register(aBase, (int32_t)event, callback, this));
 	};
 
 	esp_event_base_t myBase;
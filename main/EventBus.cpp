@@ -0,0 +1,515 @@
+#include "EventBus.h"
+
+#include "EventRecorder.h"
+#include "EventTrace.h"
+#include "EventTypes.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+EventBus::Envelope EventBus::myRing[QUEUE_LENGTH];
+size_t EventBus::myRingHead = 0;
+size_t EventBus::myRingCount = 0;
+SemaphoreHandle_t EventBus::mySpace = nullptr;
+StaticSemaphore_t EventBus::mySpaceBuffer;
+portMUX_TYPE EventBus::myLock = portMUX_INITIALIZER_UNLOCKED;
+bool EventBus::myStarted = false;
+
+QueueHandle_t EventBus::myUrgentQueue = nullptr;
+StaticQueue_t EventBus::myUrgentQueueBuffer;
+uint8_t EventBus::myUrgentQueueStorage[URGENT_QUEUE_LENGTH * sizeof(Envelope)];
+TaskHandle_t EventBus::myDispatchTask = nullptr;
+
+EventBus::Handler EventBus::myHandlers[MAX_HANDLERS];
+std::atomic<size_t> EventBus::myHandlerCount{0};
+int64_t EventBus::myDispatchingPostedUs = 0;
+
+EventBus::BaseStats EventBus::myBases[MAX_BASES];
+size_t EventBus::myBaseCount = 0;
+EventBus::HandlerStats EventBus::myHandlerStats[MAX_HANDLERS];
+
+std::atomic<uint32_t> EventBus::myPosted{0};
+std::atomic<uint32_t> EventBus::myDispatched{0};
+std::atomic<uint32_t> EventBus::myTimeouts{0};
+std::atomic<size_t> EventBus::myHighWater{0};
+std::atomic<uint32_t> EventBus::myUrgent{0};
+std::atomic<uint32_t> EventBus::myDropped{0};
+std::atomic<uint32_t> EventBus::myCoalesced{0};
+
+void EventBus::Start()
+{
+	if (myStarted)
+	{
+		return;
+	}
+
+	mySpace = xSemaphoreCreateCountingStatic(QUEUE_LENGTH, QUEUE_LENGTH, &mySpaceBuffer);
+	myUrgentQueue = xQueueCreateStatic(URGENT_QUEUE_LENGTH, sizeof(Envelope), myUrgentQueueStorage, &myUrgentQueueBuffer);
+	myStarted = true;
+
+	// Settings events carry the value to save, so only the newest of each matters. State
+	// transitions only drive the display, which needs the latest one. Commands and UI
+	// updates carry deltas or presses that mustn't be lost, so they wait for room.
+	SetOverflowPolicy(SETTINGS_EVENT, OverflowPolicy::Coalesce);
+	SetOverflowPolicy(STATE_TRANSITION_EVENT, OverflowPolicy::DropOldest);
+
+	xTaskCreatePinnedToCore(DispatchTask, "EventBus", DISPATCH_STACK_SIZE, nullptr, DISPATCH_PRIORITY, &myDispatchTask, 0);
+}
+
+esp_err_t EventBus::Post(esp_event_base_t aBase, int32_t anId, const void *aData, size_t aSize, TickType_t aTicksToWait)
+{
+	if (!myStarted)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	if (aSize > PAYLOAD_SIZE)
+	{
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	Envelope envelope;
+	envelope.myBase = aBase;
+	envelope.myId = anId;
+	envelope.mySize = aData ? aSize : 0;
+	envelope.myPostedUs = esp_timer_get_time();
+	if (envelope.mySize)
+	{
+		memcpy(envelope.myPayload, aData, envelope.mySize);
+	}
+
+	portENTER_CRITICAL(&myLock);
+	envelope.myBaseSlot = FindBase(aBase, true);
+	envelope.mySubscribers = GetSubscribers(aBase, anId);
+	const OverflowPolicy policy =
+		envelope.myBaseSlot == NO_BASE_SLOT ? OverflowPolicy::Block : myBases[envelope.myBaseSlot].myPolicy;
+	portEXIT_CRITICAL(&myLock);
+
+	const bool urgent = anId >= 0 && anId < static_cast<int32_t>(EVENT_COUNT) && EventRegistry::IsUrgent(static_cast<Event>(anId));
+	esp_err_t result = ESP_OK;
+	bool blocked = false;
+	bool dropped = false;
+	const int64_t start = esp_timer_get_time();
+	if (urgent)
+	{
+		// Never dropped, the lane is for stops. Counted in before it goes in, so the
+		// dispatch task can't take it out of the depths first.
+		portENTER_CRITICAL(&myLock);
+		AddDepth(envelope);
+		portEXIT_CRITICAL(&myLock);
+		if (xQueueSend(myUrgentQueue, &envelope, 0) != pdPASS)
+		{
+			blocked = aTicksToWait != 0;
+			result = xQueueSend(myUrgentQueue, &envelope, aTicksToWait) == pdPASS ? ESP_OK : ESP_ERR_TIMEOUT;
+		}
+		if (result != ESP_OK)
+		{
+			portENTER_CRITICAL(&myLock);
+			RemoveDepth(envelope);
+			portEXIT_CRITICAL(&myLock);
+		}
+	}
+	else
+	{
+		bool hasRoom = xSemaphoreTake(mySpace, 0) == pdPASS;
+		if (!hasRoom && policy == OverflowPolicy::Block && aTicksToWait != 0)
+		{
+			blocked = true;
+			hasRoom = xSemaphoreTake(mySpace, aTicksToWait) == pdPASS;
+		}
+
+		portENTER_CRITICAL(&myLock);
+		if (hasRoom)
+		{
+			Append(envelope);
+		}
+		else if (policy == OverflowPolicy::DropOldest || policy == OverflowPolicy::Coalesce)
+		{
+			dropped = Replace(envelope, policy);
+		}
+		portEXIT_CRITICAL(&myLock);
+
+		if (!hasRoom && !dropped)
+		{
+			result = policy == OverflowPolicy::Block && aTicksToWait != 0 ? ESP_ERR_TIMEOUT : ESP_ERR_NO_MEM;
+		}
+	}
+
+	portENTER_CRITICAL(&myLock);
+	if (envelope.myBaseSlot != NO_BASE_SLOT)
+	{
+		BaseStats &base = myBases[envelope.myBaseSlot];
+		(result == ESP_OK ? base.myPosted : base.myRefused)++;
+		if (blocked)
+		{
+			const int64_t blockedUs = esp_timer_get_time() - start;
+			base.myBlocked++;
+			base.myBlockedUs += blockedUs;
+			base.myMaxBlockedUs = std::max(base.myMaxBlockedUs, blockedUs);
+		}
+	}
+	portEXIT_CRITICAL(&myLock);
+
+	if (result != ESP_OK)
+	{
+		myTimeouts.fetch_add(1, std::memory_order_relaxed);
+		return result;
+	}
+	// Before the dispatch task can run, so the recording never shows what it set off first
+	EventRecorder::Add(aBase, anId, aData, envelope.mySize);
+	xTaskNotifyGive(myDispatchTask);
+
+	myPosted.fetch_add(1, std::memory_order_relaxed);
+	if (urgent)
+	{
+		myUrgent.fetch_add(1, std::memory_order_relaxed);
+	}
+	return ESP_OK;
+}
+
+esp_err_t EventBus::Register(esp_event_base_t aBase, int32_t anId, esp_event_handler_t aHandler, void *anArg)
+{
+	const size_t count = myHandlerCount.load(std::memory_order_relaxed);
+	if (!aHandler)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (count >= MAX_HANDLERS)
+	{
+		ESP_LOGE("EventBus", "No room for another handler, raise MAX_HANDLERS");
+		return ESP_ERR_NO_MEM;
+	}
+
+	myHandlers[count] = Handler{aBase, anId, aHandler, anArg};
+	// The dispatch task only reads entries below the count, so publish the entry first
+	myHandlerCount.store(count + 1, std::memory_order_release);
+	return ESP_OK;
+}
+
+bool EventBus::GetHandler(size_t aSlot, esp_event_base_t &aBase, int32_t &anId)
+{
+	if (aSlot >= myHandlerCount.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+	aBase = myHandlers[aSlot].myBase;
+	anId = myHandlers[aSlot].myId;
+	return true;
+}
+
+esp_err_t EventBus::SetOverflowPolicy(esp_event_base_t aBase, OverflowPolicy aPolicy)
+{
+	portENTER_CRITICAL(&myLock);
+	const uint8_t slot = FindBase(aBase, true);
+	if (slot != NO_BASE_SLOT)
+	{
+		myBases[slot].myPolicy = aPolicy;
+	}
+	portEXIT_CRITICAL(&myLock);
+
+	if (slot == NO_BASE_SLOT)
+	{
+		ESP_LOGE("EventBus", "No room for another base, raise MAX_BASES");
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
+
+EventBus::Stats EventBus::GetStats()
+{
+	Stats stats;
+	stats.myPosted = myPosted.load(std::memory_order_relaxed);
+	stats.myDispatched = myDispatched.load(std::memory_order_relaxed);
+	stats.myTimeouts = myTimeouts.load(std::memory_order_relaxed);
+	stats.myHighWater = myHighWater.load(std::memory_order_relaxed);
+	stats.myUrgent = myUrgent.load(std::memory_order_relaxed);
+	stats.myDropped = myDropped.load(std::memory_order_relaxed);
+	stats.myCoalesced = myCoalesced.load(std::memory_order_relaxed);
+	return stats;
+}
+
+bool EventBus::GetBaseStats(size_t aSlot, BaseStats &aStats)
+{
+	portENTER_CRITICAL(&myLock);
+	const bool found = aSlot < myBaseCount;
+	if (found)
+	{
+		aStats = myBases[aSlot];
+	}
+	portEXIT_CRITICAL(&myLock);
+	return found;
+}
+
+bool EventBus::GetHandlerStats(size_t aSlot, HandlerStats &aStats)
+{
+	if (aSlot >= myHandlerCount.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+	portENTER_CRITICAL(&myLock);
+	aStats = myHandlerStats[aSlot];
+	portEXIT_CRITICAL(&myLock);
+	return true;
+}
+
+void EventBus::ResetStats()
+{
+	myPosted.store(0, std::memory_order_relaxed);
+	myDispatched.store(0, std::memory_order_relaxed);
+	myTimeouts.store(0, std::memory_order_relaxed);
+	myUrgent.store(0, std::memory_order_relaxed);
+	myDropped.store(0, std::memory_order_relaxed);
+	myCoalesced.store(0, std::memory_order_relaxed);
+
+	portENTER_CRITICAL(&myLock);
+	myHighWater.store(myRingCount, std::memory_order_relaxed);
+	for (size_t slot = 0; slot < myBaseCount; slot++)
+	{
+		BaseStats &base = myBases[slot];
+		const BaseStats kept = base;
+		base = BaseStats();
+		base.myBase = kept.myBase;
+		base.myPolicy = kept.myPolicy;
+		base.myDepth = kept.myDepth;
+		base.myHighWater = kept.myDepth;
+	}
+	for (HandlerStats &handler : myHandlerStats)
+	{
+		handler.myHighWater = handler.myDepth;
+	}
+	portEXIT_CRITICAL(&myLock);
+}
+
+void EventBus::PrintStats()
+{
+	const Stats stats = GetStats();
+	printf("event bus, %u posted, %u refused, %u dropped, %u coalesced, high water %u of %u\n", stats.myPosted,
+		   stats.myTimeouts, stats.myDropped, stats.myCoalesced, static_cast<unsigned>(stats.myHighWater),
+		   static_cast<unsigned>(QUEUE_LENGTH));
+	printf("  %-22s %-11s %7s %7s %7s %9s %5s %5s %7s %11s\n", "base", "overflow", "posted", "refused", "dropped",
+		   "coalesced", "depth", "high", "blocked", "max blocked");
+
+	// Copied out first, nothing slow happens with the lock held
+	BaseStats base;
+	for (size_t slot = 0; GetBaseStats(slot, base); slot++)
+	{
+		printf("  %-22s %-11s %7u %7u %7u %9u %5u %5u %7u %8.2f ms\n", base.myBase, GetPolicyName(base.myPolicy),
+			   base.myPosted, base.myRefused, base.myDropped, base.myCoalesced, static_cast<unsigned>(base.myDepth),
+			   static_cast<unsigned>(base.myHighWater), base.myBlocked, base.myMaxBlockedUs / 1000.0);
+	}
+
+	printf("  %-34s %5s %5s\n", "handler", "depth", "high");
+	HandlerStats handler;
+	for (size_t slot = 0; GetHandlerStats(slot, handler); slot++)
+	{
+		esp_event_base_t handlerBase;
+		int32_t id;
+		if (!GetHandler(slot, handlerBase, id))
+		{
+			continue;
+		}
+		char name[64];
+		snprintf(name, sizeof(name), "%u %s/%s", static_cast<unsigned>(slot), handlerBase ? handlerBase : "any",
+				 id == ESP_EVENT_ANY_ID ? "any" : EventTrace::GetName(id));
+		printf("  %-34s %5u %5u\n", name, static_cast<unsigned>(handler.myDepth), static_cast<unsigned>(handler.myHighWater));
+	}
+}
+
+const char *EventBus::GetPolicyName(OverflowPolicy aPolicy)
+{
+	switch (aPolicy)
+	{
+	case OverflowPolicy::Block:
+		return "block";
+	case OverflowPolicy::Reject:
+		return "reject";
+	case OverflowPolicy::DropOldest:
+		return "drop oldest";
+	case OverflowPolicy::Coalesce:
+		return "coalesce";
+	default:
+		return "?";
+	}
+}
+
+uint8_t EventBus::FindBase(esp_event_base_t aBase, bool aClaim)
+{
+	for (size_t slot = 0; slot < myBaseCount; slot++)
+	{
+		if (myBases[slot].myBase == aBase)
+		{
+			return static_cast<uint8_t>(slot);
+		}
+	}
+	if (!aClaim || myBaseCount >= MAX_BASES)
+	{
+		return NO_BASE_SLOT;
+	}
+	myBases[myBaseCount] = BaseStats();
+	myBases[myBaseCount].myBase = aBase;
+	return static_cast<uint8_t>(myBaseCount++);
+}
+
+uint16_t EventBus::GetSubscribers(esp_event_base_t aBase, int32_t anId)
+{
+	uint16_t subscribers = 0;
+	const size_t count = myHandlerCount.load(std::memory_order_acquire);
+	for (size_t i = 0; i < count; i++)
+	{
+		const Handler &handler = myHandlers[i];
+		if ((handler.myBase == ESP_EVENT_ANY_BASE || handler.myBase == aBase) &&
+			(handler.myId == ESP_EVENT_ANY_ID || handler.myId == anId))
+		{
+			subscribers |= 1u << i;
+		}
+	}
+	return subscribers;
+}
+
+void EventBus::AddDepth(const Envelope &anEnvelope)
+{
+	if (anEnvelope.myBaseSlot != NO_BASE_SLOT)
+	{
+		BaseStats &base = myBases[anEnvelope.myBaseSlot];
+		base.myDepth++;
+		base.myHighWater = std::max(base.myHighWater, base.myDepth);
+	}
+	for (size_t i = 0; i < MAX_HANDLERS; i++)
+	{
+		if (anEnvelope.mySubscribers & (1u << i))
+		{
+			HandlerStats &handler = myHandlerStats[i];
+			handler.myDepth++;
+			handler.myHighWater = std::max(handler.myHighWater, handler.myDepth);
+		}
+	}
+}
+
+void EventBus::RemoveDepth(const Envelope &anEnvelope)
+{
+	if (anEnvelope.myBaseSlot != NO_BASE_SLOT)
+	{
+		myBases[anEnvelope.myBaseSlot].myDepth--;
+	}
+	for (size_t i = 0; i < MAX_HANDLERS; i++)
+	{
+		if (anEnvelope.mySubscribers & (1u << i))
+		{
+			myHandlerStats[i].myDepth--;
+		}
+	}
+}
+
+void EventBus::Append(const Envelope &anEnvelope)
+{
+	myRing[(myRingHead + myRingCount) % QUEUE_LENGTH] = anEnvelope;
+	myRingCount++;
+	AddDepth(anEnvelope);
+	if (myRingCount > myHighWater.load(std::memory_order_relaxed))
+	{
+		myHighWater.store(myRingCount, std::memory_order_relaxed);
+	}
+}
+
+void EventBus::RemoveAt(size_t anIndex)
+{
+	RemoveDepth(myRing[(myRingHead + anIndex) % QUEUE_LENGTH]);
+	for (size_t i = anIndex; i + 1 < myRingCount; i++)
+	{
+		myRing[(myRingHead + i) % QUEUE_LENGTH] = myRing[(myRingHead + i + 1) % QUEUE_LENGTH];
+	}
+	myRingCount--;
+}
+
+bool EventBus::Replace(const Envelope &anEnvelope, OverflowPolicy aPolicy)
+{
+	// The one it replaces goes and this one joins the back, so the newest is dispatched
+	// after everything already queued, as it would have been with room for it
+	for (size_t i = 0; i < myRingCount; i++)
+	{
+		const Envelope &queued = myRing[(myRingHead + i) % QUEUE_LENGTH];
+		if (queued.myBase == anEnvelope.myBase && (aPolicy == OverflowPolicy::DropOldest || queued.myId == anEnvelope.myId))
+		{
+			RemoveAt(i);
+			Append(anEnvelope);
+			if (anEnvelope.myBaseSlot != NO_BASE_SLOT)
+			{
+				BaseStats &base = myBases[anEnvelope.myBaseSlot];
+				(aPolicy == OverflowPolicy::DropOldest ? base.myDropped : base.myCoalesced)++;
+			}
+			(aPolicy == OverflowPolicy::DropOldest ? myDropped : myCoalesced).fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool EventBus::Pop(Envelope &anEnvelope)
+{
+	if (myRingCount == 0)
+	{
+		return false;
+	}
+	anEnvelope = myRing[myRingHead];
+	myRingHead = (myRingHead + 1) % QUEUE_LENGTH;
+	myRingCount--;
+	RemoveDepth(anEnvelope);
+	return true;
+}
+
+void EventBus::DispatchTask(void *aParam)
+{
+	Envelope envelope;
+	while (true)
+	{
+		// Every post gives a notification, so nothing queued is missed while waiting on it
+		if (xQueueReceive(myUrgentQueue, &envelope, 0) == pdPASS)
+		{
+			portENTER_CRITICAL(&myLock);
+			RemoveDepth(envelope);
+			portEXIT_CRITICAL(&myLock);
+			Dispatch(envelope);
+			continue;
+		}
+
+		portENTER_CRITICAL(&myLock);
+		const bool popped = Pop(envelope);
+		portEXIT_CRITICAL(&myLock);
+		if (popped)
+		{
+			xSemaphoreGive(mySpace);
+			Dispatch(envelope);
+			continue;
+		}
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+}
+
+void EventBus::Dispatch(Envelope &anEnvelope)
+{
+	const int64_t latencyUs = esp_timer_get_time() - anEnvelope.myPostedUs;
+	myDispatchingPostedUs = anEnvelope.myPostedUs;
+
+	void *data = anEnvelope.mySize ? anEnvelope.myPayload : nullptr;
+	const size_t count = myHandlerCount.load(std::memory_order_acquire);
+	uint32_t handlerNs = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Handler &handler = myHandlers[i];
+		const bool baseMatches = handler.myBase == ESP_EVENT_ANY_BASE || handler.myBase == anEnvelope.myBase;
+		const bool idMatches = handler.myId == ESP_EVENT_ANY_ID || handler.myId == anEnvelope.myId;
+		if (baseMatches && idMatches)
+		{
+			const uint32_t start = EventTrace::GetCycles();
+			handler.myCallback(handler.myArg, anEnvelope.myBase, anEnvelope.myId, data);
+			const uint32_t ns = EventTrace::CyclesToNs(EventTrace::GetCycles() - start);
+			EventTrace::RecordHandler(i, ns);
+			handlerNs += ns;
+		}
+	}
+	myDispatched.fetch_add(1, std::memory_order_relaxed);
+	EventTrace::RecordDispatch(EventTrace::Path::Bus, anEnvelope.myId,
+							   static_cast<uint32_t>(std::min<int64_t>(latencyUs * 1000, UINT32_MAX)), handlerNs);
+}
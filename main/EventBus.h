@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <esp_event.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Event queue and dispatcher that stands in for the default esp_event loop.
+ *
+ * esp_event copies every payload into a fresh heap block on each post and frees it after
+ * dispatch, so a spinning encoder churns the heap. Here an event is a fixed size envelope
+ * copied by value into a statically allocated queue, and handlers sit in a fixed table, so
+ * neither publishing nor dispatching ever allocates. Handlers keep the esp_event_handler_t
+ * signature and get a pointer to the payload bytes, valid for the call.
+ *
+ * Stop events get a second, short queue that the dispatch task always empties first, so one
+ * waits for at most the handler already running rather than everything queued ahead of it.
+ *
+ * When the main queue is full, what happens to a post depends on its base's OverflowPolicy.
+ * A post that can't get in is refused with an error rather than blocking forever. The depth
+ * of the queue is tracked per base and per handler, so a stalled handler shows up as the
+ * one its events pile up behind.
+ */
+class EventBus
+{
+  public:
+	// Largest payload an event can carry, checked at compile time in PublishEvent
+	static constexpr size_t PAYLOAD_SIZE = 8;
+	// Same depth as the default loop, CONFIG_ESP_SYSTEM_EVENT_QUEUE_SIZE
+	static constexpr size_t QUEUE_LENGTH = 32;
+	// Stop events, EventRegistry::IsUrgent, have their own lane, dispatched ahead of the other
+	static constexpr size_t URGENT_QUEUE_LENGTH = 8;
+	static constexpr size_t MAX_HANDLERS = 16;
+	// Bases with their own overflow policy and statistics, taken in the order they are first used
+	static constexpr size_t MAX_BASES = 8;
+
+	/**
+	 **@brief What a post does when the main queue is full
+	 **/
+	enum class OverflowPolicy : uint8_t
+	{
+		Block,		// wait for room, up to the post's timeout, then refuse it
+		Reject,		// refuse it straight away
+		DropOldest, // drop the oldest event of its base still queued, refuse it if there is none
+		Coalesce	// drop the queued event of its base and id, it supersedes that one. Refuse it if there is none.
+	};
+
+	struct Envelope
+	{
+		esp_event_base_t myBase;
+		int32_t myId;
+		uint32_t mySize;
+		uint16_t mySubscribers; // a bit per handler slot it was queued for
+		uint8_t myBaseSlot;		// in the base table, NO_BASE_SLOT if that was full
+		int64_t myPostedUs;
+		alignas(8) uint8_t myPayload[PAYLOAD_SIZE];
+	};
+
+	struct Stats
+	{
+		uint32_t myPosted = 0;
+		uint32_t myDispatched = 0;
+		uint32_t myTimeouts = 0; // refused, whether after waiting or not
+		size_t myHighWater = 0;
+		uint32_t myUrgent = 0; // of those posted, how many went in the urgent lane
+		uint32_t myDropped = 0;
+		uint32_t myCoalesced = 0;
+	};
+
+	/**
+	 **@brief Queue use by the events of one base
+	 **/
+	struct BaseStats
+	{
+		esp_event_base_t myBase = nullptr;
+		OverflowPolicy myPolicy = OverflowPolicy::Block;
+		uint32_t myPosted = 0;
+		uint32_t myRefused = 0;
+		uint32_t myDropped = 0;	  // queued, then dropped to make room for a newer one
+		uint32_t myCoalesced = 0; // queued, then superseded by a newer one
+		size_t myDepth = 0;
+		size_t myHighWater = 0;
+		uint32_t myBlocked = 0; // posts that found the queue full and waited
+		int64_t myBlockedUs = 0;
+		int64_t myMaxBlockedUs = 0;
+	};
+
+	/**
+	 **@brief Events queued for one handler, the ones it will be called for
+	 **/
+	struct HandlerStats
+	{
+		size_t myDepth = 0;
+		size_t myHighWater = 0;
+	};
+
+	/**
+	 **@brief Create the queue and the dispatch task, once
+	 **/
+	static void Start();
+
+	/**
+	 **@brief Copy an event into its lane's queue. With no room, as aBase's overflow policy
+	 ** says, waiting up to aTicksToWait if it's Block.
+	 ** @return ESP_OK if it was queued, ESP_ERR_TIMEOUT if it waited and there was still no
+	 ** room, ESP_ERR_NO_MEM if its policy refused it without waiting
+	 **/
+	static esp_err_t Post(esp_event_base_t aBase, int32_t anId, const void *aData, size_t aSize, TickType_t aTicksToWait);
+
+	/**
+	 **@brief Call aHandler for anId on aBase, or any id with ESP_EVENT_ANY_ID
+	 **/
+	static esp_err_t Register(esp_event_base_t aBase, int32_t anId, esp_event_handler_t aHandler, void *anArg);
+
+	/**
+	 **@brief What posts on aBase do when the main queue is full, Block until this is called
+	 **/
+	static esp_err_t SetOverflowPolicy(esp_event_base_t aBase, OverflowPolicy aPolicy);
+
+	/**
+	 **@brief When the event being dispatched was posted, for handlers that pass it on
+	 **/
+	static int64_t GetPostedUs() { return myDispatchingPostedUs; }
+
+	/**
+	 **@brief Subscription of the handler registered in aSlot, false if there isn't one
+	 **/
+	static bool GetHandler(size_t aSlot, esp_event_base_t &aBase, int32_t &anId);
+
+	static Stats GetStats();
+	/**
+	 **@brief Statistics of the base in aSlot, in the order they were first used, false past the last
+	 **/
+	static bool GetBaseStats(size_t aSlot, BaseStats &aStats);
+	static bool GetHandlerStats(size_t aSlot, HandlerStats &aStats);
+	/**
+	 **@brief Zero the counts, and start the high water marks over from the depths now
+	 **/
+	static void ResetStats();
+
+	/**
+	 **@brief Print the queue statistics per base and per handler, to stdout
+	 **/
+	static void PrintStats();
+
+	static const char *GetPolicyName(OverflowPolicy aPolicy);
+
+  private:
+	struct Handler
+	{
+		esp_event_base_t myBase;
+		int32_t myId;
+		esp_event_handler_t myCallback;
+		void *myArg;
+	};
+
+	static constexpr uint8_t NO_BASE_SLOT = 0xff;
+	static_assert(MAX_HANDLERS <= 16, "Envelope::mySubscribers has a bit per handler");
+
+	static void DispatchTask(void *aParam);
+	static void Dispatch(Envelope &anEnvelope);
+
+	// The rest are called with myLock held
+	static uint8_t FindBase(esp_event_base_t aBase, bool aClaim);
+	static uint16_t GetSubscribers(esp_event_base_t aBase, int32_t anId);
+	static void AddDepth(const Envelope &anEnvelope);
+	static void RemoveDepth(const Envelope &anEnvelope);
+	static void Append(const Envelope &anEnvelope);
+	static void RemoveAt(size_t anIndex);
+	static bool Replace(const Envelope &anEnvelope, OverflowPolicy aPolicy);
+	static bool Pop(Envelope &anEnvelope);
+
+	// The main queue, a ring kept in a critical section so an overflowing post can take an
+	// event out of the middle. mySpace counts its free slots, for posts waiting on room.
+	static Envelope myRing[QUEUE_LENGTH];
+	static size_t myRingHead;
+	static size_t myRingCount;
+	static SemaphoreHandle_t mySpace;
+	static StaticSemaphore_t mySpaceBuffer;
+	static portMUX_TYPE myLock;
+	static bool myStarted;
+
+	static QueueHandle_t myUrgentQueue;
+	static StaticQueue_t myUrgentQueueBuffer;
+	static uint8_t myUrgentQueueStorage[URGENT_QUEUE_LENGTH * sizeof(Envelope)];
+	static TaskHandle_t myDispatchTask;
+
+	static Handler myHandlers[MAX_HANDLERS];
+	static std::atomic<size_t> myHandlerCount;
+	static int64_t myDispatchingPostedUs;
+
+	static BaseStats myBases[MAX_BASES];
+	static size_t myBaseCount;
+	static HandlerStats myHandlerStats[MAX_HANDLERS];
+
+	static std::atomic<uint32_t> myPosted;
+	static std::atomic<uint32_t> myDispatched;
+	static std::atomic<uint32_t> myTimeouts;
+	static std::atomic<size_t> myHighWater;
+	static std::atomic<uint32_t> myUrgent;
+	static std::atomic<uint32_t> myDropped;
+	static std::atomic<uint32_t> myCoalesced;
+
+	static constexpr uint32_t DISPATCH_STACK_SIZE = 4096;
+	// Where the default loop's task runs, ESP_TASKD_EVENT_PRIO
+	static constexpr UBaseType_t DISPATCH_PRIORITY = configMAX_PRIORITIES - 5;
+};
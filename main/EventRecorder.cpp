@@ -0,0 +1,163 @@
+#include "EventRecorder.h"
+
+#include "EventTypes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <esp_timer.h>
+
+EventRecorder::Record EventRecorder::myRecords[CAPACITY];
+std::atomic<uint32_t> EventRecorder::myNext{0};
+std::atomic<bool> EventRecorder::myEnabled{true};
+
+void EventRecorder::Add(Source aSource, int32_t anId, const void *aPayload, size_t aSize)
+{
+	if (aSource == Source::None || !myEnabled.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	const uint32_t index = myNext.fetch_add(1, std::memory_order_relaxed);
+	Record &record = myRecords[index & (CAPACITY - 1)];
+	record.myTimeUs = static_cast<uint32_t>(esp_timer_get_time());
+	record.mySource = aSource;
+	record.myId = static_cast<uint8_t>(anId);
+	record.mySize = aPayload ? static_cast<uint8_t>(std::min(aSize, EventBus::PAYLOAD_SIZE)) : 0;
+	record.myReserved = 0;
+	memset(record.myPayload, 0, sizeof(record.myPayload));
+	memcpy(record.myPayload, aPayload, record.mySize);
+}
+
+EventRecorder::Source EventRecorder::GetSource(esp_event_base_t aBase)
+{
+	if (aBase == COMMAND_EVENT)
+	{
+		return Source::Command;
+	}
+	if (aBase == SETTINGS_EVENT)
+	{
+		return Source::Settings;
+	}
+	if (aBase == STATE_TRANSITION_EVENT)
+	{
+		return Source::StateTransition;
+	}
+	if (aBase == UI_EVENT)
+	{
+		return Source::UI;
+	}
+	return Source::Other;
+}
+
+size_t EventRecorder::GetCount()
+{
+	return std::min<size_t>(myNext.load(std::memory_order_relaxed), CAPACITY);
+}
+
+uint32_t EventRecorder::GetOverwritten()
+{
+	const uint32_t next = myNext.load(std::memory_order_relaxed);
+	return next > CAPACITY ? next - CAPACITY : 0;
+}
+
+bool EventRecorder::GetRecord(size_t anIndex, Record &aRecord)
+{
+	const uint32_t next = myNext.load(std::memory_order_relaxed);
+	const size_t count = std::min<size_t>(next, CAPACITY);
+	if (anIndex >= count)
+	{
+		return false;
+	}
+	aRecord = myRecords[(next - count + anIndex) & (CAPACITY - 1)];
+	return true;
+}
+
+void EventRecorder::Clear()
+{
+	myNext.store(0, std::memory_order_relaxed);
+}
+
+void EventRecorder::Dump(FILE *aFile)
+{
+	const size_t count = GetCount();
+	fprintf(aFile, "%s BEGIN %u %u\n", DUMP_PREFIX, static_cast<unsigned>(count), GetOverwritten());
+
+	Record record;
+	for (size_t i = 0; GetRecord(i, record); i++)
+	{
+		// time source id size payload, the payload in hex or - without one
+		char payload[2 * EventBus::PAYLOAD_SIZE + 1] = "-";
+		for (size_t byte = 0; byte < record.mySize; byte++)
+		{
+			snprintf(payload + 2 * byte, 3, "%02x", record.myPayload[byte]);
+		}
+		fprintf(aFile, "%s %08x %u %u %u %s\n", DUMP_PREFIX, record.myTimeUs, static_cast<unsigned>(record.mySource),
+				record.myId, record.mySize, payload);
+	}
+
+	fprintf(aFile, "%s END\n", DUMP_PREFIX);
+}
+
+bool EventRecorder::ParseLine(const char *aLine, Record &aRecord)
+{
+	// Whatever the serial log put in front of it, such as a timestamp
+	const char *start = strstr(aLine, DUMP_PREFIX);
+	if (!start || strstr(start, " BEGIN") || strstr(start, " END"))
+	{
+		return false;
+	}
+
+	unsigned time;
+	unsigned source;
+	unsigned id;
+	unsigned size;
+	char payload[2 * EventBus::PAYLOAD_SIZE + 2];
+	const int fields = sscanf(start + strlen(DUMP_PREFIX), " %8x %u %u %u %17s", &time, &source, &id, &size, payload);
+	if (fields != 5 || source >= static_cast<unsigned>(Source::Count) || size > EventBus::PAYLOAD_SIZE)
+	{
+		return false;
+	}
+	if (size && strlen(payload) != 2 * size)
+	{
+		return false;
+	}
+
+	aRecord = Record();
+	aRecord.myTimeUs = time;
+	aRecord.mySource = static_cast<Source>(source);
+	aRecord.myId = static_cast<uint8_t>(id);
+	aRecord.mySize = static_cast<uint8_t>(size);
+	for (size_t byte = 0; byte < size; byte++)
+	{
+		unsigned value;
+		if (sscanf(payload + 2 * byte, "%2x", &value) != 1)
+		{
+			return false;
+		}
+		aRecord.myPayload[byte] = static_cast<uint8_t>(value);
+	}
+	return true;
+}
+
+const char *EventRecorder::GetSourceName(Source aSource)
+{
+	switch (aSource)
+	{
+	case Source::Command:
+		return "command";
+	case Source::Settings:
+		return "settings";
+	case Source::StateTransition:
+		return "state";
+	case Source::UI:
+		return "ui";
+	case Source::Switches:
+		return "switches";
+	case Source::Encoder:
+		return "encoder";
+	case Source::Other:
+		return "other";
+	default:
+		return "?";
+	}
+}
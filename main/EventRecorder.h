@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <esp_event.h>
+
+#include "EventBus.h"
+
+/**
+ * @brief Flight recorder for the event stream, so a session on the machine can be dumped
+ * over serial and replayed on the host build (host/replay).
+ *
+ * Every event published on the bus, and every command a switch or the encoder hands the
+ * motion task directly, goes into a fixed ring of 16 byte records, the oldest overwritten
+ * once it is full. Producers claim a slot with one atomic increment, so recording takes no
+ * lock. A dump taken while events are still arriving may show a record half written.
+ *
+ * The dump is text, so it survives a serial log with other output mixed in: one line per
+ * record, each starting with DUMP_PREFIX, between a BEGIN and an END line.
+ */
+class EventRecorder
+{
+  public:
+	static constexpr size_t CAPACITY = 512; // a power of two, 8 KB of records
+	static constexpr const char *DUMP_PREFIX = "EVREC";
+
+	/**
+	 **@brief Where an event came from, the bus base it was published on or the
+	 ** producer's ring into the motion task
+	 **/
+	enum class Source : uint8_t
+	{
+		None, // not recorded, such as the rings the event bus forwards into
+		Command,
+		Settings,
+		StateTransition,
+		UI,
+		Switches,
+		Encoder,
+		Other, // a base not listed here
+		Count
+	};
+
+	struct Record
+	{
+		uint32_t myTimeUs; // esp_timer clock, low 32 bits, so only differences under 71 minutes mean anything
+		Source mySource;
+		uint8_t myId;
+		uint8_t mySize;
+		uint8_t myReserved;
+		uint8_t myPayload[EventBus::PAYLOAD_SIZE];
+	};
+	static_assert(sizeof(Record) == 16, "records are meant to stay 16 bytes");
+
+	static void Add(Source aSource, int32_t anId, const void *aPayload, size_t aSize);
+	static void Add(esp_event_base_t aBase, int32_t anId, const void *aPayload, size_t aSize)
+	{
+		Add(GetSource(aBase), anId, aPayload, aSize);
+	}
+
+	static Source GetSource(esp_event_base_t aBase);
+
+	/**
+	 **@brief Stop or start recording, the ring keeps what it has
+	 **/
+	static void SetEnabled(bool anEnabled) { myEnabled.store(anEnabled, std::memory_order_relaxed); }
+
+	/**
+	 **@brief Records in the ring, oldest first, up to CAPACITY. false once anIndex is past the last.
+	 **/
+	static bool GetRecord(size_t anIndex, Record &aRecord);
+	static size_t GetCount();
+	static uint32_t GetOverwritten();
+
+	/**
+	 **@brief Write the ring to aFile as text, oldest record first
+	 **/
+	static void Dump(FILE *aFile);
+	static void Clear();
+
+	/**
+	 **@brief Read one line of a dump back into aRecord, false if it isn't a record line
+	 **/
+	static bool ParseLine(const char *aLine, Record &aRecord);
+
+	static const char *GetSourceName(Source aSource);
+
+  private:
+	static Record myRecords[CAPACITY];
+	static std::atomic<uint32_t> myNext;
+	static std::atomic<bool> myEnabled;
+};
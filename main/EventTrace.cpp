@@ -0,0 +1,194 @@
+#include "EventTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <esp_rom_sys.h>
+#include <hal/cpu_hal.h>
+
+EventTrace::EventStats EventTrace::myEvents[static_cast<size_t>(Path::Count)][EVENT_COUNT];
+EventTrace::Histogram EventTrace::myHandlers[EventBus::MAX_HANDLERS];
+
+void EventTrace::Histogram::Add(uint32_t aNs)
+{
+	size_t bucket = 0;
+	while (bucket < BUCKETS - 1 && aNs >= (FIRST_BUCKET_NS << bucket))
+	{
+		bucket++;
+	}
+	myCounts[bucket]++;
+	myCount++;
+	myTotalNs += aNs;
+	if (aNs > myMaxNs)
+	{
+		myMaxNs = aNs;
+	}
+}
+
+uint32_t EventTrace::Histogram::PercentileNs(float aFraction) const
+{
+	const uint32_t target = static_cast<uint32_t>(aFraction * myCount);
+	uint32_t seen = 0;
+	for (size_t bucket = 0; bucket < BUCKETS - 1; bucket++)
+	{
+		seen += myCounts[bucket];
+		if (seen > target)
+		{
+			return std::min(FIRST_BUCKET_NS << bucket, myMaxNs);
+		}
+	}
+	return myMaxNs;
+}
+
+void EventTrace::RecordDispatch(Path aPath, int32_t anId, uint32_t aLatencyNs, uint32_t aHandlerNs)
+{
+	if (anId < 0 || static_cast<size_t>(anId) >= EVENT_COUNT)
+	{
+		return;
+	}
+	EventStats &stats = myEvents[static_cast<size_t>(aPath)][anId];
+	stats.myLatency.Add(aLatencyNs);
+	stats.myHandler.Add(aHandlerNs);
+}
+
+void EventTrace::RecordHandler(size_t aSlot, uint32_t aNs)
+{
+	if (aSlot < EventBus::MAX_HANDLERS)
+	{
+		myHandlers[aSlot].Add(aNs);
+	}
+}
+
+const EventTrace::Histogram &EventTrace::GetLatency(Path aPath, Event anEvent)
+{
+	return myEvents[static_cast<size_t>(aPath)][static_cast<size_t>(anEvent)].myLatency;
+}
+
+const EventTrace::Histogram &EventTrace::GetHandlerTime(Path aPath, Event anEvent)
+{
+	return myEvents[static_cast<size_t>(aPath)][static_cast<size_t>(anEvent)].myHandler;
+}
+
+uint32_t EventTrace::GetCycles()
+{
+	return cpu_hal_get_cycle_count();
+}
+
+uint32_t EventTrace::CyclesToNs(uint32_t aCycles)
+{
+	return static_cast<uint32_t>(static_cast<uint64_t>(aCycles) * 1000 / esp_rom_get_cpu_ticks_per_us());
+}
+
+void EventTrace::Reset()
+{
+	memset(myEvents, 0, sizeof(myEvents));
+	memset(myHandlers, 0, sizeof(myHandlers));
+}
+
+void EventTrace::PrintHistogram(const char *aName, const Histogram &aHistogram)
+{
+	printf("    %-8s p50 %9.1f  p99 %9.1f  max %9.1f  mean %9.1f us\n", aName,
+		   aHistogram.PercentileNs(0.5f) / 1000.0f, aHistogram.PercentileNs(0.99f) / 1000.0f,
+		   aHistogram.myMaxNs / 1000.0f, aHistogram.myTotalNs / 1000.0f / aHistogram.myCount);
+}
+
+void EventTrace::Print()
+{
+	static const char *const PATH_NAMES[] = {"event bus", "motion task"};
+
+	for (size_t path = 0; path < static_cast<size_t>(Path::Count); path++)
+	{
+		printf("%s, publish to dispatch and time in handlers\n", PATH_NAMES[path]);
+		for (size_t id = 0; id < EVENT_COUNT; id++)
+		{
+			const EventStats &stats = myEvents[path][id];
+			if (stats.myLatency.myCount == 0)
+			{
+				continue;
+			}
+			printf("  %-16s n=%u\n", GetName(id), stats.myLatency.myCount);
+			PrintHistogram("latency", stats.myLatency);
+			PrintHistogram("handlers", stats.myHandler);
+		}
+	}
+
+	printf("event bus handlers\n");
+	for (size_t slot = 0; slot < EventBus::MAX_HANDLERS; slot++)
+	{
+		esp_event_base_t base;
+		int32_t id;
+		if (myHandlers[slot].myCount == 0 || !EventBus::GetHandler(slot, base, id))
+		{
+			continue;
+		}
+		printf("  %-2u %s/%s n=%u\n", static_cast<unsigned>(slot), base == ESP_EVENT_ANY_BASE ? "any" : base,
+			   id == ESP_EVENT_ANY_ID ? "any" : GetName(id), myHandlers[slot].myCount);
+		PrintHistogram("time", myHandlers[slot]);
+	}
+}
+
+const char *EventTrace::GetName(int32_t anId)
+{
+	switch (static_cast<Event>(anId))
+	{
+	case Event::MoveLeft:
+		return "MoveLeft";
+	case Event::StopMoveLeft:
+		return "StopMoveLeft";
+	case Event::MoveRight:
+		return "MoveRight";
+	case Event::StopMoveRight:
+		return "StopMoveRight";
+	case Event::RapidSpeed:
+		return "RapidSpeed";
+	case Event::NormalSpeed:
+		return "NormalSpeed";
+	case Event::UpdateSpeed:
+		return "UpdateSpeed";
+	case Event::SetStopped:
+		return "SetStopped";
+	case Event::ToggleUnits:
+		return "ToggleUnits";
+	case Event::ToggleView:
+		return "ToggleView";
+	case Event::ZeroPosition:
+		return "ZeroPosition";
+	case Event::SetLeftLimit:
+		return "SetLeftLimit";
+	case Event::SetRightLimit:
+		return "SetRightLimit";
+	case Event::ClearLimits:
+		return "ClearLimits";
+	case Event::SetCycleLeft:
+		return "SetCycleLeft";
+	case Event::SetCycleRight:
+		return "SetCycleRight";
+	case Event::StartCycle:
+		return "StartCycle";
+	case Event::StopCycle:
+		return "StopCycle";
+	case Event::MoveComplete:
+		return "MoveComplete";
+	case Event::SetBacklash:
+		return "SetBacklash";
+	case Event::SetSpeedUnit:
+		return "SetSpeedUnit";
+	case Event::SaveNormalSpeed:
+		return "SaveNormalSpeed";
+	case Event::SaveRapidSpeed:
+		return "SaveRapidSpeed";
+	case Event::SaveBacklash:
+		return "SaveBacklash";
+	case Event::MovingLeft:
+		return "MovingLeft";
+	case Event::MovingRight:
+		return "MovingRight";
+	case Event::Stopping:
+		return "Stopping";
+	case Event::Stopped:
+		return "Stopped";
+	default:
+		return "?";
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "EventBus.h"
+#include "EventTypes.h"
+
+/**
+ * @brief Where each event spends its time, per event id, in fixed histograms.
+ *
+ * Latency runs from publish to the start of dispatch, on the esp_timer clock, since the
+ * ramp task publishes from the other core and the cycle counters aren't shared. Handler
+ * time is taken with the cycle counter around each handler call. Each path has a single
+ * writer, its dispatching task, so recording is a few stores with no locking. A reader
+ * on another task may see a sample half added, which is fine for a report.
+ */
+class EventTrace
+{
+  public:
+	// Bucket i counts values under FIRST_BUCKET_NS << i, the last one everything longer
+	static constexpr size_t BUCKETS = 20;
+	static constexpr uint32_t FIRST_BUCKET_NS = 256;
+
+	enum class Path
+	{
+		Bus,	// event bus dispatch task, to every registered handler
+		Motion, // motion task, to the state machine, from publish on whichever path it came
+		Count
+	};
+
+	struct Histogram
+	{
+		uint32_t myCounts[BUCKETS];
+		uint32_t myCount;
+		uint32_t myMaxNs;
+		uint64_t myTotalNs;
+
+		void Add(uint32_t aNs);
+		/**
+		 **@brief Upper bound of the bucket holding aFraction of the samples, capped at the max
+		 **/
+		uint32_t PercentileNs(float aFraction) const;
+	};
+
+	/**
+	 **@brief One dispatch of anId on aPath, aHandlerNs across all of its handlers
+	 **/
+	static void RecordDispatch(Path aPath, int32_t anId, uint32_t aLatencyNs, uint32_t aHandlerNs);
+
+	/**
+	 **@brief Time in one of the event bus's handlers, by its registration slot
+	 **/
+	static void RecordHandler(size_t aSlot, uint32_t aNs);
+
+	static const Histogram &GetLatency(Path aPath, Event anEvent);
+	static const Histogram &GetHandlerTime(Path aPath, Event anEvent);
+
+	/**
+	 **@brief Cycle counter, and cycles turned into ns, for timing handlers
+	 **/
+	static uint32_t GetCycles();
+	static uint32_t CyclesToNs(uint32_t aCycles);
+
+	/**
+	 **@brief Print every event and bus handler seen since the last reset, to stdout
+	 **/
+	static void Print();
+	static void Reset();
+
+	static const char *GetName(int32_t anId);
+
+  private:
+	struct EventStats
+	{
+		Histogram myLatency;
+		Histogram myHandler;
+	};
+
+	static void PrintHistogram(const char *aName, const Histogram &aHistogram);
+
+	static EventStats myEvents[static_cast<size_t>(Path::Count)][EVENT_COUNT];
+	static Histogram myHandlers[EventBus::MAX_HANDLERS];
+};
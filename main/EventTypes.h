@@ -1,7 +1,14 @@
 #pragma once
 
 #include "esp_event.h"
+#include "state.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 static std::shared_ptr<esp_event_loop_handle_t> myEventLoop;
 
@@ -23,78 +30,178 @@ enum class Event
 	UpdateSpeed, //update a speed by a delta, based on which speed state the machine is in
 	SetStopped,
 	ToggleUnits,
+	ToggleView, //switch the screen between speed and position (DRO)
+	ZeroPosition,
+	SetLeftLimit, //soft limit at the current position
+	SetRightLimit,
+	ClearLimits,
+	SetCycleLeft, //reciprocating cycle end, at the position in the payload or the current one
+	SetCycleRight,
+	StartCycle,
+	StopCycle,
+	MoveComplete, //a Stepper::MoveTo has generated its last step
+	SetBacklash, //steps of lost motion to take up on a change of direction
 
 	// Settings
 	//SetEncoderOffset,
 	SetSpeedUnit,
 	SaveNormalSpeed,
 	SaveRapidSpeed,
+	SaveBacklash,
 	
 	
 	//States
 	MovingLeft,
 	MovingRight,
 	Stopping,
-	Stopped
+	Stopped,
+
+	Count //not an event, the number of them. Keep it last.
 };
 
 
-class EventData
+/**
+ * @brief Base of every event payload.
+ *
+ * Payloads are copied byte for byte into the event queue, so they must be trivially
+ * copyable and no larger than EventBus::PAYLOAD_SIZE: plain values, no strings,
+ * pointers to owned memory or virtual functions.
+ */
+struct EventData
 {
-  public:
-	EventData(std::string aPublisher = "EventPublisher")
-	{
-		myPublisher = aPublisher;
-	}
-	virtual ~EventData(){};
-	std::string myPublisher;
-  private:
-	
 };
 
 template <typename T>
-class SingleValueEventData : public EventData
+struct SingleValueEventData : public EventData
 {
-  public:
-	SingleValueEventData(T aValue ) 
-	{
-		myValue = aValue;
-	}
+	SingleValueEventData() = default;
+	SingleValueEventData(T aValue) : myValue(aValue) {}
 	T myValue;
 };
 
-class UISetEncoderOffsetEventData : public EventData
+struct UISetEncoderOffsetEventData : public EventData
 {
-  public:
-	UISetEncoderOffsetEventData(int32_t aOffset = 0)
-	{
-		myEncoderOffset = aOffset;
-	}
+	UISetEncoderOffsetEventData(int32_t aOffset = 0) : myEncoderOffset(aOffset) {}
 	int32_t myEncoderOffset;
 };
 
-class UpdateSpeedEventData : public EventData
+struct UpdateSpeedEventData : public EventData
 {
-  public:
-	UpdateSpeedEventData(){};
-	UpdateSpeedEventData(uint32_t aSpeed): mySpeed(aSpeed){};
-	
+	UpdateSpeedEventData() = default;
+	UpdateSpeedEventData(int32_t aSpeed) : mySpeed(aSpeed) {}
+	int32_t mySpeed = 0;
+};
+
+
+/**
+ * @brief Payload type of each event, fixed at compile time.
+ *
+ * Publishers and handlers both take the type from here rather than naming it, so a
+ * mismatch between them is a compile error. Events that aren't listed carry no payload.
+ * OPTIONAL events may also be published without one, and their handlers get nullptr.
+ */
+template <Event E>
+struct EventPayload
+{
+	using Type = void;
+	static constexpr bool OPTIONAL = true;
+};
+
+#define EVENT_PAYLOAD(anEvent, aType, anOptional) \
+	template <> \
+	struct EventPayload<anEvent> \
+	{ \
+		using Type = aType; \
+		static constexpr bool OPTIONAL = anOptional; \
+	}
+
+EVENT_PAYLOAD(Event::UpdateSpeed, SingleValueEventData<int32_t>, false); //change in steps/s
+EVENT_PAYLOAD(Event::SetCycleLeft, SingleValueEventData<int32_t>, true); //position in steps, the current one without
+EVENT_PAYLOAD(Event::SetCycleRight, SingleValueEventData<int32_t>, true);
+EVENT_PAYLOAD(Event::SetBacklash, SingleValueEventData<int32_t>, false); //steps
+EVENT_PAYLOAD(Event::SetSpeedUnit, SingleValueEventData<SpeedUnit>, false);
+EVENT_PAYLOAD(Event::SaveNormalSpeed, SingleValueEventData<int32_t>, false); //steps/s
+EVENT_PAYLOAD(Event::SaveRapidSpeed, SingleValueEventData<int32_t>, false); //steps/s
+EVENT_PAYLOAD(Event::SaveBacklash, SingleValueEventData<int32_t>, false); //steps
+
+template <Event E>
+using EventPayloadType = typename EventPayload<E>::Type;
+
+/**
+ **@brief A handler's payload for E, typed by the registry. nullptr if it came without one.
+ **/
+template <Event E>
+const EventPayloadType<E> *GetPayload(const void *aData)
+{
+	static_assert(!std::is_void<EventPayloadType<E>>::value, "this event has no payload");
+	return static_cast<const EventPayloadType<E> *>(aData);
+}
 
-	// Copy constructor
-	UpdateSpeedEventData(const UpdateSpeedEventData &other)
-		: EventData(), mySpeed(other.mySpeed){};
+/**
+ * @brief The registry as a table indexed by event, for events only known at run time,
+ * such as a switch's configured press and release events.
+ */
+struct EventInfo
+{
+	uint8_t myPayloadSize;
+	bool myPayloadOptional;
+};
+
+constexpr size_t EVENT_COUNT = static_cast<size_t>(Event::Count);
+
+namespace EventRegistry
+{
+	template <Event E>
+	constexpr EventInfo Info()
+	{
+		using Type = EventPayloadType<E>;
+		if constexpr (std::is_void<Type>::value)
+		{
+			return EventInfo{0, true};
+		}
+		else
+		{
+			static_assert(std::is_base_of<EventData, Type>::value, "payloads must derive from EventData");
+			static_assert(std::is_trivially_copyable<Type>::value, "payloads are copied as bytes");
+			return EventInfo{static_cast<uint8_t>(sizeof(Type)), EventPayload<E>::OPTIONAL};
+		}
+	}
+
+	template <size_t... I>
+	constexpr std::array<EventInfo, sizeof...(I)> MakeTable(std::index_sequence<I...>)
+	{
+		return {{Info<static_cast<Event>(I)>()...}};
+	}
+
+	constexpr std::array<EventInfo, EVENT_COUNT> TABLE = MakeTable(std::make_index_sequence<EVENT_COUNT>());
 
-	// Copy assignment operator
-	UpdateSpeedEventData &operator=(const UpdateSpeedEventData &other)
+	/**
+	 **@brief Whether anEvent may carry aSize bytes of payload
+	 **/
+	inline bool IsValidPayload(Event anEvent, size_t aSize)
 	{
-		if (this != &other)
+		const size_t index = static_cast<size_t>(anEvent);
+		if (index >= EVENT_COUNT)
 		{
-			mySpeed = other.mySpeed;
+			return false;
 		}
-		return *this;
+		const EventInfo &info = TABLE[index];
+		return aSize == info.myPayloadSize || (aSize == 0 && info.myPayloadOptional);
 	}
 
-	int32_t mySpeed;
-	// Destructor
-	~UpdateSpeedEventData() override {}
-};
\ No newline at end of file
+	inline size_t PayloadSize(Event anEvent)
+	{
+		const size_t index = static_cast<size_t>(anEvent);
+		return index < EVENT_COUNT ? TABLE[index].myPayloadSize : 0;
+	}
+
+	/**
+	 **@brief Events that stop motion. They go ahead of everything else queued on the event
+	 ** bus and in the motion task, so a burst of speed, screen or settings traffic can't hold them up.
+	 **/
+	constexpr bool IsUrgent(Event anEvent)
+	{
+		return anEvent == Event::StopMoveLeft || anEvent == Event::StopMoveRight || anEvent == Event::StopCycle ||
+			   anEvent == Event::SetStopped;
+	}
+} // namespace EventRegistry
@@ -0,0 +1,134 @@
+#include "FastAccelStepperBackend.h"
+
+#ifdef USE_FASTACCELSTEPPER
+#include <esp_log.h>
+
+std::unique_ptr<StepGenerator> CreateStepGenerator()
+{
+	return std::unique_ptr<StepGenerator>(new FastAccelStepperBackend());
+}
+
+void FastAccelStepperBackend::Init(uint8_t aDirPin, uint8_t anEnablePin, uint8_t aStepPin)
+{
+	myEngine.init(1);
+	myStepper = myEngine.stepperConnectToPin(aStepPin);
+	if (myStepper)
+	{
+		myStepper->setDirectionPin(aDirPin);
+		myStepper->setEnablePin(anEnablePin);
+		myStepper->setAutoEnable(true);
+		myStepper->setDelayToDisable(200);
+		myStepper->setDelayToEnable(50); // this is the time the enable pin must be active before the stepper starts moving
+		// The linear profile's ramp. The library brakes at the same rate, so deceleration in
+		// config.h only reaches the ramps Stepper generates.
+		myStepper->setAcceleration(acceleration);
+		//myStepper->enableOutputs();
+	}
+	else
+	{
+		ESP_LOGE("Stepper", "FastAccelStepper could not claim step pin %d", aStepPin);
+	}
+}
+
+void FastAccelStepperBackend::SetSpeed(uint32_t aStepsPerSecond)
+{
+	if (aStepsPerSecond * 1000 == myStepper->getSpeedInMilliHz())
+	{
+		return;
+	}
+	myStepper->setSpeedInHz(aStepsPerSecond);
+	myStepper->applySpeedAcceleration();
+}
+
+uint32_t FastAccelStepperBackend::GetTargetSpeed()
+{
+	return myStepper->getSpeedInMilliHz() / 1000;
+}
+
+void FastAccelStepperBackend::Run(bool aForward)
+{
+	if (aForward)
+	{
+		myStepper->runForward();
+	}
+	else
+	{
+		myStepper->runBackward();
+	}
+}
+
+void FastAccelStepperBackend::RunTo(int32_t aPosition)
+{
+	myStepper->moveTo(aPosition);
+}
+
+void FastAccelStepperBackend::Stop()
+{
+	myStepper->stopMove();
+}
+
+bool FastAccelStepperBackend::IsStopped()
+{
+	return !myStepper->isRunning() && !myStepper->isStopping();
+}
+
+int32_t FastAccelStepperBackend::GetCurrentSpeed()
+{
+	return myStepper->getCurrentSpeedInMilliHz() / 1000;
+}
+
+std::string FastAccelStepperBackend::GetState()
+{
+	if (myStepper->isRunning())
+	{
+		return "RUNNING";
+	}
+	else if (myStepper->isStopping())
+	{
+		return "STOPPING";
+	}
+	return "STOPPED";
+}
+
+int32_t FastAccelStepperBackend::GetPosition()
+{
+	return myStepper->getCurrentPosition();
+}
+
+StepGenerator::QueueResult FastAccelStepperBackend::AddToQueue(const Command &aCommand)
+{
+	const stepper_command_s command = {aCommand.myTicks, aCommand.mySteps, aCommand.myForward};
+	const int8_t result = myStepper->addQueueEntry(&command);
+	if (result == AQE_OK)
+	{
+		return QueueResult::Ok;
+	}
+	if (result > 0)
+	{
+		// Queue full or the direction pin still settling, worth trying again
+		return QueueResult::Full;
+	}
+	ESP_LOGE("Stepper", "Step queue rejected a command: %d", result);
+	return QueueResult::Rejected;
+}
+
+bool FastAccelStepperBackend::IsQueueFull()
+{
+	return myStepper->isQueueFull();
+}
+
+bool FastAccelStepperBackend::IsQueueEmpty()
+{
+	return myStepper->isQueueEmpty();
+}
+
+uint8_t FastAccelStepperBackend::GetQueueEntries()
+{
+	return myStepper->queueEntries();
+}
+
+bool FastAccelStepperBackend::HasTicksInQueue(uint32_t aTicks)
+{
+	return myStepper->hasTicksInQueue(aTicks);
+}
+#endif
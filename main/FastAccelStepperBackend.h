@@ -0,0 +1,39 @@
+#pragma once
+
+#include "config.h"
+
+#ifdef USE_FASTACCELSTEPPER
+#include "FastAccelStepper.h"
+#include "StepGenerator.h"
+
+class FastAccelStepperBackend : public StepGenerator
+{
+  public:
+	void Init(uint8_t aDirPin, uint8_t anEnablePin, uint8_t aStepPin) override;
+	const char *GetName() override { return "FastAccelStepper"; }
+
+	void SetSpeed(uint32_t aStepsPerSecond) override;
+	uint32_t GetTargetSpeed() override;
+	void Run(bool aForward) override;
+	void RunTo(int32_t aPosition) override;
+	void Stop() override;
+	bool IsStopped() override;
+	int32_t GetCurrentSpeed() override;
+	std::string GetState() override;
+	int32_t GetPosition() override;
+
+	bool HasQueue() override { return true; }
+	uint32_t GetMinCommandTicks() override { return MIN_CMD_TICKS; }
+	QueueResult AddToQueue(const Command &aCommand) override;
+	bool IsQueueFull() override;
+	bool IsQueueEmpty() override;
+	uint8_t GetQueueEntries() override;
+	bool HasTicksInQueue(uint32_t aTicks) override;
+
+  private:
+	static_assert(TICKS_PER_S == TICKS_PER_SECOND, "FastAccelStepper ticks are passed through unconverted");
+
+	FastAccelStepperEngine myEngine = FastAccelStepperEngine();
+	FastAccelStepper *myStepper = nullptr;
+};
+#endif
@@ -2,23 +2,29 @@
 #include "shared.h"
 #include "state.h"
 #include "esp_event.h"
+#include <algorithm>
+#include <cstdio>
 #include <memory>
 
 std::vector<std::shared_ptr<Switch>> MovementSwitches::mySwitches;
+CommandRing *MovementSwitches::myCommands = nullptr;
+SwitchMode MovementSwitches::myMode = SwitchMode::Interrupt;
+TaskHandle_t MovementSwitches::myPollTask = nullptr;
+portMUX_TYPE MovementSwitches::myLock = portMUX_INITIALIZER_UNLOCKED;
 
-Switch::Switch(gpio_num_t aSwitchPin, uint16_t aDelay, Event aPressedEvent, Event aReleasedEvent)
+Switch::Switch(gpio_num_t aSwitchPin, uint16_t aDelay, Event aPressedEvent, Event aReleasedEvent,
+			   uint8_t aConfirmMs)
 {
 	mySwitchPin = aSwitchPin;
 	myDelay = aDelay;
 	mySwitchPressedEvent = aPressedEvent;
 	mySwitchReleasedEvent = aReleasedEvent;
-	myLastStateChangeTime = 0;
 	myPullMode = GPIO_PULLDOWN_ONLY;
 	myIntrType = GPIO_INTR_ANYEDGE;
 	myMode = GPIO_MODE_INPUT;
 	callbackCalled = true;
 	myLastSwitchState = false;
-	myHasPendingStateChange = false;
+	myThreshold = static_cast<uint8_t>(std::clamp<uint32_t>(aConfirmMs / MovementSwitches::SAMPLE_PERIOD_MS, 1, UINT8_MAX));
 }
 
 void MovementSwitches::Create()
@@ -27,58 +33,298 @@ void MovementSwitches::Create()
 
 void MovementSwitches::AddSwitch(SwitchName aName, std::shared_ptr<Switch>aSwitch)
 {
+	aSwitch->myName = aName;
 	mySwitches.push_back(aSwitch);
 	gpio_pad_select_gpio(aSwitch->mySwitchPin);
 	gpio_set_direction(aSwitch->mySwitchPin, aSwitch->myMode);
 	gpio_set_pull_mode(aSwitch->mySwitchPin, aSwitch->myPullMode);
 	//gpio_set_intr_type(aSwitch->mySwitchPin, aSwitch->myIntrType);
-	aSwitch->myLastSwitchState = gpio_get_level(aSwitch->mySwitchPin);
+	Reset(*aSwitch);
 }
 
-void MovementSwitches::Start()
+void MovementSwitches::Start(CommandRing &aCommands, SwitchMode aMode)
 {
-	// for (std::shared_ptr<Switch> aSwitch : mySwitches)
-	// {
-	// 	gpio_isr_handler_add(aSwitch->mySwitchPin, DebounceHandler, aSwitch.get());
-	// }
-	xTaskCreatePinnedToCore(DebounceTask, "DebounceTask", 2048, nullptr, 10, nullptr, 0);
+	myCommands = &aCommands;
+
+	// Already installed is fine, another driver may have got there first
+	const esp_err_t installed = gpio_install_isr_service(0);
+	ESP_ERROR_CHECK(installed == ESP_ERR_INVALID_STATE ? ESP_OK : installed);
+	for (std::shared_ptr<Switch> aSwitch : mySwitches)
+	{
+		const esp_timer_create_args_t timerArgs = {
+			.callback = &DebounceTimerCallback,
+			.arg = aSwitch.get(),
+			.dispatch_method = ESP_TIMER_TASK,
+			.name = "SwitchDebounce",
+			.skip_unhandled_events = false};
+		ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &aSwitch->myDebounceTimer));
+		gpio_set_intr_type(aSwitch->mySwitchPin, aSwitch->myIntrType);
+		ESP_ERROR_CHECK(gpio_isr_handler_add(aSwitch->mySwitchPin, DebounceHandler, aSwitch.get()));
+	}
+	SetMode(aMode);
+}
+
+void MovementSwitches::SetMode(SwitchMode aMode)
+{
+	myMode = aMode;
+	for (std::shared_ptr<Switch> aSwitch : mySwitches)
+	{
+		esp_timer_stop(aSwitch->myDebounceTimer);
+		Reset(*aSwitch);
+		if (aMode == SwitchMode::Interrupt)
+		{
+			gpio_intr_enable(aSwitch->mySwitchPin);
+		}
+		else
+		{
+			gpio_intr_disable(aSwitch->mySwitchPin);
+		}
+	}
+
+	if (aMode != SwitchMode::Polling)
+	{
+		return;
+	}
+	if (!myPollTask)
+	{
+		xTaskCreatePinnedToCore(DebounceTask, "DebounceTask", 2048, nullptr, DEBOUNCE_TASK_PRIORITY, &myPollTask, 0);
+	}
+	else
+	{
+		xTaskNotifyGive(myPollTask);
+	}
+}
+
+void MovementSwitches::Reset(Switch &aSwitch)
+{
+	const bool level = gpio_get_level(aSwitch.mySwitchPin);
+	portENTER_CRITICAL(&myLock);
+	aSwitch.myLastSwitchState = level;
+	aSwitch.myLastLevel = level;
+	aSwitch.myIntegrator = level ? aSwitch.myThreshold : 0;
+	aSwitch.mySampling = false;
+	portEXIT_CRITICAL(&myLock);
+}
+
+void IRAM_ATTR MovementSwitches::NoteEdge(Switch &aSwitch, int64_t aNowUs)
+{
+	if (!aSwitch.mySampling)
+	{
+		aSwitch.mySampling = true;
+		aSwitch.myFirstEdgeUs = aNowUs;
+		aSwitch.myEdges = 0;
+		aSwitch.myChanges = 0;
+		aSwitch.myConfirmUs = 0;
+	}
+	aSwitch.myEdges++;
+	aSwitch.myLastEdgeUs = aNowUs;
+}
+
+void MovementSwitches::Finish(Switch &aSwitch)
+{
+	BounceStats &stats = aSwitch.myStats;
+	const uint32_t bounces = aSwitch.myEdges > aSwitch.myChanges ? aSwitch.myEdges - aSwitch.myChanges : 0;
+	const int64_t bounceUs = aSwitch.myLastEdgeUs - aSwitch.myFirstEdgeUs;
+
+	if (aSwitch.myChanges)
+	{
+		stats.myChanges += aSwitch.myChanges;
+	}
+	else
+	{
+		stats.myRejected++;
+	}
+	stats.myEdges += aSwitch.myEdges;
+	stats.myBounces += bounces;
+	stats.myMaxBounces = std::max(stats.myMaxBounces, bounces);
+	stats.myLastBounceUs = bounceUs;
+	stats.myMaxBounceUs = std::max(stats.myMaxBounceUs, bounceUs);
+	stats.myMaxConfirmUs = std::max(stats.myMaxConfirmUs, aSwitch.myConfirmUs);
+	aSwitch.mySampling = false;
+}
+
+void IRAM_ATTR MovementSwitches::Integrate(Switch &aSwitch, bool aLevel)
+{
+	if (aLevel)
+	{
+		if (aSwitch.myIntegrator < aSwitch.myThreshold)
+		{
+			aSwitch.myIntegrator++;
+		}
+	}
+	else if (aSwitch.myIntegrator > 0)
+	{
+		aSwitch.myIntegrator--;
+	}
 }
 
+bool MovementSwitches::Sample(Switch &aSwitch, bool aLevel, int64_t aNowUs)
+{
+	Integrate(aSwitch, aLevel);
+
+	// Only one of the debounce timer or the poll task samples a switch at a time, and the
+	// edge interrupt only while neither is, so the integrator and the state reported need no
+	// lock, only what the edges write does
+	const bool settled = aSwitch.myIntegrator == 0 || aSwitch.myIntegrator == aSwitch.myThreshold;
+	const bool state = aSwitch.myIntegrator == aSwitch.myThreshold;
+
+	// No edge for the switch's delay, a bounce still going would have had another by now
+	const int64_t quietUs = static_cast<int64_t>(aSwitch.myDelay) * 1000;
+	portENTER_CRITICAL(&myLock);
+	const bool edgesQuiet = aNowUs - aSwitch.myLastEdgeUs >= quietUs;
+	const bool firstChange = aSwitch.myChanges == 0;
+	portEXIT_CRITICAL(&myLock);
+
+	// The first change of a press or release goes as soon as the integrator confirms it. Going
+	// back is the bounce until the edges stop, a real one only goes once they have.
+	if (settled && state != aSwitch.myLastSwitchState && (firstChange || edgesQuiet))
+	{
+		const Event event = state ? aSwitch.mySwitchPressedEvent : aSwitch.mySwitchReleasedEvent;
+		if (!myCommands->Post(event))
+		{
+			// The motion task is that far behind, the next sample tries again
+			return true;
+		}
+		aSwitch.myLastSwitchState = state;
+
+		portENTER_CRITICAL(&myLock);
+		aSwitch.myChanges++;
+		aSwitch.myConfirmUs = aNowUs - aSwitch.myFirstEdgeUs;
+		portEXIT_CRITICAL(&myLock);
+	}
+
+	// Done once nothing is left to send and the edges have stopped, looked at again with the
+	// lock held so an edge since can't be finished with the rest
+	portENTER_CRITICAL(&myLock);
+	const bool quiet = settled && state == aSwitch.myLastSwitchState && aNowUs - aSwitch.myLastEdgeUs >= quietUs;
+	if (quiet)
+	{
+		Finish(aSwitch);
+	}
+	portEXIT_CRITICAL(&myLock);
+	return !quiet;
+}
+
+// Edges only start the sampling and get counted, the integrator decides what they add up to
 void IRAM_ATTR MovementSwitches::DebounceHandler(void *arg)
 {
 	Switch *aSwitch = static_cast<Switch *>(arg);
-	aSwitch->myLastStateChangeTime = xTaskGetTickCountFromISR();
-	aSwitch->myHasPendingStateChange = true;
+	portENTER_CRITICAL_ISR(&myLock);
+	// The first edge is sample 0, as a poll that saw it would count it, so the timer's samples
+	// confirm a change no later than polling would. Once sampling has started the timer owns
+	// the integrator.
+	if (!aSwitch->mySampling)
+	{
+		Integrate(*aSwitch, gpio_get_level(aSwitch->mySwitchPin));
+	}
+	NoteEdge(*aSwitch, esp_timer_get_time());
+	portEXIT_CRITICAL_ISR(&myLock);
+
+	if (!esp_timer_is_active(aSwitch->myDebounceTimer))
+	{
+		esp_timer_start_once(aSwitch->myDebounceTimer, SAMPLE_US);
+	}
+}
+
+// Rearmed a sample at a time rather than periodic, so an edge arriving as it stops finds it
+// inactive and starts it again, instead of finding it about to be stopped
+void MovementSwitches::DebounceTimerCallback(void *arg)
+{
+	Switch *aSwitch = static_cast<Switch *>(arg);
+	if (Sample(*aSwitch, gpio_get_level(aSwitch->mySwitchPin), esp_timer_get_time()))
+	{
+		// Already armed if an edge came in meanwhile
+		esp_timer_start_once(aSwitch->myDebounceTimer, SAMPLE_US);
+	}
 }
 
 void MovementSwitches::DebounceTask(void *arg)
 {
     while (true)
     {
+        if (myMode != SwitchMode::Polling)
+        {
+            // Until SetMode wants polling again
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
         for (auto &aSwitch : MovementSwitches::mySwitches)
         {
-            bool currentLevel = gpio_get_level(aSwitch->mySwitchPin);
+            const bool currentLevel = gpio_get_level(aSwitch->mySwitchPin);
+            const int64_t now = esp_timer_get_time();
 
-            // Check if switch state has changed
-            if (currentLevel != aSwitch->myLastSwitchState)
+            // The edges a poll can see, anything shorter than a sample goes unnoticed
+            if (currentLevel != aSwitch->myLastLevel)
             {
-                // Reset the last change time if state has changed
-                aSwitch->myLastStateChangeTime = xTaskGetTickCount();
-                aSwitch->myLastSwitchState = currentLevel;
-				aSwitch->myHasPendingStateChange = true;
+                aSwitch->myLastLevel = currentLevel;
+                portENTER_CRITICAL(&myLock);
+                NoteEdge(*aSwitch, now);
+                portEXIT_CRITICAL(&myLock);
             }
-            else if ((xTaskGetTickCount() - aSwitch->myLastStateChangeTime) >= pdMS_TO_TICKS(aSwitch->myDelay))
+            if (aSwitch->mySampling)
             {
-                // If state is stable for the debounce period, process the state change
-                if (aSwitch->myHasPendingStateChange)
-                {
-                    aSwitch->myHasPendingStateChange = false;
-                    Event event = currentLevel ? aSwitch->mySwitchPressedEvent : aSwitch->mySwitchReleasedEvent;
-
-                    ESP_ERROR_CHECK(PublishEvent(COMMAND_EVENT, event));
-                }
+                Sample(*aSwitch, currentLevel, now);
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(20)); // Polling interval, adjust as needed
+        vTaskDelay(pdMS_TO_TICKS(SAMPLE_PERIOD_MS));
     }
 }
+
+bool MovementSwitches::GetBounceStats(SwitchName aName, BounceStats &aStats)
+{
+	for (std::shared_ptr<Switch> aSwitch : mySwitches)
+	{
+		if (aSwitch->myName == aName)
+		{
+			portENTER_CRITICAL(&myLock);
+			aStats = aSwitch->myStats;
+			portEXIT_CRITICAL(&myLock);
+			return true;
+		}
+	}
+	return false;
+}
+
+void MovementSwitches::ResetBounceStats()
+{
+	portENTER_CRITICAL(&myLock);
+	for (std::shared_ptr<Switch> aSwitch : mySwitches)
+	{
+		aSwitch->myStats = BounceStats();
+	}
+	portEXIT_CRITICAL(&myLock);
+}
+
+void MovementSwitches::PrintStats()
+{
+	printf("switches, integrator sampled every %u ms, %s\n", SAMPLE_PERIOD_MS,
+		   myMode == SwitchMode::Interrupt ? "started by an edge" : "polled");
+	printf("  %-6s %5s %7s %7s %8s %6s %7s %11s %10s %10s %11s\n", "switch", "delay", "confirm", "changes", "rejected", "edges",
+		   "bounces", "max bounces", "last bounce", "max bounce", "max confirm");
+
+	// Copied out first, nothing slow happens with the lock held
+	for (std::shared_ptr<Switch> aSwitch : mySwitches)
+	{
+		BounceStats stats;
+		GetBounceStats(aSwitch->myName, stats);
+		printf("  %-6s %2u ms %4u ms %7u %8u %6u %7u %11u %8.2f ms %7.2f ms %8.2f ms\n", GetName(aSwitch->myName),
+			   aSwitch->myDelay, aSwitch->myThreshold * SAMPLE_PERIOD_MS, stats.myChanges, stats.myRejected, stats.myEdges, stats.myBounces, stats.myMaxBounces,
+			   stats.myLastBounceUs / 1000.0, stats.myMaxBounceUs / 1000.0, stats.myMaxConfirmUs / 1000.0);
+	}
+}
+
+const char *MovementSwitches::GetName(SwitchName aName)
+{
+	switch (aName)
+	{
+	case SwitchName::LEFT:
+		return "left";
+	case SwitchName::RIGHT:
+		return "right";
+	case SwitchName::RAPID:
+		return "rapid";
+	default:
+		return "?";
+	}
+}
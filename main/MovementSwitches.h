@@ -1,8 +1,10 @@
+#pragma once
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/portmacro.h"
 #include "rom/gpio.h"
+#include "driver/gpio.h"
 #include "freertos/queue.h"
 
 #include <memory>
@@ -13,6 +15,8 @@
 #include <freertos/ringbuf.h>
 
 #include "esp_event.h"
+#include <esp_timer.h>
+#include "CommandRing.h"
 
 enum class SwitchName
 {
@@ -21,38 +25,142 @@ enum class SwitchName
 	RAPID
 };
 
+/**
+ **@brief What a switch's contacts did, from the first edge of a press or release until they
+ ** had been quiet for its delay. For picking each switch's delay and confirm time from data.
+ **/
+struct BounceStats
+{
+	uint32_t myChanges = 0;	 // presses and releases confirmed
+	uint32_t myRejected = 0; // activity that settled back where it was, noise or a tap too short to count
+	uint32_t myEdges = 0;
+	uint32_t myBounces = 0;	   // edges beyond the one each change needed
+	uint32_t myMaxBounces = 0; // in one press or release
+	int64_t myLastBounceUs = 0; // first edge to the last one
+	int64_t myMaxBounceUs = 0;
+	int64_t myMaxConfirmUs = 0; // first edge to the change going to the motion task
+};
+
 struct Switch
 {
   public:
-	Switch(gpio_num_t aSwitchPin, uint16_t aDelay, Event aPressedEvent, Event aReleasedEvent);
+	// A clean press reaches the motion task this long after its first edge
+	static constexpr uint8_t CONFIRM_MS = 5;
+
+	/**
+	 **@brief aConfirmMs is how many ms more the switch has to read closed than open before a
+	 ** press counts, and the other way round for a release, longer than any noise. aDelay is
+	 ** how long the contacts have to go without an edge before the press or release is over,
+	 ** it only has to outlast the bounce, see BounceStats::myMaxBounceUs. Until then the
+	 ** switch can't change back, so a bounce that reads the other way long enough to confirm
+	 ** doesn't make a second change.
+	 **/
+	Switch(gpio_num_t aSwitchPin, uint16_t aDelay, Event aPressedEvent, Event aReleasedEvent,
+		   uint8_t aConfirmMs = CONFIRM_MS);
 	gpio_num_t mySwitchPin;
+	SwitchName myName = SwitchName::LEFT;
 	Event mySwitchPressedEvent;
 	Event mySwitchReleasedEvent;
-	TickType_t myLastStateChangeTime = 0;
 	uint16_t myDelay;
 	gpio_pull_mode_t myPullMode;
 	gpio_int_type_t myIntrType;
 	gpio_mode_t myMode;
 	bool callbackCalled;
-	bool myLastSwitchState;
-	bool myHasPendingStateChange;
+	bool myLastSwitchState; // as reported to the motion task
+	esp_timer_handle_t myDebounceTimer = nullptr;
+
+	// Counts up a sample read closed and down one read open, saturating at 0 and myThreshold,
+	// aConfirmMs of samples. The switch only changes state at either end.
+	uint8_t myIntegrator = 0;
+	uint8_t myThreshold;
+
+	// The press or release underway, from its first edge
+	bool mySampling = false;
+	bool myLastLevel = false; // polling only, as last read, to find the edges
+	uint32_t myEdges = 0;
+	uint32_t myChanges = 0;
+	int64_t myFirstEdgeUs = 0;
+	int64_t myLastEdgeUs = 0;
+	int64_t myConfirmUs = 0; // first edge to the last change it made going out
+	BounceStats myStats;
+};
+
+enum class SwitchMode
+{
+	Interrupt, // an edge starts the integrator sampling on an esp_timer, until the switch is quiet again
+	Polling	   // every switch sampled every SAMPLE_PERIOD_MS by a task, whether it's moving or not
 };
 
 class MovementSwitches : public EventPublisher
 {
   public:
+	// The integrator's clock, in both modes. A confirmed change the motion task's ring had no
+	// room for goes again on the next sample.
+	static constexpr uint32_t SAMPLE_PERIOD_MS = 1;
+	static constexpr uint64_t SAMPLE_US = SAMPLE_PERIOD_MS * 1000ULL;
+
 	static void Create();
 
 	static void AddSwitch(SwitchName aName, std::shared_ptr<Switch> aSwitch);
 
-	static void Start();
+	/**
+	 **@brief Start watching the switches, sending confirmed presses and releases through aCommands
+	 **/
+	static void Start(CommandRing &aCommands, SwitchMode aMode = SwitchMode::Interrupt);
+
+	/**
+	 **@brief Change how the switches are read, to compare the two. Call with them at rest,
+	 ** a change underway when it is called may go unreported.
+	 **/
+	static void SetMode(SwitchMode aMode);
+	static SwitchMode GetMode() { return myMode; }
+
+	/**
+	 **@brief Bounce statistics of the switch added as aName, false if there isn't one
+	 **/
+	static bool GetBounceStats(SwitchName aName, BounceStats &aStats);
+	static void ResetBounceStats();
+	/**
+	 **@brief Print every switch's bounce statistics, to stdout
+	 **/
+	static void PrintStats();
+
+	static const char *GetName(SwitchName aName);
 
   private:
 	static std::shared_ptr<esp_event_loop_handle_t> myEventLoop;
 
 	static std::vector<std::shared_ptr<Switch>> mySwitches;
+	static CommandRing *myCommands;
+
+	static SwitchMode myMode;
+	static TaskHandle_t myPollTask;
 
 	static void IRAM_ATTR DebounceHandler(void *arg);
+	static void DebounceTimerCallback(void *arg);
 	static void IRAM_ATTR DebounceTask(void *arg);
+
+	/**
+	 **@brief Count aLevel into aSwitch's integrator, saturating
+	 **/
+	static void IRAM_ATTR Integrate(Switch &aSwitch, bool aLevel);
+
+	/**
+	 **@brief One tick of aSwitch's integrator, sending the change if it confirms one
+	 ** @return true while it still needs sampling, false once it has gone quiet
+	 **/
+	static bool Sample(Switch &aSwitch, bool aLevel, int64_t aNowUs);
+	// Settle aSwitch where it reads now, nothing underway
+	static void Reset(Switch &aSwitch);
+	// These two with myLock held
+	static void IRAM_ATTR NoteEdge(Switch &aSwitch, int64_t aNowUs);
+	static void Finish(Switch &aSwitch);
+
+	// The switches' sampling and statistics, shared by the edge interrupt and the timer task
+	static portMUX_TYPE myLock;
+
+	// Polling only. Above the event bus, so a release is seen on time however busy the screen
+	// and settings keep it. The debounce timers run on the esp_timer task, above both.
+	static constexpr UBaseType_t DEBOUNCE_TASK_PRIORITY = configMAX_PRIORITIES - 4;
 };
 
@@ -0,0 +1,99 @@
+#include "Position.h"
+#include "StepGenerator.h"
+#include "config.h"
+#include <algorithm>
+#include <esp_log.h>
+
+void Position::Start(StepGenerator *aBackend, uint64_t aPeriodUs)
+{
+	myBackend = aBackend;
+	myZero = myBackend->GetPosition();
+
+	const esp_timer_create_args_t timer_args = {
+		.callback = SampleTimerCallback,
+		.arg = this,
+		.dispatch_method = ESP_TIMER_TASK,
+		.name = "PositionSample",
+		.skip_unhandled_events = true};
+
+	ESP_ERROR_CHECK(esp_timer_create(&timer_args, &myTimer));
+	ESP_ERROR_CHECK(esp_timer_start_periodic(myTimer, aPeriodUs));
+}
+
+void Position::Zero()
+{
+	myZeroRequested.store(true, std::memory_order_release);
+	ESP_LOGI("Position", "Zeroing position");
+}
+
+float Position::GetMm() const
+{
+	return GetSteps() / stepsPerMm;
+}
+
+float Position::GetInches() const
+{
+	return GetMm() * 0.0393701;
+}
+
+float Position::Get(SpeedUnit aUnit) const
+{
+	return aUnit == SpeedUnit::MMPM ? GetMm() : GetInches();
+}
+
+void Position::SampleTimerCallback(void *aPosition)
+{
+	static_cast<Position *>(aPosition)->Sample();
+}
+
+void Position::Queued(int32_t aStart, int32_t aSteps, bool aTakeUp)
+{
+	const uint32_t queued = myQueued.load(std::memory_order_relaxed);
+	const int32_t takeUpBefore = myTakeUpQueued.load(std::memory_order_relaxed);
+	QueuedCommand &command = myQueueLog[queued % QUEUE_LOG_LENGTH];
+	command.myStart.store(aStart, std::memory_order_relaxed);
+	command.myTakeUp.store(aTakeUp ? aSteps : 0, std::memory_order_relaxed);
+	command.myTakeUpBefore.store(takeUpBefore, std::memory_order_relaxed);
+	myTakeUpQueued.store(takeUpBefore + (aTakeUp ? aSteps : 0), std::memory_order_relaxed);
+	myQueued.store(queued + 1, std::memory_order_release);
+}
+
+void Position::QueueDrained()
+{
+	myDrained.store(myQueued.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void Position::Sample()
+{
+	int32_t motor;
+	int32_t takeUp;
+	uint32_t queued;
+	uint8_t entries;
+	do
+	{
+		queued = myQueued.load(std::memory_order_acquire);
+		entries = myBackend->GetQueueEntries();
+		motor = myBackend->GetPosition();
+		// The motor is in the first command that hasn't finished, or past all of them
+		uint32_t done = queued - std::min<uint32_t>(entries, queued);
+		done = std::max(done, myDrained.load(std::memory_order_relaxed));
+		takeUp = myTakeUpQueued.load(std::memory_order_relaxed);
+		if (done != queued)
+		{
+			// Part way through a take-up command, only the steps it has put out so far count
+			const QueuedCommand &command = myQueueLog[done % QUEUE_LOG_LENGTH];
+			const int32_t steps = command.myTakeUp.load(std::memory_order_relaxed);
+			const int32_t moved = motor - command.myStart.load(std::memory_order_relaxed);
+			const int32_t out = steps >= 0 ? std::clamp(moved, 0, steps) : std::clamp(moved, steps, 0);
+			takeUp = command.myTakeUpBefore.load(std::memory_order_relaxed) + out;
+		}
+		// A command going out or being added in between would pair the motor with the wrong one
+	} while (queued != myQueued.load(std::memory_order_acquire) || entries != myBackend->GetQueueEntries());
+
+	const int32_t table = motor - takeUp;
+	if (myZeroRequested.exchange(false, std::memory_order_acq_rel))
+	{
+		myZero = table;
+	}
+	mySteps.store(table - myZero, std::memory_order_release);
+}
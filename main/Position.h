@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "esp_timer.h"
+#include "state.h"
+
+class StepGenerator;
+
+/**
+ * @brief Table position, in steps from wherever it was last zeroed.
+ *
+ * A timer samples the backend's step count and is the only thing that writes the
+ * position, as a single atomic. Reads are one load, so the screen and anything else
+ * can read it as often as they like without ever holding up the motion path, and a
+ * read never sees a half applied zero.
+ *
+ * Steps that only take up backlash after a change of direction don't move the table,
+ * so they are left out. Stepper notes every command it puts in the backend's step queue,
+ * and the sampler works out which of them the motor is in from how many are still
+ * waiting, so the take-up steps left out are the ones that have actually gone out.
+ */
+class Position
+{
+  public:
+	/**
+	 **@brief Start sampling aBackend every aPeriodUs
+	 **/
+	void Start(StepGenerator *aBackend, uint64_t aPeriodUs = 20000);
+
+	/**
+	 **@brief Make the current position zero, taken up by the next sample
+	 **/
+	void Zero();
+
+	/**
+	 **@brief Note a command Stepper put in the step queue, aSteps signed from aStart. Take-up
+	 ** steps never count as table position. Only called from the task that fills the queue.
+	 **/
+	void Queued(int32_t aStart, int32_t aSteps, bool aTakeUp);
+
+	/**
+	 **@brief Everything queued so far has gone out, the backend's own ramp is about to start
+	 ** and the entries it puts in the queue aren't ones noted here
+	 **/
+	void QueueDrained();
+
+	int32_t GetSteps() const { return mySteps.load(std::memory_order_acquire); }
+	float GetMm() const;
+	float GetInches() const;
+
+	/**
+	 **@brief Position in the length unit that goes with a speed unit
+	 **/
+	float Get(SpeedUnit aUnit) const;
+
+  private:
+	static void SampleTimerCallback(void *aPosition);
+	void Sample();
+
+	StepGenerator *myBackend = nullptr;
+	esp_timer_handle_t myTimer = nullptr;
+
+	// The last commands noted, enough to cover every one the queue can hold. A slot is written
+	// before myQueued counts it, and the sampler checks myQueued again after reading it.
+	static constexpr uint32_t QUEUE_LOG_LENGTH = 64;
+	struct QueuedCommand
+	{
+		std::atomic<int32_t> myStart{0};
+		// Signed, 0 unless the whole command takes up backlash
+		std::atomic<int32_t> myTakeUp{0};
+		// Signed take-up steps in all the commands before this one
+		std::atomic<int32_t> myTakeUpBefore{0};
+	};
+	QueuedCommand myQueueLog[QUEUE_LOG_LENGTH];
+	std::atomic<uint32_t> myQueued{0};
+	std::atomic<uint32_t> myDrained{0};
+	std::atomic<int32_t> myTakeUpQueued{0};
+
+	// Where the table was at the last zero, in motor steps. Only touched by the sampler.
+	int32_t myZero = 0;
+	std::atomic<bool> myZeroRequested{false};
+	std::atomic<int32_t> mySteps{0};
+};
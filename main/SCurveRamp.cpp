@@ -0,0 +1,165 @@
+#include "SCurveRamp.h"
+#include <cmath>
+
+SCurveRamp::SCurveRamp(float anAcceleration, float aDeceleration, float aJerk, uint32_t aTicksPerSecond)
+	: myMaxAcceleration(anAcceleration),
+	  myMaxDeceleration(aDeceleration),
+	  myJerk(aJerk),
+	  myTicksPerSecond(aTicksPerSecond)
+{
+	myFirstStepTime = cbrtf(6.0f / myJerk);
+	myMinSpeed = myJerk * myFirstStepTime * myFirstStepTime / 2;
+}
+
+void SCurveRamp::SetTargetSpeed(float aStepsPerSecond)
+{
+	myTargetSpeed = aStepsPerSecond > 0 ? aStepsPerSecond : 0;
+	myReversing = false;
+}
+
+void SCurveRamp::Reverse(float aStepsPerSecond)
+{
+	SetTargetSpeed(aStepsPerSecond);
+	// From standstill there is nothing to turn around, the next step already goes the other way
+	myReversing = mySpeed > 0;
+}
+
+void SCurveRamp::Reset()
+{
+	mySpeed = 0;
+	myAcceleration = 0;
+	myTargetSpeed = 0;
+	myReversing = false;
+}
+
+uint32_t SCurveRamp::NextInterval()
+{
+	if (mySpeed <= 0)
+	{
+		if (myTargetSpeed <= 0)
+		{
+			return 0;
+		}
+
+		// Starting from rest: one step covered at constant jerk.
+		mySpeed = myMinSpeed < myTargetSpeed ? myMinSpeed : myTargetSpeed;
+		myAcceleration = myJerk * myFirstStepTime;
+		if (myAcceleration > myMaxAcceleration)
+		{
+			myAcceleration = myMaxAcceleration;
+		}
+		return static_cast<uint32_t>(myFirstStepTime * myTicksPerSecond);
+	}
+
+	const float dt = 1.0f / mySpeed;
+	const float startSpeed = mySpeed;
+	const float startAcceleration = myAcceleration;
+	// Speed still gained (or lost) while the current acceleration is brought back to zero.
+	const float settleSpeed = myAcceleration * myAcceleration / (2 * myJerk);
+	// While reversing the target is on the far side of zero, so nothing eases off before it.
+	const float targetSpeed = myReversing ? -myTargetSpeed : myTargetSpeed;
+
+	float jerk = 0;
+	if (mySpeed < targetSpeed)
+	{
+		if (myAcceleration > 0 && mySpeed + settleSpeed >= targetSpeed)
+		{
+			jerk = -myJerk;
+		}
+		else if (myAcceleration < myMaxAcceleration)
+		{
+			jerk = myJerk;
+		}
+	}
+	else if (mySpeed > targetSpeed)
+	{
+		if (myAcceleration < 0 && mySpeed - settleSpeed <= targetSpeed)
+		{
+			jerk = myJerk;
+		}
+		else if (myAcceleration > -myMaxDeceleration)
+		{
+			jerk = -myJerk;
+		}
+	}
+
+	myAcceleration += jerk * dt;
+	if (myAcceleration > myMaxAcceleration)
+	{
+		myAcceleration = myMaxAcceleration;
+	}
+	else if (myAcceleration < -myMaxDeceleration)
+	{
+		myAcceleration = -myMaxDeceleration;
+	}
+
+	// Bringing acceleration back to zero must not swing it past zero.
+	if ((startAcceleration > 0 && myAcceleration < 0 && startSpeed < targetSpeed) ||
+		(startAcceleration < 0 && myAcceleration > 0 && startSpeed > targetSpeed))
+	{
+		myAcceleration = 0;
+	}
+
+	const float averageAcceleration = (startAcceleration + myAcceleration) / 2;
+	if (myReversing && startSpeed * startSpeed <= -2 * averageAcceleration)
+	{
+		// Turns around before it gets to the next step, so it goes out and comes back through
+		// this one at the speed it left it. Past that it is speeding up the other way.
+		myReversing = false;
+		myAcceleration = fminf(-myAcceleration, myMaxAcceleration);
+		return static_cast<uint32_t>(2 * startSpeed / -averageAcceleration * myTicksPerSecond);
+	}
+
+	mySpeed += averageAcceleration * dt;
+
+	if ((startSpeed < myTargetSpeed && mySpeed >= myTargetSpeed) ||
+		(startSpeed > myTargetSpeed && mySpeed <= myTargetSpeed))
+	{
+		mySpeed = myTargetSpeed;
+		myAcceleration = 0;
+	}
+
+	if (myTargetSpeed <= 0 && mySpeed < myMinSpeed)
+	{
+		// This was the last step of a ramp down.
+		mySpeed = 0;
+		myAcceleration = 0;
+	}
+
+	return static_cast<uint32_t>(dt * myTicksPerSecond);
+}
+
+float SCurveRamp::StoppingDistance(float aSpeed) const
+{
+	// The ramp down is symmetric about its midpoint, so the average speed is half the start speed.
+	if (aSpeed >= myMaxDeceleration * myMaxDeceleration / myJerk)
+	{
+		return aSpeed / 2 * (aSpeed / myMaxDeceleration + myMaxDeceleration / myJerk);
+	}
+	// Never reaches full deceleration
+	return aSpeed * sqrtf(aSpeed / myJerk);
+}
+
+uint32_t SCurveRamp::GetStoppingSteps() const
+{
+	if (mySpeed <= 0)
+	{
+		return 0;
+	}
+
+	// Acceleration has to go through zero first, find the speed where it does and the
+	// distance covered from there.
+	const float settleTime = fabsf(myAcceleration) / myJerk;
+	const float settleSpeed = mySpeed + myAcceleration * myAcceleration / (2 * myJerk);
+	float distance = StoppingDistance(settleSpeed);
+	if (myAcceleration > 0)
+	{
+		distance += mySpeed * settleTime + myAcceleration * settleTime * settleTime / 3;
+	}
+	else if (myAcceleration < 0)
+	{
+		// Already part way into a ramp down that started at settleSpeed
+		distance -= settleSpeed * settleTime - myJerk * settleTime * settleTime * settleTime / 6;
+	}
+	return static_cast<uint32_t>(ceilf(distance));
+}
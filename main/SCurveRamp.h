@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Jerk limited (S-curve) speed ramp that is evaluated one step at a time.
+ *
+ * Acceleration builds up and falls away at a constant jerk instead of jumping
+ * straight to its limit, so starts, rapid engages and stops don't hammer the gear
+ * train. The target can be changed at any point, including part way through a ramp.
+ */
+class SCurveRamp
+{
+  public:
+	SCurveRamp(float anAcceleration, float aDeceleration, float aJerk, uint32_t aTicksPerSecond);
+
+	void SetTargetSpeed(float aStepsPerSecond);
+
+	/**
+	 ** @brief Ramp down and carry straight on up to aStepsPerSecond the other way. The
+	 ** deceleration is held through zero and becomes the acceleration the other way, instead
+	 ** of falling away to a stop and building up again from standstill.
+	 **/
+	void Reverse(float aStepsPerSecond);
+
+	/**
+	 ** @brief true from Reverse until the last step before turning around has been generated,
+	 ** the steps after that go the other way
+	 **/
+	bool IsReversing() const { return myReversing; }
+
+	/**
+	 ** @brief Advance the ramp by one step
+	 ** @return The time until the following step, in ticks
+	 **/
+	uint32_t NextInterval();
+
+	/**
+	 ** @brief Drop straight to standstill, for when the motor is stopped by other means
+	 **/
+	void Reset();
+
+	/**
+	 ** @brief false once a ramp down to zero has produced its last step
+	 **/
+	bool IsActive() const { return mySpeed > 0 || myTargetSpeed > 0; }
+	bool IsAtTarget() const { return mySpeed == myTargetSpeed; }
+	float GetSpeed() const { return mySpeed; }
+	float GetAcceleration() const { return myAcceleration; }
+	float GetTargetSpeed() const { return myTargetSpeed; }
+
+	/**
+	 ** @brief Steps still put out if the target went to zero now, this one included
+	 **/
+	uint32_t GetStoppingSteps() const;
+
+  private:
+	/**
+	 ** @brief Distance of a full ramp down from aSpeed, starting with no acceleration
+	 **/
+	float StoppingDistance(float aSpeed) const;
+
+	float myMaxAcceleration;
+	float myMaxDeceleration;
+	float myJerk;
+	float myTicksPerSecond;
+
+	// The first step from standstill takes cbrt(6 / jerk) seconds and leaves the motor
+	// at this speed. A ramp down ends when it gets back under it.
+	float myFirstStepTime;
+	float myMinSpeed;
+
+	float mySpeed = 0;
+	float myAcceleration = 0;
+	float myTargetSpeed = 0;
+	bool myReversing = false;
+};
@@ -89,8 +89,16 @@ void Screen::Update()
 		myPrevState = myState;
 	}
 	
-	DrawSpeed();
-	DrawSpeedUnit();
+	if (myView == ScreenView::Position && myPosition)
+	{
+		DrawPosition();
+		DrawPositionUnit();
+	}
+	else
+	{
+		DrawSpeed();
+		DrawSpeedUnit();
+	}
 	DrawState();
 
 	
@@ -166,6 +174,34 @@ void Screen::DrawSpeed()
 	u8g2_DrawStr(&u8g2, x, 16, buffer);
 }
 
+void Screen::DrawCentered(const char *aText, uint8_t aY)
+{
+	const uint8_t textWidth = u8g2_GetUTF8Width(&u8g2, aText);
+	const uint8_t x = (128 - textWidth) / 2;
+	u8g2_DrawStr(&u8g2, x, aY, aText);
+}
+
+void Screen::DrawPosition()
+{
+	u8g2_SetFont(&u8g2, u8g2_font_ncenB14_tr);
+	char buffer[20];
+	if (mySpeedUnit == SpeedUnit::MMPM)
+	{
+		sprintf(buffer, "%+.2f", myPosition->GetMm());
+	}
+	else
+	{
+		sprintf(buffer, "%+.4f", myPosition->GetInches());
+	}
+	DrawCentered(buffer, 16);
+}
+
+void Screen::DrawPositionUnit()
+{
+	u8g2_SetFont(&u8g2, u8g2_font_ncenB12_tr);
+	DrawCentered(mySpeedUnit == SpeedUnit::MMPM ? "mm" : "in", 32);
+}
+
 void Screen::SetSpeedState(SpeedState aSpeedState)
 {
 	mySpeedState = aSpeedState;
@@ -225,6 +261,16 @@ float Screen::SpeedPerMinute()
 	}
 }
 
+void Screen::SetPosition(const Position *aPosition)
+{
+	myPosition = aPosition;
+}
+
+void Screen::ToggleView()
+{
+	myView = myView == ScreenView::Speed ? ScreenView::Position : ScreenView::Speed;
+}
+
 void Screen::ToggleUnits() 
 {
 	if (mySpeedUnit == SpeedUnit::MMPM)
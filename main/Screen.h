@@ -6,6 +6,7 @@
 #include <memory>
 #include "shared.h"
 #include "state.h"
+#include "Position.h"
 
 extern "C"
 {
@@ -27,6 +28,12 @@ class Screen
 	void SetSpeedState(SpeedState aSpeedState);
 	void Start();
 	void ToggleUnits();
+	void ToggleView();
+
+	/**
+	 **@brief Where the DRO view reads the table position from
+	 **/
+	void SetPosition(const Position *aPosition);
 
 	SpeedUnit mySpeedUnit = SpeedUnit::MMPM;
   private:
@@ -37,6 +44,8 @@ class Screen
 	SpeedState mySpeedState = SpeedState::Normal;
 	SpeedState myPrevSpeedState = SpeedState::Normal;
 	SpeedUnit myPrevSpeedUnit = SpeedUnit::MMPM;
+	ScreenView myView = ScreenView::Speed;
+	const Position *myPosition = nullptr;
 	u8g2_t u8g2;
 	u8g2_esp32_hal_t u8g2_esp32_hal;
 	
@@ -46,6 +55,9 @@ class Screen
 	void Update();
 	void DrawSpeed();
 	void DrawSpeedUnit();
+	void DrawPosition();
+	void DrawPositionUnit();
+	void DrawCentered(const char *aText, uint8_t aY);
 	void DrawState();
 	void DrawUnit();
 
@@ -34,6 +34,7 @@ Settings::Settings() : EventHandler()
 	RegisterEventHandler(SETTINGS_EVENT, Event::SetSpeedUnit, &UpdateSettingsEventCallback);
 	RegisterEventHandler(SETTINGS_EVENT, Event::SaveNormalSpeed, &UpdateSettingsEventCallback);
 	RegisterEventHandler(SETTINGS_EVENT, Event::SaveRapidSpeed, &UpdateSettingsEventCallback);
+	RegisterEventHandler(SETTINGS_EVENT, Event::SaveBacklash, &UpdateSettingsEventCallback);
 
 	const esp_timer_create_args_t timer_args = {
 		.callback = SaveSettingsTimerCallback,
@@ -82,6 +83,13 @@ esp_err_t Settings::Save()
 		return err;
 	}
 
+	err = nvs_set_i32(my_handle, BACKLASH_KEY, myData->myBacklashSteps);
+	if (err != ESP_OK)
+	{
+		nvs_close(my_handle);
+		return err;
+	}
+
 	// Commit written value to NVS
 	err = nvs_commit(my_handle);
 	if (err != ESP_OK)
@@ -135,7 +143,15 @@ esp_err_t Settings::Load()
 //		return myData;
 	}
 	
+	err = nvs_get_i32(my_handle, BACKLASH_KEY, &myData->myBacklashSteps);
+	if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+	{
+//		nvs_close(my_handle);
+//		return myData;
+	}
+
 	myData->mySpeedUnits = static_cast<SpeedUnit>(units);
+	mySavedData->myBacklashSteps = myData->myBacklashSteps;
 	mySavedData->myNormalSpeed = myData->myNormalSpeed;
 	mySavedData->myRapidSpeed = myData->myRapidSpeed;
 	mySavedData->mySpeedUnits = static_cast<SpeedUnit>(units);
@@ -171,6 +187,12 @@ void Settings::SaveSettingsTimerCallback(void* param)
 		changed = true;
 	}
 
+	if (int32_t backlash = settings->myData->myBacklashSteps; settings->mySavedData->myBacklashSteps != backlash)
+	{
+		settings->mySavedData->myBacklashSteps = backlash;
+		changed = true;
+	}
+
 	if (changed)
 	{
 		settings->Save();
@@ -187,7 +209,7 @@ void Settings::UpdateSettingsEventCallback(void* param, esp_event_base_t base, i
 	{
 	case Event::SetSpeedUnit:
 		{
-			auto const *evtData = static_cast<SingleValueEventData<SpeedUnit> *>(event_data);
+			auto const *evtData = GetPayload<Event::SetSpeedUnit>(event_data);
 			auto su = evtData->myValue;
 			myRef->myData->mySpeedUnits = su;
 		}
@@ -195,17 +217,23 @@ void Settings::UpdateSettingsEventCallback(void* param, esp_event_base_t base, i
 		break;
 	case Event::SaveNormalSpeed:
 		{
-			auto const *evtData = (SingleValueEventData<uint32_t> *)event_data;
+			auto const *evtData = GetPayload<Event::SaveNormalSpeed>(event_data);
 			myRef->myData->myNormalSpeed = evtData->myValue;
 		}
 		
 		break;
 	case Event::SaveRapidSpeed:
 		{
-			auto const *evtData = (SingleValueEventData<uint32_t> *)event_data;
+			auto const *evtData = GetPayload<Event::SaveRapidSpeed>(event_data);
 			myRef->myData->myRapidSpeed = evtData->myValue;
 		}
 		break;
+	case Event::SaveBacklash:
+		{
+			auto const *evtData = GetPayload<Event::SaveBacklash>(event_data);
+			myRef->myData->myBacklashSteps = evtData->myValue;
+		}
+		break;
 	default:
 		break;
 	}
@@ -11,6 +11,7 @@ struct SettingsData
 	int32_t myNormalSpeed = 1;
 	int32_t myRapidSpeed = maxOutputRPM;
 	SpeedUnit mySpeedUnits = SpeedUnit::MMPM;
+	int32_t myBacklashSteps = 0;
 };
 
 class Settings : public EventHandler
@@ -45,4 +46,5 @@ class Settings : public EventHandler
 	static constexpr char const *NORMAL_SPEED_KEY = "0002";
 	static constexpr char const *RAPID_SPEED_KEY = "0003";
 	static constexpr char const *SPEED_UNITS_KEY = "0004";
+	static constexpr char const *BACKLASH_KEY = "0005";
 };
\ No newline at end of file
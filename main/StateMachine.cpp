@@ -8,6 +8,11 @@
 #include <esp_event.h>
 #include "StateMachine.h"
 #include "EventTypes.h"
+#include "EventTrace.h"
+#include <esp_timer.h>
+#include <algorithm>
+
+portMUX_TYPE StateMachine::myStatsLock = portMUX_INITIALIZER_UNLOCKED;
 
 StateMachine::StateMachine(std::shared_ptr<Stepper> aStepper) : currentState(State::Stopped), currentSpeedState(SpeedState::Normal) {
     myStepper = aStepper;
@@ -18,39 +23,309 @@ StateMachine::StateMachine(std::shared_ptr<Stepper> aStepper) : currentState(Sta
 
 void StateMachine::Start()
 {
+	xTaskCreatePinnedToCore(MotionTask, "MotionTask", MOTION_TASK_STACK_SIZE, this, MOTION_TASK_PRIORITY, &myMotionTask, 0);
+	mySwitchCommands.SetConsumer(myMotionTask);
+	myUrgentCommands.SetConsumer(myMotionTask);
+	myEncoderCommands.SetConsumer(myMotionTask);
+	myBusCommands.SetConsumer(myMotionTask);
 	RegisterEventHandler(COMMAND_EVENT, Event::Any, ProcessEventCallback);
 }
 
+StateMachine::CycleStats StateMachine::GetCycleStats()
+{
+	portENTER_CRITICAL(&myStatsLock);
+	const CycleStats stats = myCycleStats;
+	portEXIT_CRITICAL(&myStatsLock);
+	return stats;
+}
+
+StateMachine::SpeedUpdateStats StateMachine::GetSpeedUpdateStats()
+{
+	portENTER_CRITICAL(&myStatsLock);
+	const SpeedUpdateStats stats = mySpeedUpdateStats;
+	portEXIT_CRITICAL(&myStatsLock);
+	return stats;
+}
+
+StateMachine::ResponseStats StateMachine::GetResponseStats()
+{
+	portENTER_CRITICAL(&myStatsLock);
+	const ResponseStats stats = myResponseStats;
+	portEXIT_CRITICAL(&myStatsLock);
+	return stats;
+}
+
+void StateMachine::ResetResponseStats()
+{
+	portENTER_CRITICAL(&myStatsLock);
+	myResponseStats = ResponseStats();
+	portEXIT_CRITICAL(&myStatsLock);
+}
+
 void StateMachine::ProcessEventCallback(void *stateMachine, esp_event_base_t base, int32_t id, void *payload) 
 {
 	StateMachine *sm = static_cast<StateMachine *>(stateMachine);
 
-	Event event = static_cast<Event>(id);
-	EventData *eventData = static_cast<EventData *>(payload);
-	sm->ProcessEvent(event, eventData);
+	// Runs on the event bus's dispatch task, the only producer for this ring
+	const Event event = static_cast<Event>(id);
+	const size_t size = payload ? EventRegistry::PayloadSize(event) : 0;
+	if (!EventRegistry::IsValidPayload(event, size))
+	{
+		ESP_LOGE("state.cpp", "Dropped event %d, published without its payload", id);
+		return;
+	}
+	CommandRing &commands = EventRegistry::IsUrgent(event) ? sm->myUrgentCommands : sm->myBusCommands;
+	while (!commands.Post(event, payload, size, EventBus::GetPostedUs()))
+	{
+		vTaskDelay(1);
+	}
 }
 
-void StateMachine::MoveLeftAction() {
-    if(currentState == State::MovingLeft) {
-        return;
-    }
+void StateMachine::MotionTask(void *stateMachine)
+{
+	StateMachine *sm = static_cast<StateMachine *>(stateMachine);
+	while (true)
+	{
+		while (sm->ProcessUrgentCommands() | sm->ProcessCommands(sm->myEncoderCommands, true) |
+			   sm->ProcessCommands(sm->myBusCommands, true))
+		{
+		}
+		sm->FlushSpeedUpdate();
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+}
+
+bool StateMachine::ProcessUrgentCommands()
+{
+	return ProcessCommands(mySwitchCommands, false) | ProcessCommands(myUrgentCommands, false);
+}
+
+bool StateMachine::ProcessCommands(CommandRing &aCommands, bool aYieldToUrgent)
+{
+	bool processed = false;
+	MotionCommand command;
+	while (aCommands.Take(command))
+	{
+		processed = true;
+		if (command.myEvent == Event::UpdateSpeed && command.mySize)
+		{
+			MergeSpeedUpdate(command);
+			continue;
+		}
+		// These change which speed the deltas apply to, so the deltas go first
+		if (command.myEvent == Event::RapidSpeed || command.myEvent == Event::NormalSpeed)
+		{
+			FlushSpeedUpdate();
+		}
+		DispatchCommand(command);
+		if (aYieldToUrgent)
+		{
+			ProcessUrgentCommands();
+		}
+	}
+	return processed;
+}
+
+void StateMachine::DispatchCommand(MotionCommand &aCommand)
+{
+	const int64_t latencyUs = esp_timer_get_time() - aCommand.myPostedUs;
+	EventData *eventData = aCommand.mySize ? reinterpret_cast<EventData *>(aCommand.myPayload) : nullptr;
+	const uint32_t start = EventTrace::GetCycles();
+	ProcessEvent(aCommand.myEvent, eventData);
+	EventTrace::RecordDispatch(EventTrace::Path::Motion, static_cast<int32_t>(aCommand.myEvent),
+							   static_cast<uint32_t>(std::min<int64_t>(latencyUs * 1000, UINT32_MAX)),
+							   EventTrace::CyclesToNs(EventTrace::GetCycles() - start));
+
+	const int64_t responseUs = esp_timer_get_time() - aCommand.myPostedUs;
+	portENTER_CRITICAL(&myStatsLock);
+	myResponseStats.myCommands++;
+	myResponseStats.myTotalUs += responseUs;
+	if (myResponseStats.myCommands == 1 || responseUs > myResponseStats.myWorstUs)
+	{
+		myResponseStats.myWorstUs = responseUs;
+		myResponseStats.myWorstEvent = aCommand.myEvent;
+	}
+	if (EventRegistry::IsUrgent(aCommand.myEvent))
+	{
+		myResponseStats.myStops++;
+		myResponseStats.myWorstStopUs = std::max(myResponseStats.myWorstStopUs, responseUs);
+	}
+	portEXIT_CRITICAL(&myStatsLock);
+}
+
+void StateMachine::MergeSpeedUpdate(const MotionCommand &aCommand)
+{
+	portENTER_CRITICAL(&myStatsLock);
+	mySpeedUpdateStats.myReceived++;
+	portEXIT_CRITICAL(&myStatsLock);
+	const int32_t delta = GetPayload<Event::UpdateSpeed>(aCommand.myPayload)->myValue;
+	auto *pending = reinterpret_cast<EventPayloadType<Event::UpdateSpeed> *>(myPendingSpeed.myPayload);
+
+	// The stepper takes its deltas as int16_t, so a sum that won't fit goes on its own
+	if (myPendingSpeedCount)
+	{
+		const int32_t sum = pending->myValue + delta;
+		if (sum < INT16_MIN || sum > INT16_MAX)
+		{
+			FlushSpeedUpdate();
+		}
+	}
+
+	if (!myPendingSpeedCount)
+	{
+		// Keeps the first one's publish time, so the trace shows how long the oldest waited
+		myPendingSpeed = aCommand;
+	}
+	else
+	{
+		pending->myValue += delta;
+	}
+	myPendingSpeedCount++;
+}
+
+void StateMachine::FlushSpeedUpdate()
+{
+	if (!myPendingSpeedCount)
+	{
+		return;
+	}
+
+	const bool apply = GetPayload<Event::UpdateSpeed>(myPendingSpeed.myPayload)->myValue != 0;
+	portENTER_CRITICAL(&myStatsLock);
+	mySpeedUpdateStats.myApplied += apply ? 1 : 0;
+	mySpeedUpdateStats.myMerged += myPendingSpeedCount - (apply ? 1 : 0);
+	mySpeedUpdateStats.myLargestBatch = std::max(mySpeedUpdateStats.myLargestBatch, myPendingSpeedCount);
+	portEXIT_CRITICAL(&myStatsLock);
+	myPendingSpeedCount = 0;
+
+	if (apply)
+	{
+		DispatchCommand(myPendingSpeed);
+	}
+}
+
+namespace
+{
+	// Only ever called while the table is built, where it stops the build
+	void TransitionListedTwice() {}
+
+	constexpr size_t Index(State aState)
+	{
+		return static_cast<size_t>(aState);
+	}
+
+	constexpr size_t Index(Event anEvent)
+	{
+		return static_cast<size_t>(anEvent);
+	}
+} // namespace
+
+constexpr StateMachine::TransitionTable StateMachine::MakeTransitions()
+{
+	TransitionTable table{};
+	auto add = [&table](State aState, Event anEvent, Transition::Action anAction, State aNext = State::Count,
+						Event aPublished = Event::Any) {
+		Transition &transition = table[Index(aState)][Index(anEvent)];
+		if (transition.myAction)
+		{
+			TransitionListedTwice();
+		}
+		transition = Transition{anAction, aNext, aPublished};
+	};
+
+	// Speed, position and settings commands do the same whatever the carriage is doing.
+	// The UI handles these commands directly, so none of them publish anything.
+	for (size_t state = 0; state < STATE_COUNT; state++)
+	{
+		const State any = static_cast<State>(state);
+		add(any, Event::RapidSpeed, &StateMachine::RapidSpeedAction);
+		add(any, Event::NormalSpeed, &StateMachine::NormalSpeedAction);
+		add(any, Event::UpdateSpeed, &StateMachine::UpdateSpeedAction);
+		add(any, Event::ZeroPosition, &StateMachine::ZeroPositionAction);
+		add(any, Event::SetLeftLimit, &StateMachine::SetLeftLimitAction);
+		add(any, Event::SetRightLimit, &StateMachine::SetRightLimitAction);
+		add(any, Event::ClearLimits, &StateMachine::ClearLimitsAction);
+		add(any, Event::SetCycleLeft, &StateMachine::SetCycleLeftAction);
+		add(any, Event::SetCycleRight, &StateMachine::SetCycleRightAction);
+		add(any, Event::SetBacklash, &StateMachine::SetBacklashAction);
+	}
+
+	add(State::Stopped, Event::MoveLeft, &StateMachine::MoveLeftAction, State::MovingLeft, Event::MovingLeft);
+	add(State::Stopped, Event::MoveRight, &StateMachine::MoveRightAction, State::MovingRight, Event::MovingRight);
+	add(State::Stopped, Event::StartCycle, &StateMachine::StartCycleAction);
+
+	add(State::MovingLeft, Event::StopMoveLeft, &StateMachine::StopAction, State::StoppingLeft, Event::Stopping);
+	add(State::MovingRight, Event::StopMoveRight, &StateMachine::StopAction, State::StoppingRight, Event::Stopping);
 
+	// If we are stopping but we ask to move again, in either direction, we can move immediately.
+	// The other way, the stepper ramps through zero and carries on without stopping first.
+	for (State stopping : {State::StoppingLeft, State::StoppingRight})
+	{
+		add(stopping, Event::MoveLeft, &StateMachine::MoveLeftAction, State::MovingLeft, Event::MovingLeft);
+		add(stopping, Event::MoveRight, &StateMachine::MoveRightAction, State::MovingRight, Event::MovingRight);
+		add(stopping, Event::SetStopped, &StateMachine::StoppedAction, State::Stopped, Event::Stopped);
+	}
+
+	// Any movement switch or StopCycle ends the cycle, it stops like a released switch would.
+	for (State cycling : {State::CyclingLeft, State::CyclingRight})
+	{
+		const State stopping = cycling == State::CyclingLeft ? State::StoppingLeft : State::StoppingRight;
+		add(cycling, Event::MoveComplete, &StateMachine::ReverseCycleAction);
+		for (Event stop : {Event::StopCycle, Event::MoveLeft, Event::MoveRight, Event::StopMoveLeft, Event::StopMoveRight})
+		{
+			add(cycling, stop, &StateMachine::StopAction, stopping, Event::Stopping);
+		}
+	}
+
+	return table;
+}
+
+constexpr StateMachine::TransitionTable StateMachine::TRANSITIONS = StateMachine::MakeTransitions();
+
+const StateMachine::Transition &StateMachine::GetTransition(State aState, Event anEvent)
+{
+	return TRANSITIONS[Index(aState)][Index(anEvent)];
+}
+
+uint32_t StateMachine::GetTransitionCount(State aState, Event anEvent) const
+{
+	return myTransitionCounts[Index(aState)][Index(anEvent)];
+}
+
+const char *StateMachine::GetStateName(State aState)
+{
+	switch (aState)
+	{
+	case State::MovingLeft:
+		return "MovingLeft";
+	case State::MovingRight:
+		return "MovingRight";
+	case State::StoppingLeft:
+		return "StoppingLeft";
+	case State::StoppingRight:
+		return "StoppingRight";
+	case State::Stopped:
+		return "Stopped";
+	case State::CyclingLeft:
+		return "CyclingLeft";
+	case State::CyclingRight:
+		return "CyclingRight";
+	default:
+		return "Unknown";
+	}
+}
+
+void StateMachine::MoveLeftAction(const EventData *aPayload) {
     ESP_LOGI("state.cpp", "Left pressed");
-    currentState = State::MovingLeft;
     myStepper->MoveLeft();
 }
 
-void StateMachine::MoveRightAction() {
-    if(currentState == State::MovingRight) {
-        return;
-    }
-
+void StateMachine::MoveRightAction(const EventData *aPayload) {
     ESP_LOGI("state.cpp", "Right pressed");
-    currentState = State::MovingRight;
     myStepper->MoveRight();
 }
 
-void StateMachine::RapidSpeedAction() {
+void StateMachine::RapidSpeedAction(const EventData *aPayload) {
     if(currentSpeedState == SpeedState::Rapid) {
         return;
     }
@@ -58,9 +333,10 @@ void StateMachine::RapidSpeedAction() {
     ESP_LOGI("state.cpp", "Rapid pressed");
     currentSpeedState = SpeedState::Rapid;
     myStepper->SetRapidSpeed();
+    PublishEvent(UI_EVENT, Event::RapidSpeed);
 }
 
-void StateMachine::NormalSpeedAction() {
+void StateMachine::NormalSpeedAction(const EventData *aPayload) {
     if(currentSpeedState == SpeedState::Normal) {
         return;
     }
@@ -68,153 +344,153 @@ void StateMachine::NormalSpeedAction() {
     ESP_LOGI("state.cpp", "Rapid released");
     currentSpeedState = SpeedState::Normal;
     myStepper->SetNormalSpeed();
+    PublishEvent(UI_EVENT, Event::NormalSpeed);
 }
 
 State StateMachine::GetState() {
 	return currentState;
 }
 	
-void StateMachine::CheckIfStoppedTask(void* params) {
-	StateMachine* sm = static_cast<StateMachine*>(params);
-	ASSERT_MSG(sm, "CheckIfStoppedTask", "StateMachine was null on start of task");
-	bool isStopped = false;
-	while(!isStopped) {
-		vTaskDelay(pdMS_TO_TICKS(10));
-		
-		if(sm->myStepper->IsStopped()) {
-			ESP_ERROR_CHECK(sm->PublishEvent(COMMAND_EVENT, Event::SetStopped));
-			isStopped = true;
-			break;
-		}
+void StateMachine::StopAction(const EventData *aPayload) {
+    ESP_LOGI("state.cpp", "Stopping");
+    myStepper->Stop();
+}
+
+void StateMachine::StoppedAction(const EventData *aPayload) {
+    ESP_LOGI("state.cpp", "Stopped");
+}
+
+void StateMachine::SetCycleEnd(int32_t &anEnd, bool &aHasEnd, const EventPayloadType<Event::SetCycleLeft> *eventData) {
+	anEnd = eventData ? eventData->myValue : myStepper->GetBackend().GetPosition();
+	aHasEnd = true;
+	ESP_LOGI("state.cpp", "Cycle end at %d", anEnd);
+}
+
+void StateMachine::StartCycleAction(const EventData *aPayload) {
+	if (!myHasCycleLeft || !myHasCycleRight)
+	{
+		ESP_LOGW("state.cpp", "Both cycle ends need setting before the cycle can start");
+		return;
 	}
-	vTaskDelete(NULL);
+	ESP_LOGI("state.cpp", "Cycle started");
+	myLastReversalUs = 0;
+	portENTER_CRITICAL(&myStatsLock);
+	myCycleStats = CycleStats();
+	portEXIT_CRITICAL(&myStatsLock);
+	currentState = State::CyclingLeft;
+	myStepper->MoveTo(myCycleLeft);
+	PublishEvent(STATE_TRANSITION_EVENT, Event::MovingLeft);
 }
 
-void StateMachine::CreateStoppingTask() {
-	xTaskCreatePinnedToCore(CheckIfStoppedTask, "processing-stopped", 24000, this, 11, nullptr, 1);
+void StateMachine::ReverseCycleAction(const EventData *aPayload) {
+	const int64_t now = esp_timer_get_time();
+	if (myLastReversalUs)
+	{
+		const int64_t pass = now - myLastReversalUs;
+		portENTER_CRITICAL(&myStatsLock);
+		myCycleStats.myMinPassUs = myCycleStats.myPasses ? std::min(myCycleStats.myMinPassUs, pass) : pass;
+		myCycleStats.myMaxPassUs = std::max(myCycleStats.myMaxPassUs, pass);
+		myCycleStats.myTotalPassUs += pass;
+		myCycleStats.myLastPassUs = pass;
+		const uint32_t passes = ++myCycleStats.myPasses;
+		portEXIT_CRITICAL(&myStatsLock);
+		ESP_LOGI("state.cpp", "Cycle pass %u took %lld us", passes, pass);
+	}
+	myLastReversalUs = now;
+
+	if (currentState == State::CyclingLeft)
+	{
+		currentState = State::CyclingRight;
+		myStepper->MoveTo(myCycleRight);
+		PublishEvent(STATE_TRANSITION_EVENT, Event::MovingRight);
+	}
+	else
+	{
+		currentState = State::CyclingLeft;
+		myStepper->MoveTo(myCycleLeft);
+		PublishEvent(STATE_TRANSITION_EVENT, Event::MovingLeft);
+	}
 }
 
-void StateMachine::StopLeftAction() {
-    ESP_LOGI("state.cpp", "Stopping");
-    currentState = State::StoppingLeft;
-    myStepper->Stop();
-	CreateStoppingTask();
+void StateMachine::UpdateSpeedAction(const EventData *aPayload)
+{
+	const auto *eventData = GetPayload<Event::UpdateSpeed>(aPayload);
+	ASSERT_MSG(eventData, "StateMachine", "UpdateSpeed published without a speed delta");
+
+	int32_t delta = eventData->myValue;
+	if (currentSpeedState == SpeedState::Normal)
+	{
+		ESP_LOGI("StateMachine", "Updating normal speed by %d", delta);
+		myStepper->UpdateNormalSpeed(delta);
+	}
+	else
+	{
+		ESP_LOGI("StateMachine", "Updating rapid speed by %d", delta);
+		myStepper->UpdateRapidSpeed(delta);
+	}
 }
 
-void StateMachine::StopRightAction() {
-    ESP_LOGI("state.cpp", "Stopping");
-    currentState = State::StoppingRight;
-    myStepper->Stop();
-	CreateStoppingTask();
+void StateMachine::ZeroPositionAction(const EventData *aPayload)
+{
+	myStepper->GetPosition().Zero();
+}
+
+void StateMachine::SetLeftLimitAction(const EventData *aPayload)
+{
+	myStepper->SetLeftLimit(myStepper->GetBackend().GetPosition());
+}
+
+void StateMachine::SetRightLimitAction(const EventData *aPayload)
+{
+	myStepper->SetRightLimit(myStepper->GetBackend().GetPosition());
+}
+
+void StateMachine::ClearLimitsAction(const EventData *aPayload)
+{
+	myStepper->ClearLimits();
+}
+
+void StateMachine::SetCycleLeftAction(const EventData *aPayload)
+{
+	SetCycleEnd(myCycleLeft, myHasCycleLeft, GetPayload<Event::SetCycleLeft>(aPayload));
+}
+
+void StateMachine::SetCycleRightAction(const EventData *aPayload)
+{
+	SetCycleEnd(myCycleRight, myHasCycleRight, GetPayload<Event::SetCycleRight>(aPayload));
+}
+
+void StateMachine::SetBacklashAction(const EventData *aPayload)
+{
+	const auto *eventData = GetPayload<Event::SetBacklash>(aPayload);
+	ASSERT_MSG(eventData, "StateMachine", "SetBacklash published without a step count");
+
+	myStepper->SetBacklash(eventData->myValue);
+	PublishEvent<Event::SaveBacklash>(SETTINGS_EVENT, eventData->myValue);
 }
 
+// One lookup in the table for the current state and the event, false if it ignores the event.
 bool StateMachine::ProcessEvent(Event event, EventData* eventPayload) {
-    switch (currentState) {
-        case State::Stopped:
-            //ESP_LOGI("state.cpp", "State is stopped");
-            if (event == Event::MoveLeft) {
-                MoveLeftAction();
-				PublishEvent(STATE_TRANSITION_EVENT, Event::MovingLeft);
-				return true;
-			} else if (event == Event::MoveRight) {
-                MoveRightAction();
-				PublishEvent(STATE_TRANSITION_EVENT,Event::MovingRight);
-				return true;
-            }
-            break;
-
-        case State::MovingLeft:
-            if (event == Event::StopMoveLeft) {
-                StopLeftAction();
-				PublishEvent(STATE_TRANSITION_EVENT, Event::Stopping);
-				return true;
-            } 
-            break;
-
-        case State::MovingRight:
-            if (event == Event::StopMoveRight) {
-				StopRightAction();
-				PublishEvent(STATE_TRANSITION_EVENT, Event::Stopping);
-				return true;
-            } 
-            break;
-
-        //if we are stopping but we ask to resume in the same direction, we can move again immediately.
-        //may need to force clear the queue or something.
-        case State::StoppingLeft:
-			if (event == Event::MoveLeft)
-			{
-				MoveLeftAction();
-				PublishEvent(STATE_TRANSITION_EVENT, Event::MovingLeft);
-				return true;
-			}
-			else if (event == Event::MoveRight)
-			{
-				// ignore, gotta wait till we're stopped first.
-				break;
-			}
-			else if (event == Event::SetStopped)
-			{
-				currentState = State::Stopped;
-				PublishEvent(STATE_TRANSITION_EVENT, Event::Stopped);
-				ESP_LOGI("state.cpp", "Stopped");
-			} 
-			break;
-
-		case State::StoppingRight:
-            if (event == Event::MoveRight) {
-                MoveRightAction();
-				PublishEvent(STATE_TRANSITION_EVENT, Event::MovingRight);
-            } 
-            else if (event == Event::MoveLeft) {
-                //Ignore, gotta wait till we're stopped first.
-				break;
-			}
-			else if (event == Event::SetStopped)
-			{
-				currentState = State::Stopped;
-				PublishEvent(STATE_TRANSITION_EVENT, Event::Stopped);
-				ESP_LOGI("state.cpp", "Stopped");
-			}
-			break; 
-
-        default:    
-            break;
-    }
+	if (event < Event::MoveLeft || event >= Event::Count)
+	{
+		return false;
+	}
 
-	// UI handles these commands directly, so we don't need to publish them to it.
-    switch(event) {
-        case Event::RapidSpeed:
-			RapidSpeedAction();
-			break;
-		case Event::NormalSpeed:
-			NormalSpeedAction();
-			break;
-		case Event::UpdateSpeed: 
-		{
-			SingleValueEventData<int32_t> *eventData = dynamic_cast<SingleValueEventData<int32_t> *>(eventPayload);
-			ASSERT_MSG(eventData, "StateMachine", "Failed to cast event data to UpdateSpeedEventData");
-
-			int32_t delta = eventData->myValue;
-			
-
-			if(currentSpeedState == SpeedState::Normal)
-			{
-				ESP_LOGI("StateMachine", "Updating normal speed by %d", delta);
-				myStepper->UpdateNormalSpeed(delta);
-			} 
-			else 
-			{
-				ESP_LOGI("StateMachine", "Updating rapid speed by %d", delta);
-				myStepper->UpdateRapidSpeed(delta);
-			}
-				
-			break;
-		}
-		default:
-			break;
-    }
+	const Transition &transition = TRANSITIONS[Index(currentState)][Index(event)];
+	if (!transition.myAction)
+	{
+		return false;
+	}
 
+	myTransitionCounts[Index(currentState)][Index(event)]++;
+	(this->*transition.myAction)(eventPayload);
+	if (transition.myNext != State::Count)
+	{
+		currentState = transition.myNext;
+	}
+	if (transition.myPublished != Event::Any)
+	{
+		PublishEvent(STATE_TRANSITION_EVENT, transition.myPublished);
+	}
 	return true;
 }
-
@@ -2,6 +2,7 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include <array>
 #include <memory>
 #include "stepper.h"
 // #include "freertos/FreeRTOS.h"
@@ -11,30 +12,134 @@
 
 #include "esp_event_base.h"
 // #include "esp_event.h"
-#include "ui.h"
 #include "EventTypes.h"
 #include "Event.h"
+#include "CommandRing.h"
 
 
 class UI;
 class StateMachine: public EventHandler, public EventPublisher{
 public:
 	explicit StateMachine(std::shared_ptr<Stepper> aStepper);
+
+	/**
+	 **@brief Start the motion task, and forward COMMAND_EVENT traffic from the event bus to it.
+	 ** From here on every command to the state machine and its stepper comes from that task.
+	 ** The stepper's own RampTask and its Position sampler still run beside it, on the ramp
+	 ** state under Stepper's myRampMutex and on the backend's count, so the stepper as a whole
+	 ** is shared, only its commands aren't.
+	 **/
 	void Start();
 	State GetState();
+
+	/**
+	 **@brief Direct lines into the motion task, one per producer task
+	 **/
+	CommandRing &GetSwitchCommands() { return mySwitchCommands; }
+	CommandRing &GetEncoderCommands() { return myEncoderCommands; }
+
+	/**
+	 **@brief Time from one reversal of the reciprocating cycle to the next
+	 **/
+	struct CycleStats
+	{
+		uint32_t myPasses = 0;
+		int64_t myLastPassUs = 0;
+		int64_t myMinPassUs = 0;
+		int64_t myMaxPassUs = 0;
+		int64_t myTotalPassUs = 0;
+	};
+	CycleStats GetCycleStats();
+
+	/**
+	 **@brief Speed changes taken off the rings, and how many reached the stepper once
+	 ** queued ones were merged
+	 **/
+	struct SpeedUpdateStats
+	{
+		uint32_t myReceived = 0;
+		uint32_t myApplied = 0;
+		uint32_t myMerged = 0; // folded into another update, or cancelled out to nothing
+		uint32_t myLargestBatch = 0;
+	};
+	SpeedUpdateStats GetSpeedUpdateStats();
+
+	/**
+	 **@brief Response time of the motion task, from a command being published to the state
+	 ** machine having finished with it, since the last reset. Stops are also kept apart,
+	 ** their worst case is the one the machine's safety rests on.
+	 **/
+	struct ResponseStats
+	{
+		uint32_t myCommands = 0;
+		int64_t myTotalUs = 0;
+		int64_t myWorstUs = 0;
+		Event myWorstEvent = Event::Any;
+		uint32_t myStops = 0;
+		int64_t myWorstStopUs = 0;
+	};
+	ResponseStats GetResponseStats();
+	/**
+	 **@brief Start the response times over, from any task
+	 **/
+	void ResetResponseStats();
+
+	static constexpr size_t STATE_COUNT = static_cast<size_t>(State::Count);
+
+	/**
+	 **@brief What an event does in one state: the action run, the state moved to and the
+	 ** state change published on STATE_TRANSITION_EVENT once the action has run
+	 **/
+	struct Transition
+	{
+		using Action = void (StateMachine::*)(const EventData *aPayload);
+		Action myAction = nullptr;		// nullptr when the event is ignored in that state
+		State myNext = State::Count;	// Count to stay put, or when the action decides
+		Event myPublished = Event::Any; // Any to publish nothing
+	};
+	using TransitionTable = std::array<std::array<Transition, EVENT_COUNT>, STATE_COUNT>;
+
+	static const Transition &GetTransition(State aState, Event anEvent);
+
+	/**
+	 **@brief How many times anEvent has been handled in aState, for a coverage report of the table
+	 **/
+	uint32_t GetTransitionCount(State aState, Event anEvent) const;
+	static const char *GetStateName(State aState);
+
 private:
-    void MoveLeftAction();
-    void MoveRightAction();
-    void RapidSpeedAction();
-    void NormalSpeedAction();
-    void StopLeftAction();
-    void StopRightAction();
+	static constexpr TransitionTable MakeTransitions();
+	static const TransitionTable TRANSITIONS;
 
-	static void CheckIfStoppedTask(void* params);
+	// Transition actions. The table moves the state for all but the cycle's, which only
+	// start once both ends are set and reverse to whichever end is next.
+	void MoveLeftAction(const EventData *aPayload);
+	void MoveRightAction(const EventData *aPayload);
+	void StopAction(const EventData *aPayload);
+	void StoppedAction(const EventData *aPayload);
+	void StartCycleAction(const EventData *aPayload);
+	void ReverseCycleAction(const EventData *aPayload);
 
-	void CreateStoppingTask();
+	// The same in every state
+	void RapidSpeedAction(const EventData *aPayload);
+	void NormalSpeedAction(const EventData *aPayload);
+	void UpdateSpeedAction(const EventData *aPayload);
+	void ZeroPositionAction(const EventData *aPayload);
+	void SetLeftLimitAction(const EventData *aPayload);
+	void SetRightLimitAction(const EventData *aPayload);
+	void ClearLimitsAction(const EventData *aPayload);
+	void SetCycleLeftAction(const EventData *aPayload);
+	void SetCycleRightAction(const EventData *aPayload);
+	void SetBacklashAction(const EventData *aPayload);
+	void SetCycleEnd(int32_t &anEnd, bool &aHasEnd, const EventPayloadType<Event::SetCycleLeft> *eventData);
 
 	static void ProcessEventCallback(void *stateMachine, esp_event_base_t base, int32_t id, void *eventData);
+	static void MotionTask(void *stateMachine);
+	bool ProcessCommands(CommandRing &aCommands, bool aYieldToUrgent);
+	bool ProcessUrgentCommands();
+	void DispatchCommand(MotionCommand &aCommand);
+	void MergeSpeedUpdate(const MotionCommand &aCommand);
+	void FlushSpeedUpdate();
     bool ProcessEvent(Event event, EventData* eventData);
 
     State currentState;
@@ -42,6 +147,40 @@ private:
 	SpeedState currentSpeedState;
 	std::shared_ptr<Stepper> myStepper;
 	StateMachine* myRef;
+
+	// Switches first so a stop is never queued behind speed changes, then stops from the
+	// event bus, then the encoder, then everything else from the event bus. The switch and
+	// urgent rings are checked again after every command from the other two, so a stop
+	// overtakes whatever is still queued there. Both bus rings are fed by its dispatch task.
+	CommandRing mySwitchCommands{EventRecorder::Source::Switches};
+	CommandRing myUrgentCommands;
+	CommandRing myEncoderCommands{EventRecorder::Source::Encoder};
+	CommandRing myBusCommands;
+	TaskHandle_t myMotionTask = nullptr;
+
+	// UpdateSpeed commands queued together are summed into this one, and reach the stepper
+	// when the speed they change may switch or the rings run dry, so a burst of encoder ticks
+	// costs one speed change, one save and one screen update.
+	MotionCommand myPendingSpeed;
+	uint32_t myPendingSpeedCount = 0;
+	SpeedUpdateStats mySpeedUpdateStats;
+	ResponseStats myResponseStats;
+	// The motion task writes the stats and the console and the bench read them, several
+	// int64_t wide on a 32 bit core, so both sides copy them under this
+	static portMUX_TYPE myStatsLock;
+
+	static constexpr uint32_t MOTION_TASK_STACK_SIZE = 4096;
+	// Above the event bus, so a stop it hands over runs before the bus's next handler
+	static constexpr UBaseType_t MOTION_TASK_PRIORITY = configMAX_PRIORITIES - 4;
+
+	int32_t myCycleLeft = 0;
+	int32_t myCycleRight = 0;
+	bool myHasCycleLeft = false;
+	bool myHasCycleRight = false;
+	int64_t myLastReversalUs = 0;
+	CycleStats myCycleStats;
+
+	uint32_t myTransitionCounts[STATE_COUNT][EVENT_COUNT] = {};
 };
 
 #endif // STATE_H
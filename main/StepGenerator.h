@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief What Stepper needs from whatever puts out the step and direction pulses.
+ *
+ * Backends give Stepper a run/stop interface with their own constant acceleration ramp,
+ * and optionally a queue of raw step commands for ramps that Stepper generates itself
+ * (see SCurveRamp and TableRamp). Times in the queue are in ticks of TICKS_PER_SECOND,
+ * whatever timer the backend uses underneath.
+ */
+class StepGenerator
+{
+  public:
+	static constexpr uint32_t TICKS_PER_SECOND = 16000000;
+
+	/**
+	 * @brief Steps that go out ticks apart, or a pause of ticks when steps is 0
+	 */
+	struct Command
+	{
+		uint16_t myTicks;
+		uint8_t mySteps;
+		bool myForward;
+	};
+
+	enum class QueueResult
+	{
+		Ok,
+		Full,
+		Rejected
+	};
+
+	virtual ~StepGenerator() = default;
+
+	virtual void Init(uint8_t aDirPin, uint8_t anEnablePin, uint8_t aStepPin) = 0;
+	virtual const char *GetName() = 0;
+
+	/**
+	 **@brief Speed for the backend's own ramp, applied straight away if it is running
+	 **/
+	virtual void SetSpeed(uint32_t aStepsPerSecond) = 0;
+	virtual uint32_t GetTargetSpeed() = 0;
+	virtual void Run(bool aForward) = 0;
+
+	/**
+	 **@brief Run towards aPosition on the backend's own ramp, braking in time to stop exactly on it
+	 **/
+	virtual void RunTo(int32_t aPosition) = 0;
+
+	/**
+	 **@brief Ramp down to a stop with the backend's own deceleration
+	 **/
+	virtual void Stop() = 0;
+
+	/**
+	 **@brief false until all motion, including the step queue, has finished
+	 **/
+	virtual bool IsStopped() = 0;
+
+	/**
+	 **@brief Signed, negative while moving backward
+	 **/
+	virtual int32_t GetCurrentSpeed() = 0;
+	virtual std::string GetState() = 0;
+
+	/**
+	 **@brief Steps put out so far, counting up while moving forward
+	 **/
+	virtual int32_t GetPosition() = 0;
+
+	/**
+	 **@brief Whether the step queue below can be used. Backends without one only do their own ramp.
+	 **/
+	virtual bool HasQueue() { return false; }
+
+	/**
+	 **@brief Shortest command the queue takes, in ticks
+	 **/
+	virtual uint32_t GetMinCommandTicks() { return 0; }
+	virtual QueueResult AddToQueue(const Command &) { return QueueResult::Rejected; }
+	virtual bool IsQueueFull() { return true; }
+	virtual bool IsQueueEmpty() { return true; }
+
+	/**
+	 **@brief Commands in the queue that have not finished going out, the one going out included
+	 **/
+	virtual uint8_t GetQueueEntries() { return 0; }
+
+	/**
+	 **@brief true if at least aTicks of motion are still waiting in the queue
+	 **/
+	virtual bool HasTicksInQueue(uint32_t) { return false; }
+};
+
+/**
+ **@brief The backend for the stepper library this firmware is built with
+ **/
+std::unique_ptr<StepGenerator> CreateStepGenerator();
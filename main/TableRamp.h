@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+
+namespace TableRampMath
+{
+	constexpr double Sqrt(double aValue)
+	{
+		if (aValue <= 0)
+		{
+			return 0;
+		}
+		double root = aValue < 1 ? 1 : aValue;
+		for (int i = 0; i < 100; i++)
+		{
+			const double next = (root + aValue / root) / 2;
+			if (next == root)
+			{
+				break;
+			}
+			root = next;
+		}
+		return root;
+	}
+
+	/**
+	 ** @brief Exact time from step n to step n + 1 of a ramp from standstill, in ticks
+	 **/
+	constexpr uint32_t ExactInterval(uint32_t aStep, uint32_t anAcceleration, uint32_t aTicksPerSecond)
+	{
+		return static_cast<uint32_t>(aTicksPerSecond * Sqrt(2.0 / anAcceleration) *
+										 (Sqrt(aStep + 1.0) - Sqrt(static_cast<double>(aStep))) +
+									 0.5);
+	}
+
+	template <uint32_t DIRECT_KNOTS, uint32_t KNOTS>
+	struct Tables
+	{
+		static constexpr uint32_t DIRECT_STEPS = DIRECT_KNOTS * DIRECT_KNOTS;
+
+		constexpr Tables(uint32_t anAcceleration, uint32_t aTicksPerSecond)
+		{
+			for (uint32_t step = 0; step < DIRECT_STEPS; step++)
+			{
+				myDirect[step] = ExactInterval(step, anAcceleration, aTicksPerSecond);
+			}
+			for (uint32_t knot = 0; knot < KNOTS; knot++)
+			{
+				myKnots[knot] = ExactInterval(knot * knot, anAcceleration, aTicksPerSecond);
+				myReciprocals[knot] = (1 << 16) / (2 * knot + 1);
+			}
+		}
+
+		uint32_t myDirect[DIRECT_STEPS] = {};
+		// Interval at step i^2
+		uint32_t myKnots[KNOTS] = {};
+		// 1 / (2i + 1) in 0.16 fixed point, 2i + 1 being the number of steps from knot i to the next
+		uint32_t myReciprocals[KNOTS] = {};
+	};
+} // namespace TableRampMath
+
+/**
+ * @brief Constant acceleration ramp read out of tables that are built at compile time.
+ *
+ * A ramp at constant acceleration reaches step n at t = sqrt(2n / a), so the intervals
+ * only depend on how far up the ramp the motor is. The compiler works them out from the
+ * template arguments and the step path only adds, multiplies and shifts, which the S2
+ * can keep up with at full step rate without an FPU.
+ *
+ * The position on the ramp is kept in steps of the acceleration ramp, in 16.16 fixed
+ * point, so slowing down walks back down the same table DECELERATION / ACCELERATION
+ * entries per step.
+ */
+template <uint32_t ACCELERATION_STEPS, uint32_t DECELERATION_STEPS, uint32_t MAX_SPEED, uint32_t TICKS_PER_SECOND>
+class TableRamp
+{
+  public:
+	/**
+	 ** @brief Steps per second to ramp to, capped at MAX_SPEED. This one divides, keep it off the step path.
+	 **/
+	void SetTargetSpeed(uint32_t aStepsPerSecond)
+	{
+		const uint64_t speed = aStepsPerSecond < MAX_SPEED ? aStepsPerSecond : MAX_SPEED;
+		myTargetPosition = static_cast<uint32_t>((speed * speed << 16) / (2 * ACCELERATION_STEPS));
+		myCruiseInterval = speed ? static_cast<uint32_t>(TICKS_PER_SECOND / speed) : 0;
+	}
+
+	/**
+	 ** @brief Advance the ramp by one step
+	 ** @return The time until the following step, in ticks
+	 **/
+	uint32_t NextInterval()
+	{
+		if (myPosition < myTargetPosition)
+		{
+			const uint32_t interval = IntervalAt(myPosition);
+			myPosition = myTargetPosition - myPosition > ONE ? myPosition + ONE : myTargetPosition;
+			return interval;
+		}
+
+		if (myPosition > myTargetPosition)
+		{
+			const uint32_t interval = IntervalAt(myPosition);
+			myPosition = myPosition - myTargetPosition > DECELERATION_STEP ? myPosition - DECELERATION_STEP
+																		   : myTargetPosition;
+			if (myTargetPosition == 0 && myPosition < ONE)
+			{
+				// This was the last step of a ramp down.
+				myPosition = 0;
+			}
+			return interval;
+		}
+
+		return myCruiseInterval;
+	}
+
+	/**
+	 ** @brief Drop straight to standstill, for when the motor is stopped by other means
+	 **/
+	void Reset()
+	{
+		myPosition = 0;
+		myTargetPosition = 0;
+		myCruiseInterval = 0;
+	}
+
+	/**
+	 ** @brief false once a ramp down to zero has produced its last step
+	 **/
+	bool IsActive() const { return myPosition > 0 || myTargetPosition > 0; }
+	bool IsAtTarget() const { return myPosition == myTargetPosition; }
+
+	/**
+	 ** @brief Steps still put out if the target went to zero now, this one included
+	 **/
+	uint32_t GetStoppingSteps() const
+	{
+		if (myPosition == 0)
+		{
+			return 0;
+		}
+		return myPosition < ONE ? 1 : (myPosition - ONE) / DECELERATION_STEP + 1;
+	}
+
+  private:
+	static constexpr uint32_t ONE = 1 << 16;
+	static constexpr uint32_t DECELERATION_STEP =
+		static_cast<uint32_t>((static_cast<uint64_t>(DECELERATION_STEPS) << 16) / ACCELERATION_STEPS);
+	static constexpr uint32_t MAX_STEP =
+		static_cast<uint32_t>(static_cast<uint64_t>(MAX_SPEED) * MAX_SPEED / (2 * ACCELERATION_STEPS)) + 1;
+
+	// The first steps are stored as they are, the curve is too tight there to interpolate.
+	// Past them there is a knot at every square step number i^2, so the knot for any step is
+	// found by counting up or down from the last one, and the 2i + 1 steps up to the next knot
+	// are interpolated with a reciprocal from the table instead of a division.
+	static constexpr uint32_t DIRECT_KNOTS = 8;
+	static constexpr uint32_t KNOTS = static_cast<uint32_t>(TableRampMath::Sqrt(MAX_STEP)) + 2;
+
+	using Tables = TableRampMath::Tables<DIRECT_KNOTS, KNOTS>;
+	static constexpr Tables TABLES = Tables(ACCELERATION_STEPS, TICKS_PER_SECOND);
+
+	static_assert(DECELERATION_STEP > 0, "Deceleration is too small against the acceleration");
+	static_assert(static_cast<uint64_t>(MAX_STEP) * ONE < UINT32_MAX, "Top speed is out of range of the ramp position");
+
+	uint32_t IntervalAt(uint32_t aPosition)
+	{
+		const uint32_t step = aPosition >> 16;
+		if (step < Tables::DIRECT_STEPS)
+		{
+			return TABLES.myDirect[step];
+		}
+
+		while (step >= myKnotEnd)
+		{
+			myKnot++;
+			myKnotStart = myKnotEnd;
+			myKnotEnd += 2 * myKnot + 1;
+		}
+		while (step < myKnotStart)
+		{
+			myKnot--;
+			myKnotEnd = myKnotStart;
+			myKnotStart -= 2 * myKnot + 1;
+		}
+
+		const uint32_t fraction = (step - myKnotStart) * TABLES.myReciprocals[myKnot];
+		const uint32_t drop = TABLES.myKnots[myKnot] - TABLES.myKnots[myKnot + 1];
+		return TABLES.myKnots[myKnot] - static_cast<uint32_t>((static_cast<uint64_t>(drop) * fraction) >> 16);
+	}
+
+	uint32_t myPosition = 0;
+	uint32_t myTargetPosition = 0;
+	uint32_t myCruiseInterval = 0;
+
+	// Knot at or below the last step looked up, and the steps it covers
+	uint32_t myKnot = DIRECT_KNOTS;
+	uint32_t myKnotStart = DIRECT_KNOTS * DIRECT_KNOTS;
+	uint32_t myKnotEnd = (DIRECT_KNOTS + 1) * (DIRECT_KNOTS + 1);
+};
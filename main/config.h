@@ -16,6 +16,7 @@
 #define ENABLE_SSD1306 1
 
 #define ENCODER_COUNTS_FULL_SCALE 1000*4 //10 turns on a 20 turn encoder, 4 counts per detent
+#define ENCODER_COUNTS_PER_DETENT 4
 
 #define dirPinStepper 4
 #define enablePinStepper 5
@@ -27,8 +28,6 @@
 #define ENCODER_B_PIN GPIO_NUM_18
 #define ENCODER_BUTTON_PIN GPIO_NUM_17
 #define PIEZO_PIN GPIO_NUM_2
-#define ACCELERATION 20000 //steps/s/s
-#define DECELERATION 200000
 
 
 
@@ -41,16 +40,23 @@ const adc1_channel_t speedPin = ADC1_CHANNEL_6;  //front knob pot, GPIO7 on the
 
 const uint16_t maxOutputRPM = 200; //160 rpm max output speed
 const float MAX_DRIVER_STEPS_PER_SECOND = 200000; // 13000/80 maximum rpm to give around 160 output rpm  :20kHz max pulse freq in hz at 25/70 duty cycle, 13kHz at 50/50. FastAccelStepper is doing 50/50@13 :(
-const float stepsPerRev = 1600 * (73/18); //18:73 reduction off of the leadscrew
-const float maxStepsPerSecond = maxOutputRPM * stepsPerRev / 60;
+constexpr float stepsPerRev = 1600 * (73/18); //18:73 reduction off of the leadscrew
+constexpr float maxStepsPerSecond = maxOutputRPM * stepsPerRev / 60;
 const float mmPerRev = 0.25 * 25.4; // 4 tpi lead screw
 const float stepsPerMm = stepsPerRev / mmPerRev;
 
+// Every ramp profile runs at these: the backend's own linear ramp, and the S-curve and the
+// table driven ramp that Stepper generates for backends with a step queue
+constexpr uint32_t acceleration = 20000; //steps/s/s
+constexpr uint32_t deceleration = 20000; //steps/s/s
+const float jerk = 400000; //steps/s/s/s, how quickly acceleration builds up and falls away on the S-curve ramp
+const int backlashTakeUpSpeed = 5000; //steps/s, backlash is taken up at this speed from a standstill before the ramp starts
+
 #ifdef USE_DENDO_STEPPER
 //#define USE_DENDO_STEPPER 1
     //(13,000 - 0) / 20,000
-const float FULL_SPEED_ACCELERATION_LINEAR_TIME = 1000*(MAX_DRIVER_STEPS_PER_SECOND / ACCELERATION);
-const float FULL_SPEED_DECELERATION_LINEAR_TIME = 1000*(MAX_DRIVER_STEPS_PER_SECOND / DECELERATION);
+const float FULL_SPEED_ACCELERATION_LINEAR_TIME = 1000*(MAX_DRIVER_STEPS_PER_SECOND / acceleration);
+const float FULL_SPEED_DECELERATION_LINEAR_TIME = 1000*(MAX_DRIVER_STEPS_PER_SECOND / deceleration);
 
     // #define ESP_LOGI(tag, format, ...) printf(format, ##__VA_ARGS__)
     // #define ESP_LOGE(tag, format, ...) printf(format, ##__VA_ARGS__)
@@ -58,8 +64,7 @@ const float FULL_SPEED_DECELERATION_LINEAR_TIME = 1000*(MAX_DRIVER_STEPS_PER_SEC
 
 
 #elif USE_FASTACCELSTEPPER
-const int acceleration = 20000;
-const int deceleration = 20000;
+#define USE_SCURVE_RAMP 0 //1 to start up on the jerk limited S-curve instead of the library's own linear ramp
 #endif
 
 #endif // SHARED_H
@@ -17,6 +17,7 @@
 #include "ui.h"
 //#include "driver/gpio.h"
 #include "Encoder.h"
+#include "Console.h"
 
 static DRAM_ATTR std::shared_ptr<Settings> mySettings;
 //static DRAM_ATTR std::shared_ptr<RapidPot> mySpeedUpdateHandler;
@@ -60,10 +61,14 @@ void setup() {
 		savedSettings->myNormalSpeed
 	);
 
+	myStepper->SetBacklash(savedSettings->myBacklashSteps);
+	myUI->SetPosition(&myStepper->GetPosition());
+
 	myState = std::make_shared<StateMachine>(myStepper);
 	//mySpeedUpdateHandler = std::make_shared<RapidPot>(speedPin, maxStepsPerSecond);
 	
 	myEncoder = std::make_shared<RotaryEncoder>(ENCODER_A_PIN, ENCODER_B_PIN, ENCODER_BUTTON_PIN, maxStepsPerSecond, 100);
+	myEncoder->SetSpeedUnit(savedSettings->mySpeedUnits);
 	
 	MovementSwitches::Create();
 	leftSwitch = std::make_shared<Switch>(LEFTPIN, 50, Event::MoveLeft, Event::StopMoveLeft);
@@ -82,35 +87,16 @@ void setup() {
 	//Start state FIRST or the queues will fill and hang
 	myState->Start();
 	//mySpeedUpdateHandler->Start();
-	MovementSwitches::Start();
+	MovementSwitches::Start(myState->GetSwitchCommands());
 	
-	myEncoder->begin();
+	myEncoder->begin(myState->GetEncoderCommands());
+
+	Console::Start(myState);
   
 	ESP_LOGI("main.cpp", "tasks started");
 	
 }
 
-const char *stateToString(State aState)
-{
-  switch (aState)
-  {
-  case State::MovingLeft:
-	  return "MovingLeft";
-  case State::MovingRight:
-	  return "MovingRight";
-  case State::StoppingLeft:
-	  return "StoppingLeft";
-  case State::StoppingRight:
-	  return "StoppingRight";
-  case State::Stopped:
-	  return "Stopped";
-  default:
-	  return "Unknown";
-  }
-}
-
-
-
 extern "C" void app_main()
 {
 //   esp_log_level_set("main.cpp",ESP_LOG_ERROR);
@@ -124,7 +110,7 @@ extern "C" void app_main()
   //
   while(1) {
     
-	std::string state = stateToString(myState->GetState());
+	std::string state = StateMachine::GetStateName(myState->GetState());
 	std::string speed = std::to_string(myStepper->GetCurrentSpeed());
 
 	if (state != prevState)
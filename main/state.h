@@ -7,7 +7,12 @@ enum class State
 	MovingRight,
 	StoppingLeft,
 	StoppingRight,
-	Stopped
+	Stopped,
+	// Reciprocating between the two cycle ends, heading for the one named
+	CyclingLeft,
+	CyclingRight,
+
+	Count // not a state, the number of them. Keep it last.
 };
 
 enum class SpeedState
@@ -28,4 +33,10 @@ enum class SpeedUnit
 {
 	MMPM = 0,
 	IPM
+};
+
+enum class ScreenView
+{
+	Speed,
+	Position
 };
\ No newline at end of file
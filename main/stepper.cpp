@@ -1,11 +1,7 @@
 #include "config.h"
 #include "stepper.h"
 
-#ifdef USE_FASTACCELSTEPPER
-//#include "FastAccelStepper.h"
-#elif USE_DENDO_STEPPER
-#include "DendoStepper.h"
-#else
+#if !defined(USE_FASTACCELSTEPPER) && !defined(USE_DENDO_STEPPER)
 #error "No stepper library defined"
 #endif
 
@@ -14,207 +10,566 @@
 #include <algorithm>
 #include <esp_log.h>
 
-#include "ui.h"
 
-Stepper::Stepper() {
+Stepper::Stepper() : myBackend(CreateStepGenerator()) {
     myUseRapidSpeed = false;
     myRapidSpeed = 0;
     myNormalSpeed = maxStepsPerSecond;
 }
 
-Stepper::Stepper(int16_t aRapidSpeed, int16_t aNormalSpeed) {
+Stepper::Stepper(int16_t aRapidSpeed, int16_t aNormalSpeed) : myBackend(CreateStepGenerator()) {
     myUseRapidSpeed = false;
     myRapidSpeed = aRapidSpeed;
     myNormalSpeed = aNormalSpeed;
 }
 
+Stepper::Stepper(std::unique_ptr<StepGenerator> aBackend) : myBackend(std::move(aBackend)) {
+    myUseRapidSpeed = false;
+    myRapidSpeed = 0;
+    myNormalSpeed = maxStepsPerSecond;
+}
+
 void Stepper::Init(uint8_t dirPin, uint8_t enablePin, uint8_t stepPin, int16_t rapidSpeed, int16_t normalSpeed){
-    #ifdef USE_DENDO_STEPPER
-
-    myStepperCfg = {
-        .stepPin = stepPin,
-        .dirPin = dirPin,
-        .enPin = enablePin,
-        .timer_group = TIMER_GROUP_0,
-        .timer_idx = TIMER_0,
-        .miStep = MICROSTEP_1,
-        .stepAngle = 1.8};
-
-    myStepper.config(&myStepperCfg);
-    myStepper.init();
-    #elif USE_FASTACCELSTEPPER
-    myEngine.init(1);
-    myStepper = myEngine.stepperConnectToPin(stepPin);
+    myBackend->Init(dirPin, enablePin, stepPin);
+    myPosition.Start(myBackend.get());
     myRapidSpeed = rapidSpeed;
     myNormalSpeed = normalSpeed;
-    if (myStepper) {
-        myStepper->setDirectionPin(dirPin);
-        myStepper->setEnablePin(enablePin);
-        myStepper->setAutoEnable(true);
-        myStepper->setDelayToDisable(200);
-        myStepper->setDelayToEnable(50); // this is the time the enable pin must be active before the stepper starts moving
-        myStepper->setAcceleration(20000);
-        //myStepper->enableOutputs();
-        
+    if (!myBackend->HasQueue())
+    {
+        myRampProfile = RampProfile::Linear;
     }
-    #endif
+    // Core 1 keeps it clear of the bus and motion task on the S3. The S2 has one core, the pin
+    // doesn't apply there and only RAMP_TASK_PRIORITY keeps it ahead of them.
+    xTaskCreatePinnedToCore(RampTask, "RampTask", 4096, this, RAMP_TASK_PRIORITY, &myRampTask, 1);
 
-    ESP_LOGI("Stepper", "Stepper init complete");
+    ESP_LOGI("Stepper", "Stepper init complete on %s", myBackend->GetName());
 }
 
 bool Stepper::IsStopped() {
-    #ifdef USE_DENDO_STEPPER
-    return(myStepper.getState() == IDLE || myStepper.getState() == DISABLED);
-    #elif USE_FASTACCELSTEPPER
-    return (!myStepper->isRunning() && !myStepper->isStopping());
-    #endif
-    
+    std::lock_guard<std::mutex> lock(myRampMutex);
+    return IsMotionDone();
 }
 
-void Stepper::UpdateActiveSpeed() {
-    //NOTE do not put a lock_guard here, it will cause a deadlock. Many things call this function.
-    double targetSpeed = myUseRapidSpeed ? myRapidSpeed : myNormalSpeed;
+bool Stepper::IsMotionDone() {
+    if (myTakeUpSteps || myBackendRunPending)
+    {
+        return false;
+    }
+    if (myRampProfile != RampProfile::Linear && (IsRampActive() || myPendingPauseTicks || myReversePending))
+    {
+        return false;
+    }
+    return myBackend->IsStopped();
+}
+
+void Stepper::SetRampProfile(RampProfile aProfile) {
+    if (aProfile != RampProfile::Linear && !myBackend->HasQueue())
+    {
+        ESP_LOGW("Stepper", "Generated ramps need a step queue, %s has none", myBackend->GetName());
+        return;
+    }
+    if (!IsStopped())
+    {
+        ESP_LOGW("Stepper", "Can't change the ramp profile while moving");
+        return;
+    }
+    myRampProfile = aProfile;
+    ESP_LOGI("Stepper", "%s ramp", aProfile == RampProfile::SCurve ? "S-curve"
+                                   : aProfile == RampProfile::LinearTable ? "Table driven linear" : "Linear");
+}
 
-#ifdef USE_DENDO_STEPPER
-	double currentSpeed = myStepper.getTargetSpeed();
+void Stepper::SetRampTarget(uint32_t aStepsPerSecond) {
+    if (myRampProfile == RampProfile::SCurve)
+    {
+        mySCurveRamp.SetTargetSpeed(aStepsPerSecond);
+    }
+    else
+    {
+        myTableRamp.SetTargetSpeed(aStepsPerSecond);
+    }
+}
 
-	if (targetSpeed == currentSpeed)
-	{
-		return;
-	}
-    double accTime = myStepper.getAcc();
-    double decTime = myStepper.getDec();
-
-    if (targetSpeed > currentSpeed) {
-        // Accelerating
-        double speedDifference = targetSpeed - currentSpeed;
-        accTime = (speedDifference / MAX_DRIVER_STEPS_PER_SECOND) * FULL_SPEED_ACCELERATION_LINEAR_TIME;
-		
-		//this becomes the stopping speed
-		decTime = (targetSpeed / MAX_DRIVER_STEPS_PER_SECOND) * FULL_SPEED_DECELERATION_LINEAR_TIME;
-
-        myStepper.setSpeed(targetSpeed, accTime, decTime);
-    } else {
-        // Decelerating
-        double speedDifference = currentSpeed - targetSpeed;
-        decTime = (speedDifference / MAX_DRIVER_STEPS_PER_SECOND) * FULL_SPEED_DECELERATION_LINEAR_TIME;
+void Stepper::ReverseRamp(uint32_t aStepsPerSecond) {
+    if (myRampProfile == RampProfile::SCurve)
+    {
+        mySCurveRamp.Reverse(aStepsPerSecond);
+    }
+    else
+    {
+        // Constant acceleration already runs through zero, FillQueue starts it up the other way
+        // straight after the last step down
+        myTableRamp.SetTargetSpeed(0);
+    }
+}
+
+bool Stepper::IsRampTurning() {
+    if (myRampProfile == RampProfile::SCurve)
+    {
+        // Braking for the limit ahead turns the reversal back into a stop
+        return mySCurveRamp.IsReversing() || (mySCurveRamp.GetTargetSpeed() <= 0 && mySCurveRamp.IsActive());
+    }
+    return myTableRamp.IsActive();
+}
 
-        myStepper.setSpeed(targetSpeed, accTime, decTime);
+uint32_t Stepper::NextRampInterval() {
+    return myRampProfile == RampProfile::SCurve ? mySCurveRamp.NextInterval() : myTableRamp.NextInterval();
+}
+
+bool Stepper::IsRampActive() {
+    return myRampProfile == RampProfile::SCurve ? mySCurveRamp.IsActive() : myTableRamp.IsActive();
+}
+
+uint32_t Stepper::RampStoppingSteps() {
+    return myRampProfile == RampProfile::SCurve ? mySCurveRamp.GetStoppingSteps() : myTableRamp.GetStoppingSteps();
+}
+
+void Stepper::ResetRamp() {
+    mySCurveRamp.Reset();
+    myTableRamp.Reset();
+}
+
+void Stepper::SyncQueuedPosition() {
+    if (!IsRampActive() && myBackend->IsQueueEmpty())
+    {
+        myQueuedPosition = myBackend->GetPosition();
+    }
+}
+
+void Stepper::StartRamp(bool aForward) {
+    myRampMoving = true;
+    if (IsRampActive() && aForward != myRampForward)
+    {
+        myReversePending = true;
+        ReverseRamp(myUseRapidSpeed ? myRapidSpeed : myNormalSpeed);
+        return;
+    }
+    myReversePending = false;
+    TurnTakeUp(aForward);
+    myRampForward = aForward;
+    SetRampTarget(myUseRapidSpeed ? myRapidSpeed : myNormalSpeed);
+}
+
+void Stepper::TurnTakeUp(bool aForward) {
+    if (myTakeUpSteps && aForward != myRampForward)
+    {
+        // Only the part of the backlash already queued has to come back out
+        myTakeUpSteps = std::max<int32_t>(myBacklash - static_cast<int32_t>(myTakeUpSteps), 0);
+    }
+}
+
+void Stepper::RunQueued(bool aForward) {
+    {
+        std::lock_guard<std::mutex> lock(myRampMutex);
+        SyncQueuedPosition();
+        StartRamp(aForward);
+        myHasMoveTarget = false;
+        myStopPending = false;
+    }
+    xTaskNotifyGive(myRampTask);
+}
+
+void Stepper::MoveTo(int32_t aSteps) {
+    if (myRampProfile != RampProfile::Linear)
+    {
+        std::lock_guard<std::mutex> lock(myRampMutex);
+        SyncQueuedPosition();
+        // Steps still queued from the last move count, so a reversal goes in right behind them.
+        StartRamp(aSteps > myQueuedPosition);
+        myHasMoveTarget = true;
+        myMoveTarget = aSteps;
+        myStopPending = false;
+    }
+    else
+    {
+        UpdateActiveSpeed();
+        std::lock_guard<std::mutex> lock(myRampMutex);
+        myHasMoveTarget = true;
+        myMoveTarget = aSteps;
+        myStopPending = false;
+        StartBackend(aSteps > myBackend->GetPosition());
     }
+    xTaskNotifyGive(myRampTask);
+    ESP_LOGI("Stepper", "Moving to %d", aSteps);
+}
 
-#elif USE_FASTACCELSTEPPER
-	const double currentSpeed = myStepper->getSpeedInMilliHz()/1000;
-	if (targetSpeed == currentSpeed)
+bool Stepper::CheckMotionDone() {
+    bool moved = false;
+    bool stopped = false;
+    bool waiting = false;
+    {
+        std::lock_guard<std::mutex> lock(myRampMutex);
+        if (myHasMoveTarget)
+        {
+            // Generated ramps are done once the last step is queued, the backend's own once it stops.
+            moved = myRampProfile == RampProfile::Linear ? !myBackendRunPending && !myTakeUpSteps && myBackend->IsStopped()
+                                                         : !IsRampActive() && !myPendingPauseTicks && !myTakeUpSteps;
+            myHasMoveTarget = !moved;
+        }
+        if (myStopPending)
+        {
+            stopped = IsMotionDone();
+            myStopPending = !stopped;
+        }
+        waiting = myHasMoveTarget || myStopPending;
+    }
+    if (moved)
+    {
+        PublishEvent(COMMAND_EVENT, Event::MoveComplete);
+    }
+    if (stopped)
+    {
+        PublishEvent(COMMAND_EVENT, Event::SetStopped);
+    }
+    return waiting;
+}
+
+void Stepper::RunBackend(bool aForward) {
+    {
+        std::lock_guard<std::mutex> lock(myRampMutex);
+        myHasMoveTarget = false;
+        myStopPending = false;
+        StartBackend(aForward);
+    }
+    xTaskNotifyGive(myRampTask);
+}
+
+void Stepper::StartBackend(bool aForward) {
+    TurnTakeUp(aForward);
+    if (myTakeUpSteps || (myBacklash && aForward != myLoadedForward))
+    {
+        // The backend's own ramp would crawl through the backlash from a standstill. Once it
+        // has stopped FillQueue takes the backlash up from the step queue and comes back here.
+        myBackend->Stop();
+        myRampForward = aForward;
+        myBackendRunPending = true;
+        return;
+    }
+    myBackendRunPending = false;
+    myLoadedForward = aForward;
+    myPosition.QueueDrained();
+
+    int32_t end;
+    bool hasEnd = GetLimit(aForward, end);
+    if (myHasMoveTarget && (!hasEnd || (aForward ? myMoveTarget < end : myMoveTarget > end)))
+    {
+        end = myMoveTarget;
+        hasEnd = true;
+    }
+    if (!hasEnd)
+    {
+        myBackend->Run(aForward);
+        return;
+    }
+    const int32_t position = myBackend->GetPosition();
+    if (aForward ? position >= end : position <= end)
+    {
+        // A MoveTo less than the backlash away is already there once it has been taken up
+        if (!myHasMoveTarget)
+        {
+            ESP_LOGW("Stepper", "At the soft limit, not moving");
+        }
+        return;
+    }
+    myBackend->RunTo(end);
+}
+
+void Stepper::SetBacklash(int32_t aSteps) {
+    std::lock_guard<std::mutex> lock(myRampMutex);
+    if (aSteps > 0 && !myBackend->HasQueue())
+    {
+        ESP_LOGW("Stepper", "Taking up backlash needs a step queue, %s has none", myBackend->GetName());
+        return;
+    }
+    myBacklash = std::max<int32_t>(aSteps, 0);
+    ESP_LOGI("Stepper", "Backlash %d steps", myBacklash);
+}
+
+void Stepper::SetLeftLimit(int32_t aSteps) {
+    std::lock_guard<std::mutex> lock(myRampMutex);
+    myLeftLimit = aSteps;
+    myHasLeftLimit = true;
+    ESP_LOGI("Stepper", "Left limit at %d", aSteps);
+}
+
+void Stepper::SetRightLimit(int32_t aSteps) {
+    std::lock_guard<std::mutex> lock(myRampMutex);
+    myRightLimit = aSteps;
+    myHasRightLimit = true;
+    ESP_LOGI("Stepper", "Right limit at %d", aSteps);
+}
+
+void Stepper::ClearLimits() {
+    std::lock_guard<std::mutex> lock(myRampMutex);
+    myHasLeftLimit = false;
+    myHasRightLimit = false;
+    ESP_LOGI("Stepper", "Limits cleared");
+}
+
+bool Stepper::GetLimit(bool aForward, int32_t &aLimit) {
+    if (aForward == static_cast<bool>(StepperDirection::Left))
+    {
+        aLimit = myLeftLimit;
+        return myHasLeftLimit;
+    }
+    aLimit = myRightLimit;
+    return myHasRightLimit;
+}
+
+bool Stepper::BrakeForLimit() {
+    int32_t limit;
+    const bool hasLimit = GetLimit(myRampForward, limit);
+    // While turning around the target is behind, only the limit ahead counts until the ramp has turned.
+    if (myHasMoveTarget && !myReversePending && (!hasLimit || (myRampForward ? myMoveTarget < limit : myMoveTarget > limit)))
+    {
+        limit = myMoveTarget;
+    }
+    else if (!hasLimit)
+    {
+        return true;
+    }
+    const int64_t remaining = myRampForward ? static_cast<int64_t>(limit) - myQueuedPosition
+                                            : static_cast<int64_t>(myQueuedPosition) - limit;
+    if (remaining <= 0)
+    {
+        // Only hit while still moving if braking started late, the limit wins over a smooth stop.
+        ResetRamp();
+        return false;
+    }
+    if (RampStoppingSteps() >= remaining)
+    {
+        SetRampTarget(0);
+    }
+    return true;
+}
+
+void Stepper::RampTask(void *aStepper) {
+    Stepper *stepper = static_cast<Stepper *>(aStepper);
+    while (true)
+    {
+        const bool filling = stepper->FillQueue();
+        if (stepper->CheckMotionDone() || filling)
+        {
+            vTaskDelay(1);
+        }
+        else
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
+
+bool Stepper::FillQueue() {
+    // How far ahead of the motor the ramp is computed. Short, so a stop or speed change
+    // takes effect within a few ms, but enough to ride out the 1 ms refill period.
+    constexpr uint32_t QUEUE_AHEAD_TICKS = StepGenerator::TICKS_PER_SECOND / 200;
+    // Steps are batched into commands of about this length, FastAccelStepper's queue only has 32 of them.
+    constexpr uint32_t COMMAND_TICKS = StepGenerator::TICKS_PER_SECOND / 1000;
+    const uint32_t minCommandTicks = myBackend->GetMinCommandTicks();
+
+    std::lock_guard<std::mutex> lock(myRampMutex);
+    if (myBackendRunPending && !myTakeUpSteps && myBackend->IsStopped())
+    {
+        // The backend's own ramp has stopped and the queue is free for the take-up, or it has
+        // gone out and the ramp can start
+        if (myBacklash && myRampForward != myLoadedForward)
+        {
+            myQueuedPosition = myBackend->GetPosition();
+            myTakeUpSteps = myBacklash;
+        }
+        else
+        {
+            StartBackend(myRampForward);
+        }
+    }
+    while (!myBackend->IsQueueFull() && !myBackend->HasTicksInQueue(QUEUE_AHEAD_TICKS))
+    {
+        StepGenerator::Command command = {};
+        if (myReversePending && !IsRampTurning() && !myPendingPauseTicks)
+        {
+            // Through zero and straight on the other way, with no gap in the queue
+            myReversePending = false;
+            TurnTakeUp(!myRampForward);
+            myRampForward = !myRampForward;
+            SetRampTarget(myUseRapidSpeed ? myRapidSpeed : myNormalSpeed);
+        }
+        command.myForward = myRampForward;
+        const int32_t start = myQueuedPosition;
+        bool takeUp = false;
+
+        if (myPendingPauseTicks)
+        {
+            // The rest of a step interval too long for one command
+            uint32_t ticks = std::min<uint32_t>(myPendingPauseTicks, UINT16_MAX);
+            if (myPendingPauseTicks - ticks > 0 && myPendingPauseTicks - ticks < minCommandTicks)
+            {
+                ticks = myPendingPauseTicks - minCommandTicks;
+            }
+            command.myTicks = ticks;
+            command.mySteps = 0;
+            myPendingPauseTicks -= ticks;
+        }
+        else if (myTakeUpSteps || (IsRampActive() && myRampForward != myLoadedForward && myBacklash))
+        {
+            // First steps this way since moving the other way. The backlash goes out quickly
+            // from a standstill, with the table not moving, and runs straight into the ramp.
+            if (!myTakeUpSteps)
+            {
+                myTakeUpSteps = myBacklash;
+            }
+            const uint32_t steps = std::min<uint32_t>(myTakeUpSteps, UINT8_MAX);
+            command.mySteps = steps;
+            command.myTicks = std::max<uint32_t>(StepGenerator::TICKS_PER_SECOND / backlashTakeUpSpeed,
+                                                 minCommandTicks / steps + 1);
+            myTakeUpSteps -= steps;
+            takeUp = true;
+            myQueuedPosition += myRampForward ? static_cast<int32_t>(steps) : -static_cast<int32_t>(steps);
+            if (!myTakeUpSteps)
+            {
+                myLoadedForward = myRampForward;
+            }
+        }
+        else
+        {
+            if (IsRampActive())
+            {
+                myLoadedForward = myRampForward;
+            }
+            uint32_t ticks = 0;
+            uint32_t steps = 0;
+            // A command only goes one way, the step that turns around ends it
+            while (steps < UINT8_MAX && ticks < COMMAND_TICKS && IsRampActive() && !(myReversePending && !IsRampTurning()) &&
+                   BrakeForLimit())
+            {
+                ticks += NextRampInterval();
+                steps++;
+                myQueuedPosition += myRampForward ? 1 : -1;
+            }
+            if (steps == 0)
+            {
+                break;
+            }
+
+            const uint32_t interval = std::max<uint32_t>(ticks / steps, minCommandTicks / steps + 1);
+            command.mySteps = steps;
+            command.myTicks = std::min<uint32_t>(interval, UINT16_MAX);
+            // Slow steps at either end of a ramp can be longer than a command allows, the rest
+            // of the time goes in as pauses. Anything under the shortest command is dropped.
+            const uint32_t queuedTicks = command.myTicks * steps;
+            myPendingPauseTicks = ticks > queuedTicks + minCommandTicks ? ticks - queuedTicks : 0;
+        }
+
+        if (myBackend->AddToQueue(command) != StepGenerator::QueueResult::Ok)
+        {
+            ESP_LOGE("Stepper", "Step queue did not take a command, abandoning the ramp");
+            ResetRamp();
+            myPendingPauseTicks = 0;
+            myTakeUpSteps = 0;
+            break;
+        }
+        myPosition.Queued(start, myQueuedPosition - start, takeUp);
+    }
+    return IsRampActive() || myPendingPauseTicks || myReversePending || myTakeUpSteps || myBackendRunPending ||
+           !myBackend->IsQueueEmpty();
+}
+
+void Stepper::UpdateActiveSpeed() {
+    //NOTE do not put a lock_guard here, it will cause a deadlock. Many things call this function.
+    double targetSpeed = myUseRapidSpeed ? myRapidSpeed : myNormalSpeed;
+
+	if (myRampProfile != RampProfile::Linear)
 	{
+		std::lock_guard<std::mutex> lock(myRampMutex);
+		if (myRampMoving && !myReversePending)
+		{
+			SetRampTarget(targetSpeed);
+		}
 		return;
 	}
-    
-//    const bool isRunning = myStepper->isRunning();
-//    if(aSpeed != 0 && (curSpeed <= aSpeed - (aSpeed*0.05) || curSpeed >= aSpeed + (aSpeed*0.05))) {
-//        ESP_LOGI("Stepper", "Speed is not within 0.5%% of target speed, updating");
-    myStepper->setSpeedInHz(targetSpeed);
-    myStepper->applySpeedAcceleration();
-#endif
+
+    myBackend->SetSpeed(targetSpeed);
 }
 
-void Stepper::UpdateRapidSpeed(int16_t aRapidSpeedDelta) {
-    myRapidSpeed += aRapidSpeedDelta;
+void Stepper::UpdateRapidSpeed(int32_t aRapidSpeedDelta) {
+    // A fast spin asks for more than there is, only what was applied goes to the UI
+    const int16_t rapidSpeed = std::clamp<int32_t>(myRapidSpeed + aRapidSpeedDelta, 0, static_cast<int32_t>(maxStepsPerSecond));
+    const int32_t applied = rapidSpeed - myRapidSpeed;
+    myRapidSpeed = rapidSpeed;
 
-    auto *encoderEventData = new SingleValueEventData<int32_t>(myRapidSpeed);
-    PublishEvent(SETTINGS_EVENT, Event::SaveRapidSpeed, encoderEventData);
-    auto *uiEncoderEventData = new SingleValueEventData<int32_t>(aRapidSpeedDelta);
-    PublishEvent(UI_EVENT, Event::UpdateSpeed, uiEncoderEventData);
+    PublishEvent<Event::SaveRapidSpeed>(SETTINGS_EVENT, myRapidSpeed);
+    PublishEvent<Event::UpdateSpeed>(UI_EVENT, applied);
 
     UpdateActiveSpeed();
 }
 
-void Stepper::UpdateNormalSpeed(int16_t aNormalSpeedDelta)
+void Stepper::UpdateNormalSpeed(int32_t aNormalSpeedDelta)
 {
 	//cap it at the rapid speed
-	myNormalSpeed += aNormalSpeedDelta;
-    if(myNormalSpeed > myRapidSpeed) 
-    {
-        myNormalSpeed = myRapidSpeed; //cap it at the rapid speed
-    }
+    const int16_t normalSpeed = std::clamp<int32_t>(myNormalSpeed + aNormalSpeedDelta, 0, std::max<int16_t>(myRapidSpeed, 0));
+    const int32_t applied = normalSpeed - myNormalSpeed;
+    myNormalSpeed = normalSpeed;
 
-    auto *encoderEventData = new SingleValueEventData<int32_t>(myNormalSpeed);
-    PublishEvent(SETTINGS_EVENT, Event::SaveNormalSpeed, encoderEventData);
-    auto *uiEncoderEventData = new SingleValueEventData<int32_t>(aNormalSpeedDelta);
-    PublishEvent(UI_EVENT, Event::UpdateSpeed, uiEncoderEventData);
+    PublishEvent<Event::SaveNormalSpeed>(SETTINGS_EVENT, myNormalSpeed);
+    PublishEvent<Event::UpdateSpeed>(UI_EVENT, applied);
 
 	UpdateActiveSpeed();
 }
 
 void Stepper::MoveLeft() {
-    #ifdef USE_DENDO_STEPPER
-    UpdateActiveSpeed();
-    myStepper.runInf(static_cast<bool>(StepperDirection::Left));
-    #elif USE_FASTACCELSTEPPER
-    UpdateActiveSpeed();
-    myStepper->runForward();
-    #endif
+    if (myRampProfile != RampProfile::Linear) {
+        RunQueued(static_cast<bool>(StepperDirection::Left));
+    } else {
+        UpdateActiveSpeed();
+        RunBackend(static_cast<bool>(StepperDirection::Left));
+    }
     UpdateActiveSpeed();
     ESP_LOGI("Stepper", "Moving left");
 }
 
 void Stepper::MoveRight() {
-    #ifdef USE_DENDO_STEPPER
-    UpdateActiveSpeed();
-    myStepper.runInf(static_cast<bool>(StepperDirection::Right));
-    #elif USE_FASTACCELSTEPPER
-    UpdateActiveSpeed();
-    myStepper->runBackward();
-    #endif
+    if (myRampProfile != RampProfile::Linear) {
+        RunQueued(static_cast<bool>(StepperDirection::Right));
+    } else {
+        UpdateActiveSpeed();
+        RunBackend(static_cast<bool>(StepperDirection::Right));
+    }
     UpdateActiveSpeed();
     ESP_LOGI("Stepper", "Moving right");
 }
 
 void Stepper::Stop() {
-    #ifdef USE_DENDO_STEPPER
-//    myNormalSpeed = 0;
-//    myRapidSpeed = 0;
-//    UpdateActiveSpeed();
-	myStepper.stop();
-#elif USE_FASTACCELSTEPPER
-    myStepper->stopMove();
-    #endif
+    if (myRampProfile == RampProfile::Linear) {
+        myBackend->Stop();
+    }
+    {
+        std::lock_guard<std::mutex> lock(myRampMutex);
+        if (myRampProfile != RampProfile::Linear) {
+            myRampMoving = false;
+            myReversePending = false;
+            SetRampTarget(0);
+        }
+        // A take-up already started still finishes, the run it was for doesn't
+        myBackendRunPending = false;
+        myHasMoveTarget = false;
+        myStopPending = true;
+    }
+    // RampTask watches for the end of the motion and publishes SetStopped
+    xTaskNotifyGive(myRampTask);
     ESP_LOGI("Stepper", "Stopping");
 }
 
 std::string Stepper::GetState() {
-	
-#ifdef USE_DENDO_STEPPER
-	switch (myStepper.getState())
-	{
-		
-		case IDLE:
-			return "IDLE";
-			break;
-		case ACC:
-			return "ACCELERATING";
-			break;
-		case DEC:
-			return "DECELERATING";
-			break;
-		case COAST:
-			return "COASTING";
-			break;
-		case DISABLED:
-			return "DISABLED";
-			break;
-			
+	if (myRampProfile != RampProfile::Linear) {
+		std::lock_guard<std::mutex> lock(myRampMutex);
+		if (myRampMoving) {
+			return "RUNNING";
+		}
+		return IsRampActive() || !myBackend->IsStopped() ? "STOPPING" : "STOPPED";
 	}
-
-#elif USE_FASTACCELSTEPPER
-	if (myStepper->isRunning()) {
+	std::lock_guard<std::mutex> lock(myRampMutex);
+	if (myBackendRunPending) {
 		return "RUNNING";
-	} else if (myStepper->isStopping()) {
-		return "STOPPING";
-	} else {
-		return "STOPPED";
 	}
-#endif
-	return "ERROR";
+	return myBackend->GetState();
 }
 
 void Stepper::SetRapidSpeed() {
@@ -4,11 +4,12 @@
 #include "EventTypes.h"
 #include "config.h"
 
-#ifdef USE_DENDO_STEPPER
-#include "DendoStepper.h"
-#elif USE_FASTACCELSTEPPER
-#include "FastAccelStepper.h"
-#endif
+#include "Position.h"
+#include "SCurveRamp.h"
+#include "StepGenerator.h"
+#include "TableRamp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <memory>
 #include <mutex>
 
@@ -21,43 +22,86 @@ public:
         Left = true,
         Right = false
     };
+
+	enum class RampProfile
+	{
+		Linear,      // the backend's own constant acceleration ramp
+		SCurve,      // jerk limited, generated here and fed to the backend's step queue
+		LinearTable  // constant acceleration from compile time tables, fed like the S-curve
+	};
+
+	// What it starts up on, USE_SCURVE_RAMP in config.h opts in to the S-curve
+#if USE_SCURVE_RAMP
+	static constexpr RampProfile DEFAULT_RAMP_PROFILE = RampProfile::SCurve;
+#else
+	static constexpr RampProfile DEFAULT_RAMP_PROFILE = RampProfile::Linear;
+#endif
+
     Stepper();
 	Stepper(int16_t aRapidSpeed, int16_t aNormalSpeed);
+	/**
+	 **@brief Drive something other than the stepper library the firmware is built with
+	 **/
+	explicit Stepper(std::unique_ptr<StepGenerator> aBackend);
     void Init(uint8_t dirPin, uint8_t enablePin, uint8_t stepPin, int16_t rapidSpeed, int16_t normalSpeed);
-	void UpdateNormalSpeed(int16_t aNormalSpeedDelta);
-	void UpdateRapidSpeed(int16_t aRapidSpeedDelta);
+	/**
+	 **@brief Change a speed by up to the delta, the rapid speed stays within 0..maxStepsPerSecond
+	 ** and the normal speed within 0..the rapid speed
+	 **/
+	void UpdateNormalSpeed(int32_t aNormalSpeedDelta);
+	void UpdateRapidSpeed(int32_t aRapidSpeedDelta);
     void MoveLeft();
     void MoveRight();
+
+	/**
+	 **@brief Run at the active speed to aSteps and stop there, publishing MoveComplete once the
+	 ** ramp down has been generated. A move back the other way can start straight after it.
+	 **/
+	void MoveTo(int32_t aSteps);
     void Stop();
     void SetRapidSpeed();
     void SetNormalSpeed();
 
+	/**
+	 **@brief Select how the motor gets up to speed and back down. Only takes effect while stopped.
+	 **/
+	void SetRampProfile(RampProfile aProfile);
+	RampProfile GetRampProfile() { return myRampProfile; }
+
 	/**
 	 **@brief Get the current speed in hz
 	 **@return The current speed in hz
 	 **/
-#ifdef USE_DENDO_STEPPER
-	uint16_t GetCurrentSpeed() {
-		return myStepper.getSpeed();
-	}
-#elif USE_FASTACCELSTEPPER
 	uint16_t GetCurrentSpeed() {
-		return myStepper->getCurrentSpeedInMilliHz()/1000;
+		return myBackend->GetCurrentSpeed();
 	}
-#endif
 
-#ifdef USE_DENDO_STEPPER
 	uint16_t GetTargetSpeed()
 	{
-		return myStepper.getTargetSpeed();
+		return myBackend->GetTargetSpeed();
 	}
-#elif USE_FASTACCELSTEPPER
-	uint16_t GetTargetSpeed()
-	{
-		return myStepper->getSpeedInMilliHz() / 1000;
-	}
-#endif
 
+	StepGenerator &GetBackend() { return *myBackend; }
+
+	/**
+	 **@brief Soft travel limits in motor steps, as counted by the backend. Moving left counts up.
+	 ** Moves brake early enough to come to rest exactly on them.
+	 **/
+	void SetLeftLimit(int32_t aSteps);
+	void SetRightLimit(int32_t aSteps);
+	void ClearLimits();
+
+	/**
+	 **@brief Lost motion in the drive, in steps. It is taken up at backlashTakeUpSpeed from the
+	 ** step queue before every change of direction, and never counts as table position. Backends
+	 ** without a step queue can't, and keep it at 0.
+	 **/
+	void SetBacklash(int32_t aSteps);
+
+	/**
+	 **@brief Table position, safe to read from any task without waiting
+	 **/
+	Position &GetPosition() { return myPosition; }
 
 	std::string GetState();
 
@@ -66,13 +110,124 @@ private:
         
     void UpdateActiveSpeed();
         
-#ifdef USE_DENDO_STEPPER
-    DendoStepper myStepper;
-    DendoStepper_config_t myStepperCfg;
-#elif USE_FASTACCELSTEPPER
-    FastAccelStepperEngine myEngine = FastAccelStepperEngine();
-    FastAccelStepper* myStepper;
-#endif
+	void RunQueued(bool aForward);
+	void RunBackend(bool aForward);
+
+	/**
+	 **@brief Start the backend's own ramp in aForward, to the MoveTo target or limit if there is
+	 ** one. If there is backlash to take up first it stops the backend and leaves the start to
+	 ** FillQueue. Callers hold myRampMutex.
+	 **/
+	void StartBackend(bool aForward);
+
+	/**
+	 **@brief Point the generated ramp in aForward at the active speed. If it is moving the other
+	 ** way it ramps down and carries straight on into aForward. Callers hold myRampMutex.
+	 **/
+	void StartRamp(bool aForward);
+
+	/**
+	 **@brief Turning to aForward part way through taking up the backlash the other way. Callers hold myRampMutex.
+	 **/
+	void TurnTakeUp(bool aForward);
+
+	/**
+	 **@brief Catch myQueuedPosition up with the motor if nothing is queued. Callers hold myRampMutex.
+	 **/
+	void SyncQueuedPosition();
+
+	/**
+	 **@brief The soft limit ahead when moving in aForward, if one is set
+	 **/
+	bool GetLimit(bool aForward, int32_t &aLimit);
+
+	/**
+	 **@brief Ramps down once the rest of the way to the limit or the MoveTo target is all it
+	 ** takes to stop. Called before every generated step.
+	 **@return false if the end has been reached and no more steps can go out
+	 **/
+	bool BrakeForLimit();
+
+	/**
+	 **@brief Publishes MoveComplete once a MoveTo is done, and SetStopped once the motor is at rest after Stop
+	 **@return true while either is still to come
+	 **/
+	bool CheckMotionDone();
+
+	/**
+	 **@brief IsStopped for callers that already hold myRampMutex
+	 **/
+	bool IsMotionDone();
+
+	/**
+	 **@brief The ramp generated here for the selected profile. Callers hold myRampMutex.
+	 **/
+	void SetRampTarget(uint32_t aStepsPerSecond);
+	void ReverseRamp(uint32_t aStepsPerSecond);
+	/**
+	 **@brief Still heading the old way after ReverseRamp
+	 **/
+	bool IsRampTurning();
+	uint32_t NextRampInterval();
+	bool IsRampActive();
+	uint32_t RampStoppingSteps();
+	void ResetRamp();
+
+	/**
+	 **@brief Keeps a few ms of generated steps queued up in the backend while a ramp is active,
+	 ** and tells the state machine when a stop or MoveTo has finished
+	 **/
+	static void RampTask(void *aStepper);
+	// Above the motion task and the event bus, and level with the esp_timer task that runs the
+	// switch debounce timers and the position sampler. The queue only holds about 5 ms, so a
+	// refill can't wait behind a bus handler or a burst of switch and encoder commands.
+	static constexpr UBaseType_t RAMP_TASK_PRIORITY = configMAX_PRIORITIES - 3;
+
+	/**
+	 **@brief Top up the backend's step queue from the ramp
+	 **@return true while there is still motion to feed or run out
+	 **/
+	bool FillQueue();
+
+    std::unique_ptr<StepGenerator> myBackend;
+	Position myPosition;
+
+	SCurveRamp mySCurveRamp = SCurveRamp(acceleration, deceleration, jerk, StepGenerator::TICKS_PER_SECOND);
+	TableRamp<acceleration, deceleration, static_cast<uint32_t>(maxStepsPerSecond), StepGenerator::TICKS_PER_SECOND>
+		myTableRamp;
+	TaskHandle_t myRampTask = nullptr;
+	// Guards the generated ramps and the queue state between the feeder task and the state machine
+	std::mutex myRampMutex;
+	bool myRampForward = true;
+	bool myRampMoving = false;
+	// Ramping down to turn around, FillQueue flips myRampForward once the ramp has turned
+	bool myReversePending = false;
+	// Ticks of a long step interval that did not fit in the queue yet
+	uint32_t myPendingPauseTicks = 0;
+	// Where the motor will be once every step queued so far has gone out
+	int32_t myQueuedPosition = 0;
+
+	int32_t myBacklash = 0;
+	// Which way the drive was last moved, so which way the backlash is taken up. Position
+	// starts out the same, as if the last move had been backward.
+	bool myLoadedForward = false;
+	// Backlash still to take up before the ramp starts
+	uint32_t myTakeUpSteps = 0;
+	// On the linear profile, StartBackend is waiting for the backend to stop and the take-up to
+	// go out. Which way it goes is in myRampForward.
+	bool myBackendRunPending = false;
+
+	// Set by Stop until SetStopped goes out
+	bool myStopPending = false;
+	// Set by MoveTo until MoveComplete goes out
+	bool myHasMoveTarget = false;
+	int32_t myMoveTarget = 0;
+
+	bool myHasLeftLimit = false;
+	int32_t myLeftLimit = 0;
+	bool myHasRightLimit = false;
+	int32_t myRightLimit = 0;
+	RampProfile myRampProfile = DEFAULT_RAMP_PROFILE;
     bool myUseRapidSpeed = false;
         
     int16_t myRapidSpeed;
@@ -1,5 +1,4 @@
 #include "ui.h"
-#include <chrono>
 #include "config.h"
 #include "state.h"
 #include "icons.h"
@@ -29,18 +28,11 @@ UI::UI(gpio_num_t sdaPin,
 	mySpeedUnits = aSavedSpeedUnits;
 	myNormalSpeed = aSavedNormalSpeed;
 	
-	myButtonPin = aButtonPin;
 	myUIState = UIState::Stopped;
 	myScreen = std::make_unique<Screen>(sdaPin, sclPin, i2cPort, i2cClkFreq);
 	myRef.reset(this);
 	myIsRapid = false;
 
-	gpio_pad_select_gpio(myButtonPin);
-	gpio_set_direction(myButtonPin, GPIO_MODE_INPUT);
-	gpio_set_pull_mode(myButtonPin, GPIO_PULLUP_ONLY);
-	
-	xTaskCreatePinnedToCore(ToggleUnitsButtonTask, "ToggleUnitsButtonTask", 2048*2, this, 1, nullptr, 0);
-
 	ESP_LOGI("UI", "UI constructor complete");
 }
 
@@ -82,9 +74,12 @@ void UI::ProcessEvent(Event aEvent, EventData *aEventData)
 	case Event::ToggleUnits:
 		ToggleUnits();
 		break;
+	case Event::ToggleView:
+		myScreen->ToggleView();
+		break;
 	case Event::UpdateSpeed:
 		{
-			SingleValueEventData<int32_t> const *evt = (SingleValueEventData<int32_t>*)aEventData;
+			const auto *evt = GetPayload<Event::UpdateSpeed>(aEventData);
 			int32_t speedDelta = evt->myValue;
 
 			if(myIsRapid)
@@ -110,11 +105,12 @@ void UI::Start()
 	myScreen->Start();
 	
 	RegisterEventHandler(STATE_TRANSITION_EVENT, Event::Any, ProcessEventCallback);
-	RegisterEventHandler(COMMAND_EVENT, Event::RapidSpeed, ProcessEventCallback);
-	RegisterEventHandler(COMMAND_EVENT, Event::NormalSpeed, ProcessEventCallback);
+	RegisterEventHandler(UI_EVENT, Event::RapidSpeed, ProcessEventCallback);
+	RegisterEventHandler(UI_EVENT, Event::NormalSpeed, ProcessEventCallback);
 	RegisterEventHandler(UI_EVENT , Event::UpdateSpeed, ProcessEventCallback);
 	RegisterEventHandler(UI_EVENT, Event::UpdateSpeed, ProcessEventCallback);
 	RegisterEventHandler(COMMAND_EVENT, Event::ToggleUnits, ProcessEventCallback);
+	RegisterEventHandler(COMMAND_EVENT, Event::ToggleView, ProcessEventCallback);
 
 	myScreen->SetUnit(mySpeedUnits);
 	myScreen->SetSpeed(myNormalSpeed);
@@ -123,60 +119,9 @@ void UI::Start()
 }
 
 
-void UI::ToggleUnitsButtonTask(void *params)
-{
-	UI *ui = (UI *)params;
-
-	try
-	{
-		ui->ToggleUnitsButton();
-	}
-	catch (const std::exception &e)
-	{
-		ESP_LOGE("UI", "ToggleUnitsButtonTask: %s", e.what());
-	}
-	catch (...)
-	{
-		ESP_LOGE("UI", "ToggleUnitsButtonTask: Unknown exception");
-	}
-	
-}
-//TODO move the units button to the encoder or switches.
-void UI::ToggleUnitsButton()
+void UI::SetPosition(const Position *aPosition)
 {
-    bool buttonPressed = false;
-    auto startTime = std::chrono::steady_clock::now();
-	bool buttonPressedEventSent = false;
-
-	while (true)
-    {
-		if (!gpio_get_level(myButtonPin))
-        {
-            if (!buttonPressed)
-            {
-                startTime = std::chrono::steady_clock::now();
-                buttonPressed = true;
-				buttonPressedEventSent = false;
-            }
-            else
-            {
-                auto currentTime = std::chrono::steady_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime);
-
-                if (duration.count() >= 1 && !buttonPressedEventSent)
-                {
-                    ESP_ERROR_CHECK(PublishEvent(COMMAND_EVENT,Event::ToggleUnits));
-                    buttonPressedEventSent = true;
-                }
-            }
-        }
-        else
-        {
-            buttonPressed = false;
-        }
-
-		vTaskDelay(250 * portTICK_PERIOD_MS);
-    }
+	myScreen->SetPosition(aPosition);
 }
 
 void UI::ToggleUnits() 
@@ -192,5 +137,5 @@ void UI::ToggleUnits()
 
 	myScreen->SetUnit(mySpeedUnits);
 
-	PublishEvent(SETTINGS_EVENT, Event::SetSpeedUnit, new SingleValueEventData<SpeedUnit>(mySpeedUnits));
+	PublishEvent<Event::SetSpeedUnit>(SETTINGS_EVENT, mySpeedUnits);
 }
\ No newline at end of file
@@ -31,16 +31,15 @@ class UI : public EventPublisher, EventHandler
 	void Update();
 	static void UpdateTask(void *pvParameters);
 	void Start();
+	void SetPosition(const Position *aPosition);
 	static void ProcessEventCallback(void *aUi, esp_event_base_t base, int32_t id, void *payload);
 
 	void ProcessEvent(Event event, EventData* eventData);
 
   private:
 	static std::shared_ptr<UI> myRef;
-	void ToggleUnitsButton();
 	void ToggleUnits();
 	static void CheckAndSaveSettingsCallback(void *param);
-	static void ToggleUnitsButtonTask(void *params);
 	led_strip_handle_t configureLed(gpio_num_t anLedPin);
 	std::unique_ptr<Screen> myScreen;
 	int32_t myNormalSpeed;
@@ -48,5 +47,4 @@ class UI : public EventPublisher, EventHandler
 	SpeedUnit mySpeedUnits;
 	bool myIsRapid;
 	led_strip_handle_t* myLedHandle;
-	gpio_num_t myButtonPin;
 };
\ No newline at end of file